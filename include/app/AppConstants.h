@@ -13,6 +13,8 @@
 
 #include <glm/glm.hpp>
 
+#include <common/CompactVertex.h> // vertex formats
+
 //
 // App constants
 //
@@ -32,11 +34,31 @@ const std::streamsize MAX_SIZE = 1048;
 const std::string DEFAULT_MODEL = "C:\\Users\\Tommy\\Documents\\Graphics\\Gltf\\Suzanne\\Suzanne.gltf";
 // const std::string MODEL_PATH = "C:\\Users\\Tommy\\Documents\\Graphics\\Gltf\\BoomBox\\BoomBox.gltf";
 
+// vertex layout the model is uploaded with, VERTEX_FORMAT_COMPACT trades precision for vertex fetch bandwidth
+const kVertexFormat MODEL_VERTEX_FORMAT = VERTEX_FORMAT_FULL;
+
+// parts of the offscreen subpass recorded as jobs into secondary command buffers, 0 records it in the primary
+const uint32_t RECORDING_PART_COUNT = 4;
+// when the environment variable is set, startup times recording the first frame with each number of parts
+const char* const MEASURE_RECORDING_VARIABLE = "RENDERER_MEASURE_RECORDING";
+// when the environment variable is set, loading and startup print statistics, errors and fallbacks always print
+const char* const PRINT_STATS_VARIABLE = "RENDERER_PRINT_STATS";
+
 // path to the skybox
 const std::string SKYBOX_PATH = "C:\\Users\\Tommy\\Documents\\Graphics\\CubeMaps\\sky\\";
 
-// path to shaders
-const std::string SHADER_DIR = "C:\\Users\\Tommy\\Documents\\Graphics\\VulkanGraphics\\src\\shaders\\";
+// cpu zones of every thread in chrome trace_event json, written on exit, relative to the working directory
+const std::string CPU_TRACE_PATH = "cpu_trace.json";
+
+// gpu timings of the last frames, written on exit, relative to the working directory
+const std::string GPU_TIMINGS_PATH = "gpu_timings.csv";
+
+// pipeline cache written on exit and reloaded on startup, relative to the working directory
+const std::string PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
+// compiled shaders, relative to the working directory. The environment variable overrides it
+const std::string SHADER_DIR = "src/shaders";
+const char* const SHADER_DIR_VARIABLE = "RENDERER_SHADER_DIR";
 
 namespace Axes {
 	// world axes
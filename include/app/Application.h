@@ -13,10 +13,13 @@
 
 #include <common/types.h>
 
+#include <app/AppConstants.h>
+
 #include <scene/Model.h> // the model class
 #include <scene/Camera.h> // the camera struct
 #include <scene/SpotLight.h>
 #include <scene/GLTFModel.h>
+#include <scene/Scene.h>
 
 #include <math/primitives/Plane.h>
 #include <math/primitives/Cube.h>
@@ -71,9 +74,14 @@ private:
     void updateUniformBuffers(UI32 currentImage);
 
     //-Record command buffers for rendering (geom and gui)-------------------------------------------------------//
-    void buildGuiCommandBuffer(UI32 cmdBufferIndex);
-    void buildShadowMapCommandBuffer(VkCommandBuffer cmdBuffer);
-    void recordCommandBuffer(VkCommandBuffer cmdBuffer, UI32 index);
+    // recorded every frame into the frame's transient buffers, index is the swap chain image drawn to
+    void buildGuiCommandBuffer(VkCommandBuffer cmdBuffer, UI32 frame, UI32 index);
+    // a complete command buffer of its own, not recorded until the shadow map is created again in initVulkan
+    void buildShadowMapCommandBuffer(VkCommandBuffer cmdBuffer, UI32 index);
+    void recordCommandBuffer(VkCommandBuffer cmdBuffer, UI32 frame, UI32 index);
+    // times recording a frame's commands inline and with each number of recording threads, only run when
+    // MEASURE_RECORDING_VARIABLE is set
+    void measureRecording();
 
     //-Window/Input Callbacks------------------------------------------------------------------------------------//
     static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
@@ -101,6 +109,10 @@ public:
 
     GLTFModel _gltfModel;
 
+    // transform hierarchy, the model's root node is driven by the gui and its glTF nodes hang below it
+    Scene _scene;
+    UI32 _modelNode = 0;
+
     Skybox _skybox;
 
     std::vector<Texture> textures;
@@ -123,10 +135,6 @@ public:
     VkDescriptorSet offScreenDescriptorSet;
     VkDescriptorSet shadowMapDescriptorSet;
 
-    // TODO: UPDATE BUFFER MANAGEMENT
-    Buffer _offScreenUniform;
-    Buffer _compositionUniforms;
-
     glm::vec3 translate = glm::vec3(0.0f);
     glm::vec3 rotate = glm::vec3(0.0f);;
     float scale = 1.0f;
@@ -144,6 +152,13 @@ public:
     std::chrono::steady_clock::time_point currTime;
     float deltaTime;
 
+    // secondary command buffers the offscreen subpass is split into, 0 records it inline
+    UI32 recordingParts = RECORDING_PART_COUNT;
+
+    // cpu time spent recording the frame's render and gui commands, averaged over recent frames
+    F64 renderRecordingMilliseconds = 0.0;
+    F64 guiRecordingMilliseconds = 0.0;
+
     size_t currentFrame = 0;
     uint32_t imageIndex = 0; // idx of curr sc image
 };
@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////
+// CompactVertex struct declaration
+///////////////////////////////////////////////////////
+
+//
+// A 20 byte quantized alternative to the 48 byte Vertex, for meshes where vertex fetch bandwidth matters
+// more than precision. Positions are 16 bit normalized integers within the mesh's bounding box (about
+// 1/65535th of the box's extent), normals and tangents are octahedral encoded in two 16 bit normalized
+// integers (at most 0.04 degrees of error), the tangent's handedness is kept in the position's w and
+// texture coordinates are half floats. The bounding box is handed to the vertex shader, which undoes the
+// position quantization.
+//
+
+#ifndef COMPACT_VERTEX_H
+#define COMPACT_VERTEX_H
+
+#include <common/Vertex.h>
+#include <common/types.h>
+
+#include <glm/glm.hpp>
+
+#include <vulkan/vulkan_core.h>
+
+#include <array>
+#include <cstddef>
+
+// vertex layout a mesh is uploaded with
+typedef enum {
+    VERTEX_FORMAT_FULL,    // Vertex
+    VERTEX_FORMAT_COMPACT, // CompactVertex
+    VERTEX_FORMAT_MAX_ENUM
+} kVertexFormat;
+
+// maps quantized positions in [0, 1] back to model space, position = offset + quantized * scale
+struct VertexQuantization {
+    glm::vec3 offset = glm::vec3(0.0f);
+    glm::vec3 scale  = glm::vec3(1.0f);
+};
+
+struct CompactVertex {
+    UI16 position[4]; // (posX, posY, posZ, tangent handedness) unorm
+    I16  normal[2];   // octahedral snorm
+    I16  tangent[2];  // octahedral snorm
+    UI16 texCoord[2]; // half float
+
+    //-Encoding--------------------------------------------------------------------------------------------------//
+    // bounding box of the vertices' positions
+    static VertexQuantization quantization(const Vertex* vertices, size_t count);
+
+    static CompactVertex encode(const Vertex& vertex, const VertexQuantization& quantization);
+    Vertex decode(const VertexQuantization& quantization) const;
+
+    //-Binding and attribute descriptions------------------------------------------------------------------------//
+    inline static VkVertexInputBindingDescription getBindingDescriptions(uint32_t primitiveNum) {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = primitiveNum;
+        bindingDescription.stride = sizeof(CompactVertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return bindingDescription;
+    }
+
+    inline static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions(uint32_t primitiveNum) {
+        std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
+        attributeDescriptions[0] = { 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(CompactVertex, position) };
+        attributeDescriptions[1] = { 1, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex, normal) };
+        attributeDescriptions[2] = { 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex, tangent) };
+        attributeDescriptions[3] = { 3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactVertex, texCoord) };
+        return attributeDescriptions;
+    }
+};
+
+static_assert(sizeof(CompactVertex) == 20, "CompactVertex must stay tightly packed");
+
+#endif // !COMPACT_VERTEX_H
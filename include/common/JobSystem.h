@@ -0,0 +1,223 @@
+///////////////////////////////////////////////////////
+// JobSystem class declaration
+///////////////////////////////////////////////////////
+
+//
+// A fixed pool of worker threads that run small jobs. Every thread has its own lock free deque (Chase and
+// Lev): it pushes and pops jobs at the bottom without contention, while threads that ran out of work steal
+// from the top of the others. The thread that initialises the system is thread 0 and takes part whenever it
+// waits. Jobs are stored inline in per thread rings of slots, so queueing one never allocates.
+//
+// Completion is tracked with counters: a job added with a counter increments it and decrements it once it
+// has run, and waiting on a counter runs other jobs until it reaches zero. A job can also be given a counter
+// to run after, which is enough to express the passes of a frame as a graph of jobs: until the counter reaches
+// zero the job is parked on it, and the job that brings it to zero queues it. Jobs queued from threads outside
+// of the system, or before it is initialised, run inline on the calling thread.
+//
+
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <common/types.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Thread budget of the renderer: the job system runs one thread per core, the thread that initialises it
+// included. Pipeline builds block inside the driver for a long time and would hold job threads, so the pipeline
+// registry has PIPELINE_BUILD_THREADS threads of its own on top. They only compete with the jobs while builds
+// are queued, mostly during startup, and sleep otherwise.
+const UI32 PIPELINE_BUILD_THREADS = 2;
+
+// bytes of a job's callable, stored inline in the job
+const size_t JOB_DATA_SIZE = 48;
+
+// jobs a thread can have queued or running at once, slots of its ring are reused once their job has run and
+// jobs queued while every slot is taken run inline
+const UI32 MAX_JOBS_PER_THREAD = 4096;
+
+// jobs per thread a parallel for is split into when no grain is given, spare jobs even out uneven work
+const UI32 PARALLEL_FOR_JOBS_PER_THREAD = 4;
+
+struct Job;
+
+// jobs left to run, waited on with JobSystem::wait
+class JobCounter {
+public:
+	inline bool done() const {
+		if (_pending.load(std::memory_order_acquire) != 0) {
+			return false;
+		}
+		// the job that brought it to zero may still be queueing its continuations
+		std::lock_guard<std::mutex> lock(_mutex);
+		return true;
+	}
+
+private:
+	friend class JobSystem;
+	std::atomic<UI32> _pending{ 0 };
+	// jobs that run after this counter, guarded by the mutex together with reaching zero
+	mutable std::mutex _mutex;
+	Job* _continuations = nullptr;
+};
+
+struct Job {
+	void (*function)(Job& job) = nullptr;
+	JobCounter* counter = nullptr;
+	Job* next = nullptr; // in the continuations of a counter
+	std::atomic<bool> busy{ false }; // set by the owning thread when queued, cleared by whoever ran it
+	alignas(16) UC data[JOB_DATA_SIZE];
+};
+
+// a single producer, multiple consumer deque: only the owner pushes and pops, anyone steals
+class JobDeque {
+public:
+	// capacity is a power of two
+	explicit JobDeque(UI32 capacity);
+
+	// owner only, false when full
+	bool push(Job* job);
+	Job* pop();
+
+	// any thread, null when empty or when another thread took the job first
+	Job* steal();
+
+private:
+	alignas(64) std::atomic<I64> _top{ 0 };
+	alignas(64) std::atomic<I64> _bottom{ 0 };
+	std::unique_ptr<std::atomic<Job*>[]> _jobs;
+	I64 _mask;
+};
+
+class JobSystem {
+public:
+	// the system shared by the whole process
+	static JobSystem& get();
+
+	//-Initialisation and cleanup--------------------------------------------------------------------------------//
+	// starts workerCount threads, the calling thread becomes thread 0
+	void init(UI32 workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1);
+	// waits for queued jobs and stops the workers
+	void cleanup();
+
+	//-Jobs------------------------------------------------------------------------------------------------------//
+	// queues function(), counter is incremented until it has run. With a dependency it is parked until the
+	// dependency's counter reaches zero, without holding a thread
+	template<typename Function>
+	void run(Function&& function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+	// runs queued jobs until the counter reaches zero
+	void wait(JobCounter& counter);
+
+	// runs function(i) for every i in [0, count) in jobs of grain indices, 0 splits the range evenly
+	template<typename Function>
+	void parallelFor(size_t count, const Function& function, size_t grain = 0);
+
+	// threads taking jobs, including thread 0
+	inline UI32 threadCount() const { return static_cast<UI32>(_workers.size()) + 1; }
+	// of the calling thread, UINT32_MAX outside of the system
+	static UI32 threadIndex();
+
+private:
+	struct ThreadState {
+		ThreadState() : deque(MAX_JOBS_PER_THREAD), jobs(new Job[MAX_JOBS_PER_THREAD]) {}
+
+		JobDeque               deque;
+		std::unique_ptr<Job[]> jobs;
+		UI32                   nextJob = 0;
+	};
+
+	// a free slot of the calling thread's ring, null when jobs run inline
+	Job* allocate();
+	template<typename Function>
+	void store(Job* job, Function&& function, JobCounter* counter);
+	void submit(Job* job);
+	// parks the job on the dependency, false when it has already reached zero
+	bool defer(Job* job, JobCounter& dependency);
+	// decrements the counter, the job that brings it to zero queues its continuations
+	void release(JobCounter& counter);
+	// the calling thread's newest job, or one stolen from another thread
+	Job* take(UI32 thread);
+	void execute(Job* job);
+
+	void work(UI32 thread);
+
+private:
+	std::vector<std::unique_ptr<ThreadState>> _threads;
+	std::vector<std::thread> _workers;
+
+	// jobs sitting in a deque, workers sleep when there are none
+	std::atomic<I64>        _queued{ 0 };
+	std::atomic<UI32>       _sleeping{ 0 };
+	std::mutex              _mutex;
+	std::condition_variable _condition;
+	std::atomic<bool>       _stopping{ false };
+};
+
+//
+// Template function definitions
+//
+
+template<typename Function>
+void JobSystem::run(Function&& function, JobCounter* counter, JobCounter* dependency) {
+	Job* job = allocate();
+	if (!job) {
+		if (dependency) {
+			wait(*dependency);
+		}
+		function();
+		return;
+	}
+
+	store(job, std::forward<Function>(function), counter);
+	if (dependency && defer(job, *dependency)) {
+		return;
+	}
+	submit(job);
+}
+
+template<typename Function>
+void JobSystem::store(Job* job, Function&& function, JobCounter* counter) {
+	using Callable = std::decay_t<Function>;
+	static_assert(sizeof(Callable) <= JOB_DATA_SIZE && alignof(Callable) <= 16, "Job captures too much");
+
+	new (job->data) Callable(std::forward<Function>(function));
+	job->function = [](Job& job) {
+		Callable& callable = *std::launder(reinterpret_cast<Callable*>(job.data));
+		callable();
+		callable.~Callable();
+	};
+	job->counter = counter;
+	if (counter) {
+		counter->_pending.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+template<typename Function>
+void JobSystem::parallelFor(size_t count, const Function& function, size_t grain) {
+	if (count == 0) {
+		return;
+	}
+
+	grain = grain > 0 ? grain : std::max<size_t>(1, count / (threadCount() * PARALLEL_FOR_JOBS_PER_THREAD));
+	JobCounter counter;
+	for (size_t begin = 0; begin < count; begin += grain) {
+		size_t end = std::min(begin + grain, count);
+		run([&function, begin, end]() {
+			for (size_t i = begin; i < end; i++) {
+				function(i);
+			}
+		}, &counter);
+	}
+	wait(counter);
+}
+
+#endif // !JOB_SYSTEM_H
@@ -0,0 +1,49 @@
+///////////////////////////////////////////////////////
+// MappedFile class declaration
+///////////////////////////////////////////////////////
+
+//
+// A read only memory mapping of a whole file. Pages are brought in by the OS on first access and
+// can be dropped again under memory pressure, so large assets can be read without a heap copy.
+// The mapping is released when the object is destroyed or closed.
+//
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <common/types.h>
+
+#include <string>
+
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	//-Mapping---------------------------------------------------------------------------------------------------//
+	bool open(const std::string& path);
+	void close();
+
+	inline bool isOpen() const { return _data != nullptr; }
+	inline const UC* data() const { return _data; }
+	inline size_t size() const { return _size; }
+
+private:
+	const UC* _data = nullptr;
+	size_t    _size = 0;
+
+#ifdef _WIN32
+	void* _file    = nullptr;
+	void* _mapping = nullptr;
+#else
+	int _fd = -1;
+#endif
+};
+
+#endif // !MAPPED_FILE_H
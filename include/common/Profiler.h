@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////
+// Profiler class declaration
+///////////////////////////////////////////////////////
+
+//
+// Records cpu zones, the time spent in a scope, and exports them as a Chrome trace (chrome://tracing or
+// ui.perfetto.dev). A zone is opened with PROFILE_ZONE("name") and closed at the end of its scope. Each
+// thread records into its own ring of events, allocated the first time it records, so recording takes no
+// lock and never allocates afterwards. When a ring is full the oldest events are overwritten. Times come
+// from a monotonic clock, in nanoseconds since the profiler was first used.
+//
+// Defining PROFILER_DISABLED compiles the zones out, the trace is then empty. Names are not copied and
+// must outlive the profiler, string literals are.
+//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <common/types.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// events kept per thread, the newest ones once a ring has wrapped
+const UI32 PROFILER_EVENTS_PER_THREAD = 128 * 1024;
+
+struct ProfileEvent {
+	const char* name;
+	UI64 start; // nanoseconds since the profiler's epoch
+	UI64 end;
+};
+
+class Profiler {
+public:
+	// the profiler shared by the whole process
+	static Profiler& get();
+
+	// nanoseconds since the profiler's epoch
+	static UI64 now();
+
+	// names the calling thread in the trace
+	void setThreadName(const char* name);
+
+	// a zone of the calling thread
+	void record(const char* name, UI64 start, UI64 end);
+
+	// writes every thread's events as trace_event json. Threads still recording may tear their newest events,
+	// it is meant to be called once the frame loop has stopped
+	bool writeTrace(const std::string& path);
+
+private:
+	struct ThreadEvents {
+		ThreadEvents() : events(new ProfileEvent[PROFILER_EVENTS_PER_THREAD]) {}
+
+		std::unique_ptr<ProfileEvent[]> events;
+		std::atomic<UI64>               count{ 0 }; // events recorded, the ring holds the last ones
+		UI32                            id = 0;
+		const char*                     name = nullptr;
+	};
+
+	Profiler();
+
+	// the calling thread's ring, registered on first use
+	ThreadEvents& threadEvents();
+
+private:
+	std::chrono::steady_clock::time_point _epoch;
+
+	// rings live as long as the profiler, threads that have exited are still exported
+	std::mutex                                 _mutex;
+	std::vector<std::unique_ptr<ThreadEvents>> _threads;
+};
+
+// records its scope as a zone of the calling thread
+class ProfileZone {
+public:
+	explicit ProfileZone(const char* name) : _name(name), _start(Profiler::now()) {}
+	~ProfileZone() { Profiler::get().record(_name, _start, Profiler::now()); }
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+	const char* _name;
+	UI64 _start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#ifndef PROFILER_DISABLED
+	#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+	#define PROFILE_THREAD(name) Profiler::get().setThreadName(name)
+#else
+	#define PROFILE_ZONE(name)
+	#define PROFILE_THREAD(name)
+#endif
+
+#endif // !PROFILER_H
@@ -57,8 +57,26 @@ const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation
 const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
+// optional, enabled when the device supports bindless materials
+const std::vector<const char*> descriptorIndexingExtensions = {
+    VK_KHR_MAINTENANCE3_EXTENSION_NAME,
+    VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME
+};
+
+// optional, lets culled indirect draws be compacted on the gpu, which then also writes the draw count
+const std::vector<const char*> drawIndirectCountExtensions = {
+    VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME
+};
+
+// upper bound on the textures of a bindless descriptor set, lowered to the device limits
+const UI32 MAX_BINDLESS_TEXTURES = 4096;
+
+// frames the cpu can record ahead of the gpu, uniforms are versioned per swap chain image so this is only
+// bounded by the synchronisation objects
+const size_t MAX_FRAMES_IN_FLIGHT = 3;
 
-const size_t MAX_FRAMES_IN_FLIGHT = 2;
+// upper bound on the swap chain image count, per image resources are sized with it
+const UI32 MAX_SWAPCHAIN_IMAGES = 8;
 
 const UI32 IMGUI_POOL_NUM = 1000;
 
@@ -67,6 +85,7 @@ namespace utils {
     struct QueueFamilyIndices {
         std::optional<UI32> graphicsFamily; // queue supporting drawing commands
         std::optional<UI32> presentFamily; // queue for presenting image to vk surface 
+        std::optional<UI32> transferFamily; // transfer only queue (dma engine), if the device exposes one
 
         inline bool isComplete() {
             // if device supports drawing cmds AND image can be presented to surface
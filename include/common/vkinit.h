@@ -71,7 +71,7 @@ namespace vkinit {
 
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo(
         UI32 layoutCount,
-        VkDescriptorSetLayout* layouts,
+        const VkDescriptorSetLayout* layouts,
         VkPipelineLayoutCreateFlags flags = 0);
 
     VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo(
@@ -219,6 +219,14 @@ namespace vkinit {
 
     VkFenceCreateInfo fenceCreateInfo(
         VkFenceCreateFlags flags = 0);
+
+    //-----------------------------------------------------------------------------------------------------------//
+    //-QUERY STRUCTS---------------------------------------------------------------------------------------------//
+    //-----------------------------------------------------------------------------------------------------------//
+
+    VkQueryPoolCreateInfo queryPoolCreateInfo(
+        VkQueryType queryType,
+        UI32 queryCount);
 }
 
 
@@ -18,6 +18,7 @@
 
 #include <vulkan/vulkan_core.h> // vulkan core structs &c
 
+class UploadContext;
 
 // POD Buffer struct
 struct BufferData {
@@ -43,7 +44,7 @@ public:
     };
 
 public:
-    Buffer() : _vkBuffer(nullptr), _memory(nullptr) {}
+    Buffer() : _vkBuffer(nullptr), _allocation{} {}
 
     //-Buffer creation and cleanup-------------------------------------------------------------------------------//
     static Buffer createBuffer(const VulkanContext& context, UI64 size, VkBufferUsageFlags usage, 
@@ -51,18 +52,21 @@ public:
 
     void cleanupBufferData(VkDevice device);
 
+    // host visible buffers are persistently mapped, returns nullptr otherwise
+    inline UC* mapped() const { return _allocation._mapped; }
+
     //-Buffer copying--------------------------------------------------------------------------------------------//
     static void copyBuffer(const VulkanContext* vkSetup, const VkCommandPool& commandPool, CopyInfo* bufferCopyInfo);
     static void copyBufferToImage(const VulkanContext* vkSetup, const VkCommandPool& renderCommandPool, 
         VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy>& regions);
 
     //-Buffer creation on GPU------------------------------------------------------------------------------------//
-    static Buffer createDeviceLocalBuffer(const VulkanContext* vkSetup, const VkCommandPool& commandPool, 
-        const BufferData& buffer, VkBufferUsageFlagBits usage);
+    static Buffer createDeviceLocalBuffer(const VulkanContext* vkSetup, UploadContext& uploadContext, 
+        const BufferData& buffer, VkBufferUsageFlags usage);
 
 public:
-    VkBuffer       _vkBuffer;
-    VkDeviceMemory _memory;
+    VkBuffer                    _vkBuffer;
+    MemoryAllocator::Allocation _allocation;
 };
 
 
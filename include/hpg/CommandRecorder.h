@@ -0,0 +1,64 @@
+///////////////////////////////////////////////////////
+// CommandRecorder class declaration
+///////////////////////////////////////////////////////
+
+//
+// Records the commands of a subpass on several threads. Each part of the subpass is a job of the job system
+// that records into its own secondary command buffer, allocated from a command pool that only that part
+// touches, so no thread ever waits on another while recording. The primary command buffer then executes the
+// parts in order with vkCmdExecuteCommands. Pools are transient, kept per frame in flight and reset as a whole
+// before the frame is recorded again, which is cheaper than resetting buffers one by one. The calling thread
+// records parts too while it waits. Recording a frame requires that its previous commands have finished.
+//
+
+#ifndef COMMAND_RECORDER_H
+#define COMMAND_RECORDER_H
+
+#include <hpg/VulkanContext.h>
+
+#include <common/types.h>
+
+#include <vulkan/vulkan_core.h>
+
+#include <functional>
+#include <vector>
+
+class CommandRecorder {
+public:
+	// records part of a subpass into a secondary command buffer that has been begun, part is in [0, partCount)
+	using Job = std::function<void(VkCommandBuffer commandBuffer, UI32 part, UI32 partCount)>;
+
+public:
+	//-Initialisation and cleanup--------------------------------------------------------------------------------//
+	// pools are made for up to maxPartCount parts per frame in flight
+	void init(const VulkanContext* context, UI32 maxPartCount);
+	void cleanup();
+
+	//-Recording-------------------------------------------------------------------------------------------------//
+	// records the job into partCount secondary command buffers of a frame, partCount <= maxPartCount().
+	// Returns the buffers in part order, to be executed in the subpass they continue
+	const VkCommandBuffer* record(UI32 frame, UI32 partCount, VkRenderPass renderPass, UI32 subpass,
+		VkFramebuffer framebuffer, const Job& job);
+
+	inline UI32 maxPartCount() const { return _maxPartCount; }
+
+private:
+	void recordPart(UI32 part);
+
+private:
+	const VulkanContext* _context = nullptr;
+
+	UI32 _maxPartCount = 0;
+
+	// per frame in flight and part, [frame * _maxPartCount + part]
+	std::vector<VkCommandPool>   _commandPools;
+	std::vector<VkCommandBuffer> _commandBuffers;
+
+	// the record in progress, written by the calling thread before the parts are queued
+	const Job*                     _job = nullptr;
+	UI32                           _frame = 0;
+	UI32                           _partCount = 0;
+	VkCommandBufferInheritanceInfo _inheritance{};
+};
+
+#endif // !COMMAND_RECORDER_H
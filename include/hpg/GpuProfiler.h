@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////
+// GpuProfiler class declaration
+///////////////////////////////////////////////////////
+
+//
+// Times passes on the gpu with timestamp queries. Each scope is a pair of timestamps written around the
+// commands it times, and each frame in flight has its own query pool so that a frame's results are read
+// once its fence has signalled, without waiting on the device. Results are converted to milliseconds with
+// the device's timestampPeriod and kept over the last frames, for graphs and for a csv dump.
+//
+// Devices whose graphics queue has no valid timestamp bits, as some software drivers, get a disabled
+// profiler: no query pool is created and every call does nothing.
+//
+
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <hpg/VulkanContext.h>
+
+#include <common/types.h>
+
+#include <vulkan/vulkan_core.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+// frames of timings kept per scope
+const UI32 GPU_PROFILER_HISTORY = 256;
+
+class GpuProfiler {
+public:
+	//-Initialisation and cleanup--------------------------------------------------------------------------------//
+	// names of the scopes, indexed by the scope passed to begin and end
+	void init(const VulkanContext* context, const char* const* scopeNames, UI32 scopeCount);
+	void cleanup();
+
+	//-Recording-------------------------------------------------------------------------------------------------//
+	// resets the frame's queries, recorded outside of a render pass before any scope of the frame
+	void reset(VkCommandBuffer commandBuffer, UI32 frame);
+	// valid in primary and secondary command buffers, inside or outside of a render pass
+	void begin(VkCommandBuffer commandBuffer, UI32 frame, UI32 scope);
+	void end(VkCommandBuffer commandBuffer, UI32 frame, UI32 scope);
+
+	//-Results---------------------------------------------------------------------------------------------------//
+	// the frame's commands have been submitted, their results are read by the next collect of the frame
+	void submitted(UI32 frame);
+	// reads the results of the frame's last submission, once its fence has signalled. Scopes that were not
+	// recorded are left out
+	void collect(UI32 frame);
+
+	inline bool enabled() const { return _enabled; }
+	inline UI32 scopeCount() const { return static_cast<UI32>(_names.size()); }
+	inline const std::string& scopeName(UI32 scope) const { return _names[scope]; }
+	// true once the scope has a result, scopes that are never recorded have none
+	inline bool hasResults(UI32 scope) const { return _recorded[scope]; }
+
+	// GPU_PROFILER_HISTORY milliseconds of a scope, oldest at historyOffset()
+	inline const F32* history(UI32 scope) const { return _history.data() + scope * GPU_PROFILER_HISTORY; }
+	inline UI32 historyOffset() const { return static_cast<UI32>(_collected % GPU_PROFILER_HISTORY); }
+	F32 average(UI32 scope) const;
+
+	// a row per collected frame in the history, a column per scope with results
+	bool writeCsv(const std::string& path) const;
+
+private:
+	const VulkanContext* _context = nullptr;
+	bool _enabled = false;
+
+	std::vector<std::string> _names;
+	std::vector<bool>        _recorded;
+
+	std::array<VkQueryPool, MAX_FRAMES_IN_FLIGHT> _queryPools{};
+	std::array<bool, MAX_FRAMES_IN_FLIGHT>        _submitted{};
+
+	// nanoseconds per tick, and the bits of a timestamp that are valid
+	F64  _period = 0.0;
+	UI64 _mask = 0;
+
+	// [scope * GPU_PROFILER_HISTORY + frame], frames collected so far
+	std::vector<F32> _history;
+	UI64             _collected = 0;
+
+	// scratch of collect, a value and an availability per query
+	std::vector<UI64> _results;
+};
+
+#endif // !GPU_PROFILER_H
@@ -52,6 +52,10 @@ public:
         VkImageFormatProperties properties;
     };
 
+    //-Image creation-----------------------------------------------------//
+    static VkImage createImage(const VulkanContext& context, const VkImageCreateInfo& imageCreateInfo,
+        VkMemoryPropertyFlags properties, MemoryAllocator::Allocation* pAllocation);
+
     //-Image view creation------------------------------------------------//
     static VkImageView createImageView(const VulkanContext* vkSetup, const VkImageViewCreateInfo& imageViewCreateInfo);
 
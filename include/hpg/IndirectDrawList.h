@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////
+// IndirectDrawList class declaration
+///////////////////////////////////////////////////////
+
+//
+// Moves the draws of a model to the GPU. The draw records (index range, material and bounding sphere of
+// each primitive) are uploaded once to a storage buffer. Every frame a compute shader tests the records
+// against the view frustum and writes a VkDrawIndexedIndirectCommand for each visible one, and the
+// offscreen pass draws them all with a single indirect call. When the device has VK_KHR_draw_indirect_count
+// visible commands are packed at the front of the buffer and the shader counts them. Otherwise every
+// record keeps its command slot, and culled records are written with an instance count of 0. The material
+// is passed as the first instance of each command. Recording costs the same however many records there are.
+// Commands and counts are kept per uniform arena slice, so the frames in flight never share them.
+//
+
+#ifndef INDIRECT_DRAW_LIST_H
+#define INDIRECT_DRAW_LIST_H
+
+#include <hpg/Buffer.h>
+#include <hpg/Renderer.h>
+
+#include <common/types.h>
+
+#include <glm/glm.hpp>
+
+#include <vulkan/vulkan_core.h>
+
+#include <vector>
+
+// a draw as read by the culling shader (std430)
+struct IndirectDrawRecord {
+	UI32      firstIndex;
+	UI32      indexCount;
+	UI32      material;
+	UI32      padding;
+	glm::vec4 bounds; // xyz = centre, w = radius, in model space
+};
+
+// threads of a culling workgroup, matches cull.comp
+const UI32 CULL_WORKGROUP_SIZE = 64;
+
+class IndirectDrawList {
+public:
+	//-Initialisation and cleanup--------------------------------------------------------------------------------//
+	// uniformOffset is the range of the model's OffscreenUBO in the renderer's uniform arena
+	void init(Renderer& renderer, const std::vector<IndirectDrawRecord>& records, VkDeviceSize uniformOffset);
+	void cleanup(Renderer& renderer);
+
+	static PipelineRegistry::Pipeline buildCullPipeline(const Renderer& renderer, const PipelineState& state,
+		VkPipelineCache cache);
+
+	//-Recording-------------------------------------------------------------------------------------------------//
+	// culls the records into the commands of a slice, recorded outside of a render pass
+	void cull(VkCommandBuffer commandBuffer, UI32 slice, UI32 dynamicOffset) const;
+	// draws the commands of a slice, the graphics pipeline and descriptor sets are bound by the caller
+	void draw(VkCommandBuffer commandBuffer, UI32 slice) const;
+
+	inline UI32 recordCount() const { return _recordCount; }
+
+private:
+	const VulkanContext* _context = nullptr;
+
+	UI32 _recordCount = 0;
+
+	Buffer _records;
+	std::vector<Buffer> _commands; // per slice
+	std::vector<Buffer> _counts;   // per slice, only read by the draw with VK_KHR_draw_indirect_count
+
+	const PipelineRegistry::Pipeline* _pipeline = nullptr;
+	VkDescriptorPool _descriptorPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> _descriptorSets; // per slice
+};
+
+#endif // !INDIRECT_DRAW_LIST_H
@@ -9,19 +9,39 @@
 #include <hpg/ShaderEffect.h>
 #include <hpg/Renderer.h>
 
+#include <common/CompactVertex.h>
+
 #include <tiny_gltf.h>
 
 #include <array>
 
+// a material as seen by the bindless fragment shader, one element of the model's material buffer (std430)
+struct MaterialParameters {
+	I32 albedoTexture;            // indices into the model's texture array, -1 when the material has no such texture
+	I32 metallicRoughnessTexture;
+	I32 normalTexture;
+	I32 padding;
+};
+
 class Material {
 public:
-	void createPipeline(Renderer& renderer, kDescriptorSetLayout type);
+	// compact vertex meshes use the binding, attributes and vertex shader matching CompactVertex
+	void createPipeline(Renderer& renderer, kDescriptorSetLayout type, kVertexFormat vertexFormat = VERTEX_FORMAT_FULL);
 	void cleanup(VkDevice device);
 
-	VkPipeline _pipeline;
-	VkPipelineLayout _pipelineLayout;
-	VkDescriptorPool _descriptorPool;
-	VkDescriptorSet _descriptorSet;
+	// queues the shared pipeline of a material type, bindless pipelines take the material index as a push constant
+	static const PipelineRegistry::Pipeline* requestPipeline(Renderer& renderer, kDescriptorSetLayout type,
+		kVertexFormat vertexFormat);
+
+	static PipelineRegistry::Pipeline buildPipeline(const Renderer& renderer, const PipelineState& state,
+		VkPipelineCache cache);
+
+	// shared with every material of the same type, owned by the renderer's pipeline registry. The handles
+	// are only valid once the registry has finished building it
+	const PipelineRegistry::Pipeline* _pipeline = nullptr;
+	VkDescriptorPool _descriptorPool = VK_NULL_HANDLE;
+	// null for the materials of a bindless model, which share the model's set
+	VkDescriptorSet _descriptorSet = VK_NULL_HANDLE;
 
 	std::vector<Texture2D> _textures;
 };
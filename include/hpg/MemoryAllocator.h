@@ -0,0 +1,130 @@
+///////////////////////////////////////////////////////
+// MemoryAllocator class declaration
+///////////////////////////////////////////////////////
+
+//
+// A block based device memory allocator. Instead of calling vkAllocateMemory for every buffer and image
+// (which is capped by maxMemoryAllocationCount), memory is requested from the driver in large blocks, one
+// pool of blocks per memory type, and resources are sub-allocated from a block's free list. Buffers and
+// images live in separate pools so that bufferImageGranularity never has to be considered between
+// neighbouring resources. Host visible blocks are persistently mapped for their whole lifetime, so any
+// host visible allocation can be written to directly through its mapped pointer.
+//
+
+#ifndef MEMORY_ALLOCATOR_H
+#define MEMORY_ALLOCATOR_H
+
+#include <common/types.h>
+
+#include <vulkan/vulkan_core.h>
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+// resources sharing a pool, linear resources (buffers) are kept apart from optimally tiled images
+typedef enum {
+	LINEAR_RESOURCE,
+	OPTIMAL_RESOURCE,
+	RESOURCE_TYPE_MAX_ENUM
+} kResourceType;
+
+class MemoryAllocator {
+public:
+	//-Memory sub-allocation---------------------------------------------------------------------------------//
+	class Allocation {
+	public:
+		inline void free() {
+			if (_pAllocator) {
+				_pAllocator->free(*this);
+			}
+		}
+
+		VkDeviceMemory    _memory     = VK_NULL_HANDLE;
+		VkDeviceSize      _offset     = 0;
+		VkDeviceSize      _size       = 0;
+		VkDeviceSize      _alignment  = 1;
+		UC*               _mapped     = nullptr; // null if memory is not host visible
+		UI32              _memoryType = 0;
+		UI32              _block      = 0; // index of the block in its pool, ignored for dedicated allocations
+		kResourceType     _type       = LINEAR_RESOURCE;
+		bool              _dedicated  = false;
+		void*             _pUserData  = nullptr; // optional owner, reported back by defragmentation
+		MemoryAllocator*  _pAllocator = nullptr;
+	};
+
+	//-Usage statistics--------------------------------------------------------------------------------------//
+	struct Statistics {
+		UI32         blockCount      = 0;
+		UI32         dedicatedCount  = 0;
+		UI32         allocationCount = 0;
+		VkDeviceSize reservedBytes   = 0; // bytes requested from the driver
+		VkDeviceSize usedBytes       = 0; // bytes handed out to resources
+		VkDeviceSize heapUsage[VK_MAX_MEMORY_HEAPS]{};
+	};
+
+	//-Defragmentation hooks---------------------------------------------------------------------------------//
+	// a move proposed by the allocator: the owner must copy its contents from src to dst, rebind its resource
+	// to dst and then hand the move back in endDefragmentation, which frees src
+	struct DefragmentationMove {
+		Allocation src;
+		Allocation dst;
+	};
+
+public:
+	//-Initialisation and cleanup----------------------------------------------------------------------------//
+	void init(VkPhysicalDevice physicalDevice, VkDevice device);
+	void cleanup();
+
+	//-Allocation--------------------------------------------------------------------------------------------//
+	Allocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+		kResourceType type, void* pUserData = nullptr);
+	void free(Allocation& allocation);
+
+	Allocation allocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties, void* pUserData = nullptr);
+	Allocation allocateImageMemory(VkImage image, VkMemoryPropertyFlags properties, void* pUserData = nullptr);
+
+	//-Defragmentation---------------------------------------------------------------------------------------//
+	std::vector<DefragmentationMove> beginDefragmentation(UI32 memoryType, kResourceType type, UI32 maxMoves);
+	void endDefragmentation(std::vector<DefragmentationMove>& moves);
+	UI32 releaseEmptyBlocks();
+
+	//-Statistics--------------------------------------------------------------------------------------------//
+	Statistics statistics();
+	void printStatistics();
+
+private:
+	struct Block {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize   size   = 0;
+		VkDeviceSize   used   = 0;
+		UC*            mapped = nullptr;
+		std::map<VkDeviceSize, VkDeviceSize> freeRanges; // offset -> size, neighbours are always merged
+		std::map<VkDeviceSize, Allocation>   allocations; // offset -> live allocation
+	};
+
+	inline UI32 poolIndex(UI32 memoryType, kResourceType type) { return memoryType * RESOURCE_TYPE_MAX_ENUM + type; }
+
+	UI32 findMemoryType(UI32 typeFilter, VkMemoryPropertyFlags properties);
+	VkDeviceSize preferredBlockSize(UI32 memoryType);
+	VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, UI32 memoryType, UC** ppMapped);
+
+	bool allocateFromBlock(Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* pOffset);
+	void freeToBlock(Block& block, VkDeviceSize offset, VkDeviceSize size);
+
+private:
+	VkPhysicalDevice _physicalDevice = VK_NULL_HANDLE;
+	VkDevice         _device         = VK_NULL_HANDLE;
+
+	VkPhysicalDeviceMemoryProperties _memoryProperties{};
+
+	// one pool of blocks per (memory type, resource type) pair
+	std::vector<std::vector<Block>> _pools;
+
+	// allocations too large to share a block get their own device memory
+	std::vector<Allocation> _dedicated;
+
+	std::mutex _mutex;
+};
+
+#endif // !MEMORY_ALLOCATOR_H
@@ -0,0 +1,136 @@
+///////////////////////////////////////////////////////
+// PipelineRegistry class declaration
+///////////////////////////////////////////////////////
+
+//
+// Hands out graphics pipelines shared by everything that needs the same pipeline state. Pipelines are
+// keyed by a hash of the state that determines them (shaders and descriptor set layout, vertex format,
+// render pass and subpass) and only built the first time a state is requested, so any number of
+// materials of the same type share one VkPipeline and VkPipelineLayout. Every pipeline is created
+// through a VkPipelineCache that is loaded from disk on startup and written back on cleanup, which lets
+// the driver skip shader compilation on warm starts. Cache files from another device or driver are
+// ignored. The registry owns the pipelines and destroys them on cleanup.
+//
+// Pipelines are compiled by PIPELINE_BUILD_THREADS worker threads, see the thread budget in JobSystem.h. A
+// request queues the build and returns right away with the entry the pipeline will be written to, so the
+// main thread keeps loading the scene while the driver compiles. Callers wait before recording commands
+// that use a pipeline: waitRequired blocks on everything the first frame draws with, background requests
+// (pipelines needed later, if at all) are only waited on by whoever first uses them. Requests and waits are
+// made from the main thread.
+//
+
+#ifndef PIPELINE_REGISTRY_H
+#define PIPELINE_REGISTRY_H
+
+#include <hpg/VulkanContext.h>
+
+#include <common/types.h>
+
+#include <vulkan/vulkan_core.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// everything a pipeline built by the renderer depends on
+struct PipelineState {
+	UI32         type;         // kDescriptorSetLayout, selects the shaders and the descriptor set layout
+	UI32         vertexFormat; // kVertexFormat
+	VkRenderPass renderPass;
+	UI32         subpass;
+
+	inline bool operator==(const PipelineState& other) const {
+		return type == other.type && vertexFormat == other.vertexFormat && renderPass == other.renderPass &&
+			subpass == other.subpass;
+	}
+};
+
+struct PipelineStateHash {
+	size_t operator()(const PipelineState& state) const;
+};
+
+class PipelineRegistry {
+public:
+	struct Pipeline {
+		VkPipeline       pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout layout   = VK_NULL_HANDLE;
+	};
+
+	// creates the pipeline for a state through the given cache, runs on a worker thread
+	using Builder = std::function<Pipeline(const PipelineState& state, VkPipelineCache cache)>;
+
+public:
+	//-Initialisation and cleanup--------------------------------------------------------------------------------//
+	void init(const VulkanContext* context, const std::string& cachePath);
+	// stops the workers, writes the pipeline cache back to disk and destroys every pipeline. Background builds
+	// that have not started yet are dropped
+	void cleanup();
+
+	//-Pipelines-------------------------------------------------------------------------------------------------//
+	// queues the build of a state's pipeline on first use, the handles are written once the build has finished
+	const Pipeline* request(const std::string& name, const PipelineState& state, const Builder& build,
+		bool background = false);
+	// blocks until a pipeline is built, rethrows the exception of a failed build
+	void wait(const Pipeline* pipeline) const;
+	// blocks until every pipeline requested without the background flag is built
+	void waitRequired() const;
+
+	// for pipelines that are not shared but should still benefit from the cache
+	inline VkPipelineCache cache() const { return _cache; }
+
+	inline size_t pipelineCount() const { return _pipelines.size(); }
+	inline UI32 requestCount() const { return _requests; }
+
+	// build time of every pipeline finished so far
+	void printTimings() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Entry : Pipeline {
+		std::string              name;
+		std::shared_future<void> built;
+		bool                     background = false;
+		F64                      buildTime  = 0.0; // ms spent in the builder
+		Clock::time_point        finished;
+	};
+
+	struct Job {
+		Entry*             entry;
+		PipelineState      state;
+		Builder            build;
+		std::promise<void> done;
+	};
+
+	void work();
+
+	bool isCompatible(const std::vector<UC>& data) const;
+	void save() const;
+
+private:
+	const VulkanContext* _context = nullptr;
+
+	std::string     _cachePath;
+	VkPipelineCache _cache = VK_NULL_HANDLE;
+
+	std::unordered_map<PipelineState, Entry, PipelineStateHash> _pipelines;
+	UI32 _requests = 0;
+	Clock::time_point _firstRequest;
+
+	// build queue, required pipelines are taken before background ones
+	std::vector<std::thread> _workers;
+	std::deque<Job>          _jobs;
+	std::deque<Job>          _backgroundJobs;
+	std::mutex               _mutex;
+	std::condition_variable  _condition;
+	bool                     _stopping = false;
+};
+
+#endif // !PIPELINE_REGISTRY_H
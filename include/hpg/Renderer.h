@@ -10,6 +10,12 @@
 #include <hpg/VulkanContext.h>
 #include <hpg/SwapChain.h>
 #include <hpg/Buffer.h>
+#include <hpg/UploadContext.h>
+#include <hpg/UniformArena.h>
+#include <hpg/PipelineRegistry.h>
+#include <hpg/ShaderLibrary.h>
+#include <hpg/CommandRecorder.h>
+#include <hpg/GpuProfiler.h>
 
 #include <array>
 
@@ -30,8 +36,19 @@ typedef struct {
 typedef struct {
 	glm::mat4 model;
 	glm::mat4 projectionView;
+	glm::vec4 positionOffset; // quantization of compact vertex positions, ignored by full vertices
+	glm::vec4 positionScale;
 } OffscreenUBO;
 
+// passes timed on the gpu, each a scope of the gpu profiler
+typedef enum {
+	GPU_SCOPE_GBUFFER,
+	GPU_SCOPE_SKYBOX,
+	GPU_SCOPE_COMPOSITION,
+	GPU_SCOPE_GUI,
+	GPU_SCOPES_MAX_ENUM
+} kGpuScopes;
+
 typedef enum {
 	RENDER_CMD_POOL,
 	GUI_CMD_POOL,
@@ -82,9 +99,12 @@ typedef enum {
 	OFFSCREEN_PBR_DESCRIPTOR_LAYOUT,
 	OFFSCREEN_PBR_NORMAL_DESCRIPTOR_LAYOUT,
 	OFFSCREEN_PBR_NORMAL_EMISSIVE_DESCRIPTOR_LAYOUT,
+	OFFSCREEN_BINDLESS_DESCRIPTOR_LAYOUT, // every material of a model, only created with descriptor indexing
+	OFFSCREEN_INDIRECT_DESCRIPTOR_LAYOUT, // bindless materials drawn indirectly, shares the bindless layout
 	OFFSCREEN_SKYBOX_DESCRIPTOR_LAYOUT,
 	OFFSCREEN_SHADOWMAP_DESCRIPTOR_LAYOUT,
 	COMPOSITION_DESCRIPTOR_LAYOUT,
+	CULL_DESCRIPTOR_LAYOUT, // compute, only created with indirect draws
 	DESCRIPTOR_SET_LAYOUT_MAX_ENUM
 } kDescriptorSetLayout;
 
@@ -93,9 +113,33 @@ constexpr std::array<std::pair<const char*, const char*>, DESCRIPTOR_SET_LAYOUT_
 	std::pair{ "offscreen_pbr.vert.spv", "offscreen_pbr.frag.spv" },
 	std::pair{ "offscreen_pbr.vert.spv", "offscreen_pbr_normal.frag.spv" },
 	std::pair{ "offscreen_pbr.vert.spv", "offscreen_pbr_normal.frag.spv" },
+	std::pair{ "offscreen_pbr.vert.spv", "offscreen_bindless.frag.spv" },
+	std::pair{ "offscreen_indirect.vert.spv", "offscreen_indirect.frag.spv" },
 	std::pair{ "skybox.vert.spv", "skybox.frag.spv" },
 	std::pair{ "shadowmap.vert.spv", "shadowmap.frag.spv" },
-	std::pair{ "composition.vert.spv", "composition.frag.spv" } };
+	std::pair{ "composition.vert.spv", "composition.frag.spv" },
+	std::pair{ "cull.comp.spv", "" } };
+
+// replaces the vertex shader of offscreen materials drawing meshes made of CompactVertex
+constexpr const char* kCompactVertexShader = "offscreen_pbr_compact.vert.spv";
+
+// bindless material descriptor set bindings, the texture array is sized per set and must come last
+typedef enum {
+	BINDLESS_UNIFORM_BINDING,
+	BINDLESS_MATERIALS_BINDING,
+	BINDLESS_TEXTURES_BINDING
+} kBindlessBinding;
+
+// indirect draw culling descriptor set bindings
+typedef enum {
+	CULL_UNIFORM_BINDING,
+	CULL_RECORDS_BINDING,
+	CULL_COMMANDS_BINDING,
+	CULL_COUNT_BINDING
+} kCullBinding;
+
+// sets allocated from the bindless pool, one per model
+const UI32 MAX_BINDLESS_SETS = 16;
 
 class Renderer {
 	//-Render pass attachment------------------------------------------------------------------------------------//    
@@ -104,11 +148,11 @@ class Renderer {
 		inline void cleanup(VkDevice device) {
 			vkDestroyImageView(device, _view, nullptr);
 			vkDestroyImage(device, _image, nullptr);
-			vkFreeMemory(device, _memory, nullptr);
+			_allocation.free();
 		}
 
 		VkImage _image;
-		VkDeviceMemory _memory;
+		MemoryAllocator::Allocation _allocation;
 		VkImageView _view;
 		VkFormat _format;
 	};
@@ -127,12 +171,13 @@ private:
 	void createFramebuffers();
 	void createAttachment(Attachment& attachment, VkImageUsageFlags usage, VkExtent2D extent, VkFormat format);
 	void createColorSampler();
-	void createCommandBuffers();
+	void createFrameCommandBuffers();
 
 	void createDescriptorPool();
 	void createDescriptorSetLayouts();
 	void createCompositionDescriptorSets();
 	void createCompositionPipeline();
+	PipelineRegistry::Pipeline buildCompositionPipeline(const PipelineState& state, VkPipelineCache cache) const;
 
 	void createGuiRenderPass();
 	void createRenderPass();
@@ -141,20 +186,41 @@ public:
 	// the vulkan context
 	VulkanContext _context;
 
-	// command pools and buffers
+	// command pools of one time commands
 	std::array<VkCommandPool, CMD_POOLS_MAX_ENUM> _commandPools;
-	std::vector<VkCommandBuffer> _renderCommandBuffers;
-	std::vector<VkCommandBuffer> _guiCommandBuffers;
+
+	// transient pools per frame in flight, reset as a whole once the frame's fence has signalled. The frame's
+	// commands are recorded into their buffers again every frame
+	std::array<VkCommandPool, MAX_FRAMES_IN_FLIGHT> _frameCommandPools;
+	std::array<VkCommandBuffer, MAX_FRAMES_IN_FLIGHT> _renderCommandBuffers;
+	std::array<VkCommandBuffer, MAX_FRAMES_IN_FLIGHT> _guiCommandBuffers;
+
+	// secondary command buffers of subpasses recorded over several threads
+	CommandRecorder _recorder;
+
+	// timestamps around the passes of each frame, disabled without device support
+	GpuProfiler _gpuProfiler;
+
+	// resource uploads
+	UploadContext _uploadContext;
 
 	VkDescriptorPool _descriptorPool;
+	// variable sized bindless sets, null without descriptor indexing
+	VkDescriptorPool _bindlessDescriptorPool = VK_NULL_HANDLE;
 	// the base descriptor set layouts used. All descriptor sets are derived from these layouts
 	std::array<VkDescriptorSetLayout, DESCRIPTOR_SET_LAYOUT_MAX_ENUM> _descriptorSetLayouts;
-	// TODO: Change to push constant
-	Buffer _compositionUniforms;
+	// per frame uniforms of the renderer and everything it draws
+	UniformArena _uniformArena;
+	VkDeviceSize _compositionUniformOffset;
 
-	// composition pipeline
-	VkPipelineLayout _compositionPipelineLayout;
-	VkPipeline _compositionPipeline;
+	// every shader module, loaded once
+	ShaderLibrary _shaders;
+
+	// shared pipelines and the on disk pipeline cache
+	PipelineRegistry _pipelines;
+
+	// composition pipeline, owned by the registry and valid once it has been built
+	const PipelineRegistry::Pipeline* _compositionPipeline = nullptr;
 
 	// swap chain
 	SwapChain _swapChain;
@@ -167,7 +233,7 @@ public:
 	std::array<Attachment, GBUFFER_MAX_ENUM> _gbuffer;
 
 	// final render descriptors
-	std::vector<VkDescriptorSet> _compositionDescriptorSets;
+	VkDescriptorSet _compositionDescriptorSet;
 
 	// color sampler
 	VkSampler _colorSampler;
@@ -181,10 +247,7 @@ public:
 	std::vector<VkSemaphore> _renderFinishedSemaphores;
 
 	std::vector<VkFence> _inFlightFences; // 1 fence per frame, CPU-GPU sync
-	std::vector<VkFence> _imagesInFlight;
-
-	UI16 currentFrame = 0;
-	UI32 imageIndex   = 0;
+	std::vector<VkFence> _imagesInFlight; // fence of the frame using each swap chain image, guards its uniform slice
 };
 
 
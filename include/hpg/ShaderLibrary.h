@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////
+// ShaderLibrary class declaration
+///////////////////////////////////////////////////////
+
+//
+// Loads every SPIR-V binary of the shader directory once on startup and keeps a VkShaderModule per file
+// alive until cleanup, so pipelines sharing a shader do not read the file or create the module again.
+// Binaries are checked against the SPIR-V header before a module is created, files that are not valid
+// SPIR-V are reported and left out. Modules are looked up by file name. The library is not modified
+// after init, which lets pipeline builders look modules up from worker threads.
+//
+
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <hpg/VulkanContext.h>
+
+#include <common/types.h>
+
+#include <vulkan/vulkan_core.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// first word of every SPIR-V module
+const UI32 SPIRV_MAGIC = 0x07230203;
+// newest SPIR-V the vulkan 1.0 instance consumes, 1.0 since VK_KHR_spirv_1_4 is not enabled either
+const UI32 SPIRV_MAX_MINOR_VERSION = 0;
+
+class ShaderLibrary {
+public:
+	//-Initialisation and cleanup--------------------------------------------------------------------------------//
+	// creates a module for every .spv file in the directory
+	void init(const VulkanContext* context, const std::string& directory);
+	void cleanup();
+
+	//-Modules---------------------------------------------------------------------------------------------------//
+	// the module created from a file of the shader directory, throws if there is none
+	VkShaderModule get(const std::string& name) const;
+
+	// whether a valid module was loaded from the file, for features that fall back when a binary is missing
+	inline bool has(const std::string& name) const { return _modules.count(name) != 0; }
+
+	inline size_t moduleCount() const { return _modules.size(); }
+
+	// checks the header of a SPIR-V binary, returns a description of the problem or nullptr if it is valid
+	static const char* validate(const std::vector<UI32>& code);
+
+private:
+	const VulkanContext* _context = nullptr;
+
+	std::string _directory;
+
+	std::unordered_map<std::string, VkShaderModule> _modules;
+};
+
+#endif // !SHADER_LIBRARY_H
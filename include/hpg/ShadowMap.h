@@ -18,7 +18,7 @@ public:
 		glm::mat4 depthMVP;
 	};
 	//-Initialisation and cleanup--------------------------------------------------------------------------------//
-	void createShadowMap(const Renderer& renderer);
+	void createShadowMap(Renderer& renderer);
 	void cleanupShadowMap(VkDevice device);
 
 	void createAttachment(const Renderer& renderer);
@@ -29,15 +29,19 @@ public:
 
 	void createShadowMapSampler();
 
-	void createShadowMapPipeline(VkDescriptorSetLayout descriptorSetLayout);
+	void createShadowMapPipeline(Renderer& renderer);
 
-	void updateShadowMapUniformBuffer(const UBO& ubo);
+	static PipelineRegistry::Pipeline buildPipeline(const Renderer& renderer, const PipelineState& state,
+		VkPipelineCache cache);
+
+	void updateShadowMapUniformBuffer(UniformArena& arena, UI32 currentImage, const UBO& ubo);
 
 public:
 	VulkanContext* vkSetup;
 
 	// an image representing the depth seen from the light's perspective, to be sampled
-	Image		image;
+	VkImage		image;
+	MemoryAllocator::Allocation imageAllocation;
 	VkFormat    format = VK_FORMAT_D16_UNORM;
 	//VkFormat    format = VK_FORMAT_D32_SFLOAT;
 	VkImageView imageView;
@@ -51,10 +55,11 @@ public:
 
 	VkFramebuffer shadowMapFrameBuffer;
 
-	VkPipelineLayout layout;
-	VkPipeline shadowMapPipeline;
+	// owned by the renderer's pipeline registry, built in the background
+	const PipelineRegistry::Pipeline* pipeline = nullptr;
 
-	Buffer shadowMapUniformBuffer;
+	// offset of the light's uniforms within each uniform arena slice
+	VkDeviceSize uniformOffset = 0;
 };
 
 #endif // !SHADOW_MAP_H
\ No newline at end of file
@@ -81,7 +81,10 @@ public:
   
 	bool load(const std::string& path);
 	bool uploadToGpu(Renderer& renderer);
-	void draw(VkCommandBuffer cmdBuffer);
+	void draw(VkCommandBuffer cmdBuffer, UI32 dynamicOffset);
+
+	static PipelineRegistry::Pipeline buildPipeline(const Renderer& renderer, const PipelineState& state,
+		VkPipelineCache cache);
 
 	void cleanup(VkDevice device);
 
@@ -94,13 +97,14 @@ public:
 	// descriptors
 	TextureCube _cubeMap;
 
-	Buffer _uniformBuffer;
+	// offset of the skybox uniforms within each uniform arena slice
+	VkDeviceSize _uniformOffset = 0;
 
 	VkDescriptorPool _descriptorPool;
 	VkDescriptorSet _descriptorSet;
 
-	VkPipelineLayout _pipelineLayout;
-	VkPipeline _pipeline;
+	// owned by the renderer's pipeline registry, valid once it has been built
+	const PipelineRegistry::Pipeline* _pipeline = nullptr;
 
 	Buffer _vertexBuffer;
 
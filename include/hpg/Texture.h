@@ -17,23 +17,23 @@
 
 class Texture {
 public:
-    Texture() : _onGpu(false), _image(nullptr), _memory(nullptr), _imageView(nullptr), _sampler(nullptr) {}
+    Texture() : _onGpu(false), _image(nullptr), _allocation{}, _imageView(nullptr), _sampler(nullptr) {}
 
-    virtual bool uploadToGpu(const Renderer& renderer, const ImageData& imageData) = 0;
+    virtual bool uploadToGpu(Renderer& renderer, const ImageData& imageData) = 0;
 
     inline void cleanup(VkDevice device) {
         if (_onGpu) {
             vkDestroySampler(device, _sampler, nullptr);
             vkDestroyImageView(device, _imageView, nullptr);
             vkDestroyImage(device, _image, nullptr);
-            vkFreeMemory(device, _memory, nullptr);
+            _allocation.free();
         }
     }
 
     bool _onGpu;
 
     VkImage _image;
-    VkDeviceMemory _memory;
+    MemoryAllocator::Allocation _allocation;
     VkImageView _imageView;
     VkSampler _sampler;
 };
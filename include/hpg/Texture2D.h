@@ -13,7 +13,9 @@
 
 class Texture2D : public Texture {
 public:
-    bool uploadToGpu(const Renderer& renderer, const ImageData& imageData);
+    bool uploadToGpu(Renderer& renderer, const ImageData& imageData);
+    // pixels hold the whole mip chain, level i starting at pMipOffsets[i]
+    bool uploadToGpu(Renderer& renderer, const ImageData& imageData, UI32 mipLevels, const VkDeviceSize* pMipOffsets);
 };
 
 #endif // !TEXTURE2D_H
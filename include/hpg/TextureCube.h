@@ -13,7 +13,7 @@
 
 class TextureCube : public Texture {
 public:
-    bool uploadToGpu(const Renderer& renderer, const ImageData& imageData);
+    bool uploadToGpu(Renderer& renderer, const ImageData& imageData);
 };
 
 #endif // !TEXTURECUBE_H
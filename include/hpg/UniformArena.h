@@ -0,0 +1,62 @@
+///////////////////////////////////////////////////////
+// UniformArena class declaration
+///////////////////////////////////////////////////////
+
+//
+// A single host visible uniform buffer, persistently mapped, that holds the uniform data of every
+// object drawn. The buffer is split into equally sized slices, one per command buffer that can be in
+// flight. An object reserves a range once, at the same offset in every slice, and its descriptor set
+// points at that range in the first slice. Descriptors use the dynamic uniform buffer type so that
+// the slice is selected with a dynamic offset when the set is bound. Updating uniforms each frame is
+// then a plain memcpy into the current slice, with no map or unmap call.
+//
+
+#ifndef UNIFORM_ARENA_H
+#define UNIFORM_ARENA_H
+
+#include <hpg/Buffer.h>
+
+#include <common/types.h>
+
+#include <vulkan/vulkan_core.h>
+
+#include <cstring>
+
+// room for the uniforms of a single slice
+const VkDeviceSize UNIFORM_ARENA_SLICE_SIZE = 64 * 1024;
+
+class UniformArena {
+public:
+	//-Initialisation and cleanup--------------------------------------------------------------------------------//
+	void init(const VulkanContext* context, VkDeviceSize sliceSize, UI32 sliceCount);
+	void cleanup(VkDevice device);
+
+	//-Reservations----------------------------------------------------------------------------------------------//
+	// reserves a range in every slice, aligned to minUniformBufferOffsetAlignment, returns its offset in a slice
+	VkDeviceSize reserve(VkDeviceSize size);
+	// descriptor info for a range in the first slice, to be used with a dynamic uniform buffer descriptor
+	VkDescriptorBufferInfo descriptorInfo(VkDeviceSize offset, VkDeviceSize range) const;
+
+	//-Per frame access------------------------------------------------------------------------------------------//
+	inline UI32 dynamicOffset(UI32 slice) const { return static_cast<UI32>(slice * _sliceSize); }
+
+	inline UC* data(UI32 slice, VkDeviceSize offset) const { return _buffer.mapped() + slice * _sliceSize + offset; }
+
+	template<typename T>
+	inline void write(UI32 slice, VkDeviceSize offset, const T& uniforms) {
+		memcpy(data(slice, offset), &uniforms, sizeof(T));
+	}
+
+	inline UI32 sliceCount() const { return _sliceCount; }
+
+private:
+	Buffer _buffer;
+
+	VkDeviceSize _sliceSize = 0;
+	UI32         _sliceCount = 0;
+
+	VkDeviceSize _alignment = 0;
+	VkDeviceSize _used = 0;
+};
+
+#endif // !UNIFORM_ARENA_H
@@ -0,0 +1,105 @@
+///////////////////////////////////////////////////////
+// UploadContext class declaration
+///////////////////////////////////////////////////////
+
+//
+// Collects host to device copies and the layout transitions that go with them into a single batch
+// that is submitted at once, instead of submitting and waiting on the queue for every operation.
+// Source data is written to a persistently mapped staging ring buffer allocated once at startup.
+// When the device exposes a dedicated transfer queue the copies are recorded on it and ownership of
+// the resources is released to the graphics queue family, which acquires them in a second command
+// buffer that waits on the transfer submission with a semaphore. Each batch signals a fence and the
+// ring region it used is only reclaimed once that fence has been signalled, if the ring is full the
+// current batch is submitted and the oldest one waited on. Uploads larger than half the ring are
+// streamed through it in chunks (buffer ranges, or rows of each image layer). Since the acquire
+// barriers are recorded on the graphics queue, work submitted to it after a flush is correctly
+// ordered without the host having to wait.
+//
+
+#ifndef UPLOAD_CONTEXT_H
+#define UPLOAD_CONTEXT_H
+
+#include <hpg/Buffer.h>
+
+#include <common/types.h>
+
+#include <vulkan/vulkan_core.h>
+
+#include <vector>
+
+// size of the staging ring, uploads larger than half of it are split into chunks
+const VkDeviceSize STAGING_RING_SIZE = 32ull * 1024ull * 1024ull;
+
+class UploadContext {
+	//-Upload batch----------------------------------------------------------------------------------------------//
+	struct Batch {
+		VkCommandBuffer     transferCommandBuffer = VK_NULL_HANDLE; // only used with a dedicated transfer queue
+		VkCommandBuffer     graphicsCommandBuffer = VK_NULL_HANDLE;
+		VkSemaphore         transferComplete      = VK_NULL_HANDLE;
+		VkFence             fence                 = VK_NULL_HANDLE;
+		VkDeviceSize        ringEnd               = 0; // ring position reclaimed once the fence is signalled
+		UI32                operationCount        = 0;
+	};
+
+public:
+	//-Initialisation and cleanup--------------------------------------------------------------------------------//
+	void init(const VulkanContext* context);
+	void cleanup();
+
+	//-Recording uploads-----------------------------------------------------------------------------------------//
+	// usage of the destination buffer determines which stages and accesses the copy is made visible to
+	void uploadBuffer(VkBuffer dst, VkBufferUsageFlags usage, const void* data, VkDeviceSize size,
+		VkDeviceSize dstOffset = 0);
+	// the whole subresource range is transitioned to transfer dst then shader read only, regions must be
+	// tightly packed and use an uncompressed format
+	void uploadImage(VkImage dst, const VkImageSubresourceRange& range, const void* data, VkDeviceSize size,
+		const std::vector<VkBufferImageCopy>& regions);
+
+	//-Submission------------------------------------------------------------------------------------------------//
+	// submits the recorded batch, returns without waiting on the device
+	void flush();
+	// releases staging memory of the batches that have completed
+	void collect();
+	// blocks until every submitted batch has completed
+	void waitIdle();
+
+	inline bool hasDedicatedTransferQueue() const { return _transferFamily != _graphicsFamily; }
+
+private:
+	Batch& currentBatch();
+	Batch createBatch();
+	void destroyBatch(Batch& batch);
+
+	// returns an offset into the staging ring, flushes and waits on older batches if there is no room
+	VkDeviceSize reserve(VkDeviceSize size, VkDeviceSize alignment);
+	bool tryReserve(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* pOffset);
+	inline VkDeviceSize maxChunkSize() const { return _ringSize / 2; }
+
+	void recordBufferCopy(VkDeviceSize srcOffset, VkBuffer dst, VkDeviceSize dstOffset, VkDeviceSize size,
+		VkBufferUsageFlags usage);
+
+	static void bufferUsageToAccess(VkBufferUsageFlags usage, VkAccessFlags* pAccess, VkPipelineStageFlags* pStages);
+
+private:
+	const VulkanContext* _context = nullptr;
+
+	UI32 _graphicsFamily = 0;
+	UI32 _transferFamily = 0;
+
+	VkCommandPool _graphicsCommandPool = VK_NULL_HANDLE;
+	VkCommandPool _transferCommandPool = VK_NULL_HANDLE;
+
+	bool               _recording = false;
+	Batch              _current;
+	std::vector<Batch> _inFlight; // submitted, waiting on their fence
+	std::vector<Batch> _free; // completed batches kept for reuse
+
+	// staging ring, head and tail are monotonically increasing, physical offsets are taken modulo the size
+	Buffer       _ring;
+	VkDeviceSize _ringSize = 0;
+	VkDeviceSize _head     = 0;
+	VkDeviceSize _tail     = 0;
+	VkDeviceSize _copyAlignment = 4;
+};
+
+#endif // !UPLOAD_CONTEXT_H
@@ -20,6 +20,9 @@
 // constants and structs
 #include <common/utils.h>
 
+// device memory sub-allocation
+#include <hpg/MemoryAllocator.h>
+
 // vulkan definitions
 #include <vulkan/vk_platform.h>
 #include <vulkan/vulkan_core.h>
@@ -68,7 +71,10 @@ private:
     //-Vulkan devices--------------------------------------------------------------------------------------------//
     void pickPhysicalDevice();
     bool isDeviceSuitable(VkPhysicalDevice device);
-    bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+    bool checkDeviceExtensionSupport(VkPhysicalDevice device, 
+        const std::vector<const char*>& extensions = deviceExtensions);
+    void queryDescriptorIndexing();
+    void queryIndirectDraws();
     void createLogicalDevice();
 
 
@@ -86,10 +92,30 @@ public:
     VkDevice         device;
     VkQueue          graphicsQueue;
     VkQueue          presentQueue;
+    VkQueue          transferQueue;
+
+    utils::QueueFamilyIndices queueFamilyIndices;
 
     SwapChainSupportDetails  _swapChainSupportDetails;
 
     VkPhysicalDeviceProperties deviceProperties;
+
+    // bindless materials: a partially bound, variable sized array of textures indexed in the shader
+    bool descriptorIndexing = false;
+    UI32 maxBindlessTextures = 0;
+
+    // gpu driven draws: multi draw indirect with a first instance, and a draw count read from a buffer if the
+    // device has VK_KHR_draw_indirect_count
+    bool indirectDraws = false;
+    bool drawIndirectCount = false;
+    PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount = nullptr;
+
+    // mutable so that resources can be created through a const context
+    mutable MemoryAllocator allocator;
+
+private:
+    // extended feature queries on a vulkan 1.0 instance
+    bool _physicalDeviceProperties2 = false;
 };
 
 #endif // !VULKAN_CONTEXT_H
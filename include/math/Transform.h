@@ -2,16 +2,35 @@
 // Transform class
 ///////////////////////////////////////////////////////
 
+//
+// A translation, rotation and scale, applied in the order scale, rotation then translation.
+//
+
 #ifndef TRANSFORM_H
 #define TRANSFORM_H
 
-#include <hpg/Image.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 class Transform {
 public:
-	glm::vec3 position;
+	Transform(const glm::vec3& position = glm::vec3(0.0f), const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+		const glm::vec3& scale = glm::vec3(1.0f)) : position(position), rotation(rotation), scale(scale) {}
+
+	// translation * rotation * scale, without building each matrix
+	inline glm::mat4 matrix() const {
+		glm::mat4 matrix = glm::mat4_cast(rotation);
+		matrix[0] *= scale.x;
+		matrix[1] *= scale.y;
+		matrix[2] *= scale.z;
+		matrix[3] = glm::vec4(position, 1.0f);
+		return matrix;
+	}
 
+public:
+	glm::vec3 position;
+	glm::quat rotation;
+	glm::vec3 scale;
 };
 
 #endif // !TRANSFORM_H
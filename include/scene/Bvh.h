@@ -0,0 +1,106 @@
+///////////////////////////////////////////////////////
+// Bvh class declaration
+///////////////////////////////////////////////////////
+
+//
+// A bounding volume hierarchy over axis aligned boxes, used to cull the primitives of a scene against the
+// view frustum on the CPU. The tree is built top down with a binned surface area heuristic and stored
+// depth first in a single array: the left child of a node directly follows it and the items below any node
+// are contiguous, so a node entirely inside the frustum hands all of its items out without visiting its
+// children. Frustum planes are kept in structure of arrays form so that a box is tested against four planes
+// at once with SSE, a scalar path is used on other targets. Boxes live in the space the frustum is extracted
+// in, extracting it from projection * view * model culls model space boxes without rebuilding the tree when
+// the model moves.
+//
+
+#ifndef BVH_H
+#define BVH_H
+
+#include <common/types.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BVH_SSE
+#endif
+
+struct Aabb {
+	glm::vec3 min = glm::vec3(0.0f);
+	glm::vec3 max = glm::vec3(0.0f);
+
+	inline glm::vec3 centre() const { return (min + max) * 0.5f; }
+	inline glm::vec3 extent() const { return (max - min) * 0.5f; }
+
+	inline F32 area() const {
+		glm::vec3 size = max - min;
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	inline void grow(const Aabb& other) {
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+};
+
+typedef enum {
+	FRUSTUM_OUTSIDE,
+	FRUSTUM_INTERSECTS,
+	FRUSTUM_INSIDE
+} kFrustumTest;
+
+// the six planes of a view frustum, padded to eight with planes that contain everything
+struct Frustum {
+	alignas(16) F32 x[8];
+	alignas(16) F32 y[8];
+	alignas(16) F32 z[8];
+	alignas(16) F32 w[8];
+
+	// planes of a projection with a [0, 1] depth range, in the space the matrix transforms from
+	static Frustum fromMatrix(const glm::mat4& matrix);
+
+	kFrustumTest test(const Aabb& box) const;
+};
+
+// counters of a cull, summed over calls
+struct BvhCullStats {
+	UI64 nodesVisited  = 0;
+	UI64 boxesTested   = 0;
+	UI64 itemsAccepted = 0;
+};
+
+class Bvh {
+public:
+	// items in a leaf, leaves are only split further when the heuristic finds it cheaper
+	static const UI32 MAX_LEAF_ITEMS = 4;
+
+	struct Node {
+		Aabb bounds;
+		UI32 firstItem;  // into items(), the items of a node's subtree are contiguous
+		UI32 itemCount;
+		UI32 rightChild; // 0 for leaves, the left child is the next node
+	};
+
+public:
+	//-Construction----------------------------------------------------------------------------------------------//
+	// builds the tree over the boxes, items are indices into the array
+	void build(const std::vector<Aabb>& boxes);
+
+	//-Culling---------------------------------------------------------------------------------------------------//
+	// appends the items whose boxes are not outside the frustum to pVisible, in no particular order
+	void cull(const Frustum& frustum, std::vector<UI32>* pVisible, BvhCullStats* pStats = nullptr) const;
+
+	inline const std::vector<Node>& nodes() const { return _nodes; }
+	inline const std::vector<UI32>& items() const { return _items; }
+
+private:
+	UI32 buildNode(const std::vector<Aabb>& boxes, const std::vector<glm::vec3>& centres, UI32 first, UI32 count);
+
+private:
+	std::vector<Node> _nodes;
+	std::vector<UI32> _items;
+	std::vector<Aabb> _itemBoxes; // boxes of _items, in the same order
+};
+
+#endif // !BVH_H
@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////
+// CookedAsset class declaration
+///////////////////////////////////////////////////////
+
+//
+// A versioned binary container for models converted offline by the asset cooker. It holds vertices
+// already in the Vertex layout, 32 bit indices, primitive ranges, material records and RGBA8 textures
+// with their full mip chain. Sections are listed in a table after the header and aligned so that they
+// can be read in place: the file is memory mapped and each section is handed to the upload context as
+// is, with no parsing, decoding or repacking at load time. Files written with a different version or
+// vertex layout are rejected and must be cooked again.
+//
+
+#ifndef COOKED_ASSET_H
+#define COOKED_ASSET_H
+
+#include <common/MappedFile.h>
+#include <common/Vertex.h>
+#include <common/types.h>
+
+#include <vulkan/vulkan_core.h>
+
+#include <string>
+#include <vector>
+
+const UI32 COOKED_ASSET_MAGIC   = 0x41435256; // "VRCA"
+const UI32 COOKED_ASSET_VERSION = 2; // 2: indices are absolute within the model
+
+// extension given to cooked files
+const char* const COOKED_ASSET_EXTENSION = ".vrasset";
+
+// deepest mip chain stored for a texture, enough for 32K textures
+const UI32 COOKED_MAX_MIP_LEVELS = 16;
+
+typedef enum {
+	COOKED_VERTICES,
+	COOKED_INDICES,
+	COOKED_PRIMITIVES,
+	COOKED_MATERIALS,
+	COOKED_TEXTURES,
+	COOKED_TEXTURE_DATA,
+	COOKED_SECTION_MAX_ENUM
+} kCookedSection;
+
+struct CookedHeader {
+	UI32 magic;
+	UI32 version;
+	UI32 vertexSize; // sizeof(Vertex) when cooked
+	UI32 sectionCount;
+};
+
+struct CookedSection {
+	UI32 type;
+	UI32 count; // number of elements
+	UI64 offset; // from the start of the file
+	UI64 size;
+};
+
+struct CookedPrimitive {
+	UI32 firstIndex;
+	UI32 indexCount;
+	UI32 firstVertex;
+	UI32 vertexCount;
+	I32  material;
+};
+
+// indices into the texture section, -1 when the material has no such texture
+struct CookedMaterial {
+	I32 albedo;
+	I32 metallicRoughness;
+	I32 normal;
+	I32 emissive;
+};
+
+struct CookedTexture {
+	UI32         width;
+	UI32         height;
+	UI32         mipLevels;
+	VkFormat     format;
+	VkDeviceSize offset; // into the texture data section
+	VkDeviceSize size; // of the whole mip chain
+	VkDeviceSize mipOffsets[COOKED_MAX_MIP_LEVELS]; // relative to the texture's offset
+};
+
+class CookedAsset {
+public:
+	// everything a cooked file holds, filled in by the cooker
+	struct Contents {
+		std::vector<Vertex>          vertices;
+		std::vector<UI32>            indices;
+		std::vector<CookedPrimitive> primitives;
+		std::vector<CookedMaterial>  materials;
+		std::vector<CookedTexture>   textures;
+		std::vector<UC>              textureData;
+	};
+
+public:
+	//-Writing---------------------------------------------------------------------------------------------------//
+	static bool write(const std::string& path, const Contents& contents);
+
+	//-Reading---------------------------------------------------------------------------------------------------//
+	bool open(const std::string& path);
+	void close();
+
+	inline bool isOpen() const { return _file.isOpen(); }
+
+	// pointer to a section read in place, pCount receives its element count
+	template<typename T>
+	inline const T* section(kCookedSection type, UI32* pCount) const {
+		*pCount = _sections[type].count;
+		return reinterpret_cast<const T*>(_file.data() + _sections[type].offset);
+	}
+	inline UI64 sectionSize(kCookedSection type) const { return _sections[type].size; }
+
+	inline const UC* textureData(const CookedTexture& texture) const {
+		return _file.data() + _sections[COOKED_TEXTURE_DATA].offset + texture.offset;
+	}
+
+	static bool hasExtension(const std::string& path);
+
+private:
+	MappedFile    _file;
+	CookedSection _sections[COOKED_SECTION_MAX_ENUM]{};
+};
+
+#endif // !COOKED_ASSET_H
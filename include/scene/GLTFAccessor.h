@@ -0,0 +1,74 @@
+///////////////////////////////////////////////////////
+// GLTFAccessor class declaration
+///////////////////////////////////////////////////////
+
+//
+// Decodes the elements of a glTF accessor straight into a destination layout. The accessor is resolved
+// once (buffer pointer, byte stride, component type, sparse substitutions) and can then be decoded in
+// disjoint element ranges from several threads. Integer components are converted to floats, using the
+// glTF rules for normalized types, and sparse values override the elements of the base buffer view (or
+// zeros when the accessor has none).
+//
+
+#ifndef GLTF_ACCESSOR_H
+#define GLTF_ACCESSOR_H
+
+#include <common/types.h>
+
+#include <tiny_gltf.h>
+
+#include <vector>
+
+class GLTFAccessor {
+public:
+	GLTFAccessor() = default;
+	// buffers holds the base pointer of each of the model's buffers, which may live outside of the tinygltf model
+	GLTFAccessor(const tinygltf::Model& model, I32 accessor, const std::vector<const UC*>& buffers);
+
+	// writes components [firstComponent, firstComponent + componentCount) of elements [begin, end) as floats,
+	// consecutive components are written contiguously, elements are dstStride bytes apart
+	void decodeFloats(UI64 begin, UI64 end, F32* dst, UI64 dstStride, UI32 firstComponent,
+		UI32 componentCount) const;
+
+	// writes scalar elements [begin, end) as 32 bit indices, tightly packed 32 bit data is memcpy'd, the
+	// component type must be checked with isIndexType beforehand
+	void decodeIndices(UI64 begin, UI64 end, UI32* dst) const;
+
+	// the elements are tightly packed floats that can be read directly from the buffer
+	inline bool isPackedFloat() const {
+		return _data && !isSparse() && _componentType == TINYGLTF_COMPONENT_TYPE_FLOAT;
+	}
+	inline bool isSparse() const { return !_sparseIndices.empty(); }
+	inline bool isIndexType() const {
+		return _components == 1 && (_componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE ||
+			_componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT ||
+			_componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT);
+	}
+
+	inline const UC* data() const { return _data; }
+	inline UI64 stride() const { return _stride; }
+	inline UI64 count() const { return _count; }
+	inline UI32 components() const { return _components; }
+
+private:
+	F32 component(const UC* element, UI32 c) const;
+	UI32 index(const UC* element) const;
+
+	// element to read at index i, either from the sparse values or the base buffer view
+	const UC* element(UI64 i, size_t* pNextSparse) const;
+
+private:
+	const UC* _data          = nullptr; // null if the accessor has no buffer view
+	UI64      _stride        = 0;
+	UI64      _count         = 0;
+	I32       _componentType = TINYGLTF_COMPONENT_TYPE_FLOAT;
+	UI32      _components    = 0;
+	UI32      _componentSize = 0;
+	bool      _normalized    = false;
+
+	// sparse substitutions, indices are strictly increasing
+	std::vector<UI32> _sparseIndices;
+	const UC*         _sparseValues = nullptr;
+};
+
+#endif // !GLTF_ACCESSOR_H
@@ -8,8 +8,14 @@
 #include <hpg/Buffer.h>
 #include <hpg/Renderer.h>
 #include <hpg/Material.h>
+#include <hpg/IndirectDrawList.h>
 
 #include <common/Vertex.h>
+#include <common/CompactVertex.h>
+#include <common/MappedFile.h>
+
+#include <scene/CookedAsset.h>
+#include <scene/Bvh.h>
 
 #include <glm/glm.hpp>
 
@@ -37,32 +43,128 @@ typedef enum {
 
 
 class GLTFModel {
+public:
+	// a triangle list primitive, a contiguous range of the model's vertex and index arrays. Primitives are
+	// grouped by material and their indices are absolute within the model
+	struct Primitive {
+		UI32 firstIndex;
+		UI32 indexCount;
+		UI32 firstVertex;
+		UI32 vertexCount;
+		I32  material;
+		Aabb bounds;     // of the primitive's vertices, in model space
+	};
+
+	// one indexed draw of one or more primitives, built once the materials are known
+	struct DrawRecord {
+		UI64 key;        // pipeline, then material, then first index
+		UI32 firstIndex;
+		UI32 indexCount;
+		UI32 material;   // resolved, primitives without a material use the default
+		UI32 primitive;  // first primitive of the draw
+	};
+
 public:
 	GLTFModel() : onCpu(false), onGpu(false) {}
 
+	// accepts .gltf and .glb files, geometry buffers are memory mapped rather than copied into the tinygltf model,
+	// and cooked assets which stay mapped until they are uploaded
 	bool load(const std::string& path);
 
 	bool uploadToGpu(Renderer& renderer);
 	bool cleanup(Renderer& renderer);
 
-	void draw(VkCommandBuffer buffer);
-
-	// model data from tinygltf model
+	// culls the primitives against the frustum of clip = projection * view * model and rebuilds the draws from
+	// the visible ones, returns true when they changed. Indirect models cull on the gpu
+	bool updateVisibility(const glm::mat4& clip);
+
+	// culls the draws of an indirect model on the gpu, recorded outside of the render pass before draw
+	void cull(VkCommandBuffer buffer, UI32 slice, UI32 dynamicOffset);
+	// dynamic offset selects the uniform arena slice of the frame being recorded. Records draws [firstDraw,
+	// firstDraw + drawCount) of drawCount(), binding all the state they need, so ranges can go to different
+	// secondary command buffers
+	void draw(VkCommandBuffer buffer, UI32 slice, UI32 dynamicOffset, UI32 firstDraw = 0,
+		UI32 drawCount = UINT32_MAX);
+	// draws recorded by draw, a single one for indirect models
+	inline UI32 drawCount() const { return _indirect ? 1 : static_cast<UI32>(_draws.size()); }
+
+	// model data from tinygltf model, buffers that were memory mapped during load are left empty
 	tinygltf::Model _model;
 
 	std::vector<Vertex> _vertices;
 	std::vector<UI32> _indices;
+	std::vector<Primitive> _primitives;
+
+	// a record per primitive sorted by state, and the draws recorded from the visible ones, merged where contiguous
+	std::vector<DrawRecord> _drawRecords;
+	std::vector<DrawRecord> _draws;
+
+	// hierarchy over the bounds of the primitives, and whether each primitive passed the last cull
+	Bvh _bvh;
+	std::vector<UC> _visible;
+	std::vector<UI32> _visiblePrimitives; // scratch of updateVisibility, kept to reuse its storage
+
+	// layout of the vertex buffer, chosen before uploading, compact vertices are quantized in the model's bounds
+	kVertexFormat _vertexFormat = VERTEX_FORMAT_FULL;
+	VertexQuantization _quantization;
 
 	// data for rendering model
 	std::vector<Material> _materials;
 
+	// with descriptor indexing, materials are indices into a parameter buffer and a texture array that every
+	// primitive reads through one descriptor set and pipeline
+	bool _bindless = false;
+	const PipelineRegistry::Pipeline* _bindlessPipeline = nullptr;
+	VkDescriptorSet _bindlessDescriptorSet = VK_NULL_HANDLE;
+	Buffer _materialBuffer;
+
+	// bindless models are culled and drawn by the gpu when the device supports indirect draws, with a single
+	// indirect draw per frame
+	bool _indirect = false;
+	IndirectDrawList _indirectDraws;
+
 	Buffer _vertexBuffer;
 	Buffer _indexBuffer;
 	
-	Buffer _uniformBuffer;
+	// offset of the model's uniforms within each uniform arena slice
+	VkDeviceSize _uniformOffset = 0;
+
+	// open between loading a cooked asset and uploading it, vertices and indices are read from it in place
+	CookedAsset _cooked;
 
 	bool onCpu;
 	bool onGpu;
+
+private:
+	// textures of a material, in descriptor binding order
+	struct MaterialSource {
+		kDescriptorSetLayout type;
+		UI32                 textureCount;
+		ImageData            images[4];
+		UI32                 mipLevels[4];
+		const VkDeviceSize*  mipOffsets[4];
+	};
+
+	bool loadCooked(const std::string& path);
+	// bounds of every primitive and the hierarchy over them, once the vertices are known
+	void buildBounds(const Vertex* vertices);
+
+	MaterialSource gltfMaterialSource(UI32 material) const;
+	MaterialSource cookedMaterialSource(UI32 material) const;
+
+	void buildDrawRecords();
+	// draw records with the bounding sphere of each primitive, for culling on the gpu
+	std::vector<IndirectDrawRecord> indirectDrawRecords() const;
+	// copies the visible records into _draws and merges neighbours with the same state over contiguous indices
+	void batchDraws();
+
+	// material parameters, texture array and uniforms of a bindless model
+	void createBindlessDescriptors(Renderer& renderer, const std::vector<MaterialSource>& sources);
+
+	// parses the json with tinygltf, pBufferData receives the base pointer of each buffer, either into one of
+	// the returned mappings or into the tinygltf model. Only data uri buffers are copied, images embedded in a
+	// mapped buffer are copied on their own. False on malformed buffer views
+	bool parse(const std::string& path, std::vector<MappedFile>* pMappedFiles, std::vector<const UC*>* pBufferData);
 };
 
 #endif // !GLTF_MODEL_H
@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////
+// Mesh optimization functions
+///////////////////////////////////////////////////////
+
+//
+// Index and vertex buffer reordering run on meshes when they are loaded or cooked. Triangles are
+// reordered so that their vertices are reused while they are still in the GPU's post-transform cache,
+// clusters of triangles are then sorted so that outward facing parts of the mesh are drawn first to
+// reduce overdraw, and finally vertices are moved into the order in which the indices first fetch them.
+// None of the passes change what is drawn. A FIFO cache simulator reports the average cache miss ratio
+// (ACMR, transformed vertices per triangle) and average transform to vertex ratio (ATVR, transformed
+// vertices per unique vertex) so that the passes can be measured without a GPU.
+//
+
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <common/types.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace mesh {
+
+    // number of entries in the modelled post-transform cache, a reasonable fit for current hardware
+    const UI32 VERTEX_CACHE_SIZE = 32;
+
+    // clusters may be up to this much worse than their tipsified order when split for overdraw sorting
+    const F32 OVERDRAW_THRESHOLD = 1.05f;
+
+    //-Vertex cache----------------------------------------------------------------------------------------------//
+
+    // reorders the triangles of a triangle list in place following Forsyth's linear speed vertex cache
+    // optimisation, indices must be smaller than vertexCount
+    void optimizeVertexCache(UI32* indices, size_t indexCount, size_t vertexCount);
+
+    // reorders the triangles of a triangle list in place with Sander et al.'s Tipsify, which is faster than
+    // Forsyth's method and tuned to a cache size. pClusters, if not null, receives the first triangle of each
+    // run of triangles started after the cache was flushed, which are the hard boundaries used by optimizeOverdraw
+    void tipsify(UI32* indices, size_t indexCount, size_t vertexCount, UI32 cacheSize,
+        std::vector<UI32>* pClusters);
+
+    //-Overdraw--------------------------------------------------------------------------------------------------//
+
+    // splits the clusters of a tipsified triangle list where doing so costs at most threshold times the cluster's
+    // cache miss ratio, then sorts them so that the clusters facing away from the mesh's centre come first.
+    // positions are read as three floats positionStride bytes apart
+    void optimizeOverdraw(UI32* indices, size_t indexCount, const F32* positions, size_t positionStride,
+        const std::vector<UI32>& clusters, UI32 cacheSize, F32 threshold);
+
+    //-Vertex fetch----------------------------------------------------------------------------------------------//
+
+    // builds the remap table that moves vertices into the order they are first referenced, rewriting indices in
+    // place, vertices that are never referenced are moved to the end
+    void optimizeVertexFetchRemap(UI32* remap, UI32* indices, size_t indexCount, size_t vertexCount);
+
+    // moves each vertex to remap[vertex]
+    template<typename T>
+    inline void remapVertices(T* vertices, size_t vertexCount, const UI32* remap) {
+        std::vector<T> remapped(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            remapped[remap[v]] = vertices[v];
+        }
+        for (size_t v = 0; v < vertexCount; v++) {
+            vertices[v] = remapped[v];
+        }
+    }
+
+    //-Analysis--------------------------------------------------------------------------------------------------//
+
+    // transform counts of a simulated FIFO post-transform cache, summable over several meshes
+    struct VertexCacheStats {
+        UI64 transformedVertices = 0;
+        UI64 triangles           = 0;
+        UI64 vertices            = 0; // unique vertices referenced
+
+        inline F32 acmr() const { return triangles ? static_cast<F32>(transformedVertices) / triangles : 0.0f; }
+        inline F32 atvr() const { return vertices ? static_cast<F32>(transformedVertices) / vertices : 0.0f; }
+
+        inline VertexCacheStats& operator+=(const VertexCacheStats& other) {
+            transformedVertices += other.transformedVertices;
+            triangles           += other.triangles;
+            vertices            += other.vertices;
+            return *this;
+        }
+    };
+
+    VertexCacheStats simulateVertexCache(const UI32* indices, size_t indexCount, size_t vertexCount,
+        UI32 cacheSize = VERTEX_CACHE_SIZE);
+}
+
+#endif // !MESH_OPTIMIZER_H
@@ -30,7 +30,8 @@ public:
     //-Supported file formats------------------------------------------------------------------------------------//
     enum class FileExtension : unsigned char {
         OBJ  = 0x0,
-        GLTF = 0x1
+        GLTF = 0x1,
+        GLB  = 0x2
     };
 
 public:
@@ -59,6 +60,10 @@ public:
     std::vector<Vertex>* getVertexBuffer(uint32_t primitiveNum);
     std::vector<uint32_t>* getIndexBuffer(uint32_t primitiveNum);
 
+    // welded vertices and indices of a loaded .obj file
+    inline const std::vector<Vertex>& getObjVertices() const { return vertices; }
+    inline const std::vector<uint32_t>& getObjIndices() const { return indices; }
+
     //-Get material textures-------------------------------------------------------------------------------------//
     std::vector<ImageData>* getMaterialTextureData(UI32 primitiveNum);
 
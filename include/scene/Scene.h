@@ -1,12 +1,75 @@
 //
-// A class that represents a game scene 
+// A class that represents a game scene
+//
+
+//
+// The scene graph is a flat array of nodes, stored as a structure of arrays and ordered so that every parent
+// comes before its children. World transforms are then updated with one linear pass: a node's parent has been
+// updated by the time the node is reached. Nodes whose local transform changed are marked dirty, and the pass
+// starts at the first dirty node and only recomputes the nodes below one.
 //
 
 #ifndef SCENE_H
 #define SCENE_H
 
+#include <common/types.h>
+
+#include <math/Transform.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <tiny_gltf.h>
+
+#include <cstdint>
+#include <vector>
+
+// parent of root nodes
+const UI32 SCENE_NO_PARENT = UINT32_MAX;
+
 class Scene {
-	// TODO: make scene
+public:
+	//-Building the graph----------------------------------------------------------------------------------------//
+	// appends a node below an existing node, or a root node, and returns its index
+	UI32 addNode(const Transform& local, UI32 parent = SCENE_NO_PARENT);
+
+	// appends the node hierarchy of the default scene of a glTF model below parent. pNodes receives the scene
+	// node of each glTF node, SCENE_NO_PARENT for nodes outside of the scene
+	void addGltfNodes(const tinygltf::Model& model, UI32 parent, std::vector<UI32>* pNodes = nullptr);
+
+	void clear();
+
+	//-Transforms------------------------------------------------------------------------------------------------//
+	void setLocal(UI32 node, const Transform& local);
+	Transform local(UI32 node) const;
+
+	// brings the world matrix of every node below a changed node up to date
+	void updateWorldTransforms();
+
+	// valid after updateWorldTransforms
+	inline const glm::mat4& world(UI32 node) const { return _worlds[node]; }
+	inline UI32 parent(UI32 node) const { return _parents[node]; }
+	inline UI32 nodeCount() const { return static_cast<UI32>(_parents.size()); }
+
+private:
+	// bits of _dirty
+	static const UC LOCAL_DIRTY = 0x1;
+	static const UC WORLD_DIRTY = 0x2;
+
+	void markDirty(UI32 node);
+	UI32 addGltfNode(const tinygltf::Model& model, I32 gltfNode, UI32 parent, std::vector<UI32>& nodes);
+
+private:
+	std::vector<UI32>      _parents;
+	std::vector<glm::vec3> _positions;
+	std::vector<glm::quat> _rotations;
+	std::vector<glm::vec3> _scales;
+	std::vector<glm::mat4> _locals;
+	std::vector<glm::mat4> _worlds;
+	std::vector<UC>        _dirty;
+
+	// no node before this one is dirty
+	UI32 _firstDirty = UINT32_MAX;
 };
 
 #endif
@@ -14,8 +14,8 @@
 #include <common/Print.h>
 #include <common/Assert.h>
 #include <common/commands.h>
-
-#include <hpg/Shader.h>
+#include <common/JobSystem.h>
+#include <common/Profiler.h>
 
 // transformations
 #define GLM_FORCE_RADIANS
@@ -27,8 +27,11 @@
 #include <glm/gtx/string_cast.hpp>
 
 #include <algorithm> // min, max
+#include <chrono> // startup timings
 #include <fstream> // file (shader) loading
 #include <cstdint> // UINT32_MAX
+#include <cstdio> // snprintf
+#include <cstdlib> // getenv
 #include <set> // set for queues
 
 // ImGui includes for a nice gui
@@ -43,23 +46,60 @@ void Application::run(const char* arg) {
 }
 
 void Application::init(const char* arg) {
+    using Clock = std::chrono::steady_clock;
+    auto milliseconds = [](Clock::time_point from, Clock::time_point to) {
+        return std::chrono::duration<F64, std::milli>(to - from).count();
+    };
+
+    Clock::time_point start = Clock::now();
+    PROFILE_THREAD("main");
+    PROFILE_ZONE("Application::init");
+    // before anything queues jobs, this thread becomes the system's thread 0
+    JobSystem::get().init();
     initWindow();
 
     _renderer.init(_window);
+    Clock::time_point rendererReady = Clock::now();
 
+    // pipelines are compiled on worker threads while the scene loads
     buildScene(arg);
+    Clock::time_point sceneReady = Clock::now();
+
+    // only the pipelines recorded into the first frame, background builds carry on
+    {
+        PROFILE_ZONE("wait for pipelines");
+        _renderer._pipelines.waitRequired();
+    }
+    Clock::time_point pipelinesReady = Clock::now();
 
     initVulkan();
+    if (std::getenv(MEASURE_RECORDING_VARIABLE)) {
+        measureRecording();
+    }
 
     initImGui();
+    Clock::time_point end = Clock::now();
+
+    if (std::getenv(PRINT_STATS_VARIABLE)) {
+        print("Startup took %.2f ms: renderer %.2f ms, scene %.2f ms, waiting on pipelines %.2f ms, "
+            "recording %.2f ms\n", milliseconds(start, end), milliseconds(start, rendererReady),
+            milliseconds(rendererReady, sceneReady), milliseconds(sceneReady, pipelinesReady),
+            milliseconds(pipelinesReady, end));
+        _renderer._pipelines.printTimings();
+    }
 }
 
 void Application::buildScene(const char* arg) {
+    PROFILE_ZONE("Application::buildScene");
     camera = Camera({ 0.0f, 0.0f, 0.0f }, 2.0f, 1.5f);
     
     _gltfModel.load(arg);
+    _gltfModel._vertexFormat = MODEL_VERTEX_FORMAT;
     _gltfModel.uploadToGpu(_renderer);
 
+    _modelNode = _scene.addNode(Transform());
+    _scene.addGltfNodes(_gltfModel._model, _modelNode);
+
     lights[0] = { {0.0f, 10.0f, 5.0f, 0.0f}, { 200.0f, 200.0f, 200.0f , 40.0f } }; // pos, colour + radius
 
     spotLight = SpotLight({ 20.0f, 20.0f, 0.0f }, 0.1f, 40.0f);
@@ -69,17 +109,15 @@ void Application::buildScene(const char* arg) {
     _skybox.load(SKYBOX_PATH);
     _skybox.uploadToGpu(_renderer);
 
+    // submit every upload recorded above in one batch, the first frame is ordered after it on the graphics queue
+    _renderer._uploadContext.flush();
 }
 
 void Application::initVulkan() {
     // swap chain independent
     //shadowMap.createShadowMap(_renderer);
 
-    // record commands
-    for (UI32 i = 0; i < _renderer._swapChain.imageCount(); i++) {
-        // buildShadowMapCommandBuffer(_renderer._renderCommandBuffers[i]);
-        recordCommandBuffer(_renderer._renderCommandBuffers[i], i);
-    }
+    // commands are recorded by drawFrame, every frame
 }
 
 void Application::recreateVulkanData() {
@@ -101,11 +139,6 @@ void Application::recreateVulkanData() {
     // create new swap chain etc...
     //shadowMap.createShadowMap(&_renderer._context, &descriptorSetLayout, _renderer._commandPools[RENDER_CMD_POOL]);
 
-    for (UI32 i = 0; i < _renderer._swapChain.imageCount(); i++) {
-        // buildShadowMapCommandBuffer(_renderer._renderCommandBuffers[i]);
-        recordCommandBuffer(_renderer._renderCommandBuffers[i], i);
-    }
-
     // update ImGui aswell
     ImGui_ImplVulkan_SetMinImageCount(_renderer._swapChain.imageCount());
 }
@@ -126,7 +159,7 @@ void Application::initImGui() {
     init_info.Device         = _renderer._context.device;
     init_info.QueueFamily    = utils::QueueFamilyIndices::findQueueFamilies(_renderer._context.physicalDevice, _renderer._context.surface).graphicsFamily.value();
     init_info.Queue          = _renderer._context.graphicsQueue;
-    init_info.PipelineCache  = VK_NULL_HANDLE;
+    init_info.PipelineCache  = _renderer._pipelines.cache();
     init_info.DescriptorPool = _renderer._descriptorPool;
     init_info.Allocator      = nullptr;
     init_info.MinImageCount  = _renderer._context._swapChainSupportDetails.capabilities.minImageCount + 1;
@@ -161,10 +194,11 @@ void Application::initWindow() {
 
 // Command buffers
 
-void Application::buildGuiCommandBuffer(UI32 cmdBufferIndex) {
+void Application::buildGuiCommandBuffer(VkCommandBuffer cmdBuffer, UI32 frame, UI32 index) {
+    PROFILE_ZONE("Application::buildGuiCommandBuffer");
     VkCommandBufferBeginInfo commandbufferInfo = vkinit::commandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
-    if (vkBeginCommandBuffer(_renderer._guiCommandBuffers[cmdBufferIndex], &commandbufferInfo) != VK_SUCCESS) {
+    if (vkBeginCommandBuffer(cmdBuffer, &commandbufferInfo) != VK_SUCCESS) {
         throw std::runtime_error("failed to begin recording command buffer!");
     }
 
@@ -173,19 +207,22 @@ void Application::buildGuiCommandBuffer(UI32 cmdBufferIndex) {
 
     // begin the render pass
     VkRenderPassBeginInfo renderPassBeginInfo = vkinit::renderPassBeginInfo(_renderer._guiRenderPass,
-        _renderer._guiFramebuffers[cmdBufferIndex], _renderer._swapChain.extent(), 1, &clearValue);
+        _renderer._guiFramebuffers[index], _renderer._swapChain.extent(), 1, &clearValue);
 
-    vkCmdBeginRenderPass(_renderer._guiCommandBuffers[cmdBufferIndex], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    // submitted after the render commands, which reset the frame's queries
+    _renderer._gpuProfiler.begin(cmdBuffer, frame, GPU_SCOPE_GUI);
+    vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
     ImGui::Render();
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), _renderer._guiCommandBuffers[cmdBufferIndex]); // ends imgui render
-    vkCmdEndRenderPass(_renderer._guiCommandBuffers[cmdBufferIndex]);
+    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmdBuffer); // ends imgui render
+    vkCmdEndRenderPass(cmdBuffer);
+    _renderer._gpuProfiler.end(cmdBuffer, frame, GPU_SCOPE_GUI);
 
-    if (vkEndCommandBuffer(_renderer._guiCommandBuffers[cmdBufferIndex]) != VK_SUCCESS) {
+    if (vkEndCommandBuffer(cmdBuffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to record ImGui command buffer!");
     }
 }
 
-void Application::buildShadowMapCommandBuffer(VkCommandBuffer cmdBuffer) {
+void Application::buildShadowMapCommandBuffer(VkCommandBuffer cmdBuffer, UI32 index) {
     VkCommandBufferBeginInfo commandBufferBeginInfo = vkinit::commandBufferBeginInfo();
 
     // implicitly resets cmd buffer
@@ -211,21 +248,31 @@ void Application::buildShadowMapCommandBuffer(VkCommandBuffer cmdBuffer) {
 
     vkCmdSetDepthBias(cmdBuffer, shadowMap.depthBiasConstant, 0.0f, shadowMap.depthBiasSlope);
 
-    // scene pipeline
-    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowMap.shadowMapPipeline);
-    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowMap.layout, 0, 1,
-        &shadowMapDescriptorSet, 0, nullptr);
+    // uniforms of this swap chain image
+    UI32 dynamicOffset = _renderer._uniformArena.dynamicOffset(index);
 
-    _gltfModel.draw(cmdBuffer);
+    // scene pipeline, requested in the background so startup does not wait for it, the pass needs it from here
+    _renderer._pipelines.wait(shadowMap.pipeline);
+    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowMap.pipeline->pipeline);
+    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, shadowMap.pipeline->layout, 0, 1,
+        &shadowMapDescriptorSet, 1, &dynamicOffset);
+
+    _gltfModel.draw(cmdBuffer, index, dynamicOffset);
 
     vkCmdEndRenderPass(cmdBuffer);
+
+    if (vkEndCommandBuffer(cmdBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record shadow map command buffer!");
+    }
 }
 
 // USES THE NEW RENDER PASS
-void Application::recordCommandBuffer(VkCommandBuffer cmdBuffer, UI32 index) {
-    VkCommandBufferBeginInfo commandBufferBeginInfo = vkinit::commandBufferBeginInfo();
+void Application::recordCommandBuffer(VkCommandBuffer cmdBuffer, UI32 frame, UI32 index) {
+    PROFILE_ZONE("Application::recordCommandBuffer");
+    VkCommandBufferBeginInfo commandBufferBeginInfo = vkinit::commandBufferBeginInfo(
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
-    // implicitly resets cmd buffer
+    // the frame's pool has been reset
     if (vkBeginCommandBuffer(cmdBuffer, &commandBufferBeginInfo) != VK_SUCCESS) {
         throw std::runtime_error("failed to begin recording command buffer!");
     }
@@ -250,42 +297,93 @@ void Application::recordCommandBuffer(VkCommandBuffer cmdBuffer, UI32 index) {
     VkRenderPassBeginInfo renderPassBeginInfo = vkinit::renderPassBeginInfo(_renderer._renderPass,
         _renderer._framebuffers[index], _renderer._swapChain.extent(), ATTACHMENTS_MAX_ENUM, clearValues);
 
-    // 1: offscreen scene render into gbuffer
-    vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-    vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
-    vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
-
-    // TODO: MOVE PIPELINE BINDING INTO model.draw
-    // scene pipeline
-    /*
-    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _offScreenPipeline);
-    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _deferredPipelineLayout, 0, 1,
-        &offScreenDescriptorSet, 0, nullptr);
-    */
-    
-    _gltfModel.draw(cmdBuffer);
-
-    _skybox.draw(cmdBuffer);
+    // uniforms of this swap chain image
+    UI32 dynamicOffset = _renderer._uniformArena.dynamicOffset(index);
+
+    // queries are reset outside of a render pass, before any timestamp of the frame
+    _renderer._gpuProfiler.reset(cmdBuffer, frame);
+
+    // 0: gpu culling of indirect draws, with this frame's camera
+    _gltfModel.cull(cmdBuffer, index, dynamicOffset);
+
+    // 1: offscreen scene render into gbuffer. Each part draws a contiguous range of the model's sorted draws, so
+    // state changes only add up at the seams, and the skybox goes last as it would inline
+    auto recordOffscreen = [&](VkCommandBuffer commandBuffer, UI32 part, UI32 partCount) {
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+        UI64 drawCount = _gltfModel.drawCount();
+        UI32 firstDraw = static_cast<UI32>(drawCount * part / partCount);
+        UI32 endDraw = static_cast<UI32>(drawCount * (part + 1) / partCount);
+        _gltfModel.draw(commandBuffer, index, dynamicOffset, firstDraw, endDraw - firstDraw);
+
+        if (part == partCount - 1) {
+            _renderer._gpuProfiler.begin(commandBuffer, frame, GPU_SCOPE_SKYBOX);
+            _skybox.draw(commandBuffer, dynamicOffset);
+            _renderer._gpuProfiler.end(commandBuffer, frame, GPU_SCOPE_SKYBOX);
+        }
+    };
+
+    // a subpass of secondary command buffers only executes them, the gbuffer's timestamps go around it
+    _renderer._gpuProfiler.begin(cmdBuffer, frame, GPU_SCOPE_GBUFFER);
+    if (recordingParts > 0) {
+        vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        const VkCommandBuffer* parts = _renderer._recorder.record(frame, recordingParts, _renderer._renderPass,
+            OFFSCREEN_SUBPASS, _renderer._framebuffers[index], recordOffscreen);
+        vkCmdExecuteCommands(cmdBuffer, recordingParts, parts);
+    }
+    else {
+        vkCmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        recordOffscreen(cmdBuffer, 0, 1);
+    }
 
     // 2: composition to screen
     vkCmdNextSubpass(cmdBuffer, VK_SUBPASS_CONTENTS_INLINE);
+    _renderer._gpuProfiler.end(cmdBuffer, frame, GPU_SCOPE_GBUFFER);
+    _renderer._gpuProfiler.begin(cmdBuffer, frame, GPU_SCOPE_COMPOSITION);
 
     //vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
-    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _renderer._compositionPipeline);
+    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _renderer._compositionPipeline->pipeline);
     vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-        _renderer._compositionPipelineLayout, 0, 1, &_renderer._compositionDescriptorSets[index], 0, nullptr);
+        _renderer._compositionPipeline->layout, 0, 1, &_renderer._compositionDescriptorSet, 1, &dynamicOffset);
 
     // draw a single triangle
     vkCmdDraw(cmdBuffer, 3, 1, 0, 0);
 
     vkCmdEndRenderPass(cmdBuffer);
+    _renderer._gpuProfiler.end(cmdBuffer, frame, GPU_SCOPE_COMPOSITION);
 
     if (vkEndCommandBuffer(cmdBuffer) != VK_SUCCESS) {
         throw std::runtime_error("failed to record command buffer!");
     }
 }
 
+void Application::measureRecording() {
+    using Clock = std::chrono::steady_clock;
+    const UI32 samples = 32;
+
+    // nothing has been submitted yet, the first frame's commands can be recorded over and over
+    UI32 chosenParts = recordingParts;
+    for (UI32 parts = 0; parts <= _renderer._recorder.maxPartCount(); parts = parts == 0 ? 1 : parts * 2) {
+        recordingParts = parts;
+        Clock::time_point start = Clock::now();
+        for (UI32 s = 0; s < samples; s++) {
+            vkResetCommandPool(_renderer._context.device, _renderer._frameCommandPools[0], 0);
+            recordCommandBuffer(_renderer._renderCommandBuffers[0], 0, 0);
+        }
+        F64 milliseconds = std::chrono::duration<F64, std::milli>(Clock::now() - start).count() / samples;
+
+        if (parts == 0) {
+            print("Recording %u draws inline: %.3f ms\n", _gltfModel.drawCount(), milliseconds);
+        }
+        else {
+            print("Recording %u draws on %u threads: %.3f ms\n", _gltfModel.drawCount(), parts, milliseconds);
+        }
+    }
+
+    recordingParts = chosenParts;
+}
+
 // Handling window resize events
 
 void Application::framebufferResizeCallback(GLFWwindow* window, int width, int height) {
@@ -339,9 +437,19 @@ void Application::drawFrame() {
     // We want to sync queue operations to draw cmds and presentation, and we want to make sure the offscreen cmds
     // have finished before the final image composition using semaphores. 
     /*************************************************************************************************************/
+    PROFILE_ZONE("Application::drawFrame");
 
     // previous frame finished will fence
-    vkWaitForFences(_renderer._context.device, 1, &_renderer._inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    {
+        PROFILE_ZONE("wait for frame");
+        vkWaitForFences(_renderer._context.device, 1, &_renderer._inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    }
+
+    // release staging memory of uploads that have completed
+    _renderer._uploadContext.collect();
+
+    // the frame's timestamps are available, reading them does not wait on the device
+    _renderer._gpuProfiler.collect(static_cast<UI32>(currentFrame));
 
     VkResult result = vkAcquireNextImageKHR(_renderer._context.device, *_renderer._swapChain.get(), UINT64_MAX,
         _renderer._imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
@@ -360,9 +468,30 @@ void Application::drawFrame() {
 
     _renderer._imagesInFlight[imageIndex] = _renderer._inFlightFences[currentFrame]; // set image as in use by current frame
 
-    updateUniformBuffers(imageIndex);
+    // the frame's previous commands have completed, its buffers are recorded again from the start
+    vkResetCommandPool(_renderer._context.device, _renderer._frameCommandPools[currentFrame], 0);
+
+    using Clock = std::chrono::steady_clock;
+    auto milliseconds = [](Clock::time_point from) {
+        return std::chrono::duration<F64, std::milli>(Clock::now() - from).count();
+    };
+
+    // the uniforms and the gui's commands share no data, the uniforms are updated by a job while this thread
+    // records the gui
+    JobCounter uniformsUpdated;
+    JobSystem::get().run([this]() { updateUniformBuffers(imageIndex); }, &uniformsUpdated);
+    Clock::time_point guiStart = Clock::now();
+    buildGuiCommandBuffer(_renderer._guiCommandBuffers[currentFrame], static_cast<UI32>(currentFrame), imageIndex);
+    F64 guiTime = milliseconds(guiStart);
+    JobSystem::get().wait(uniformsUpdated);
 
-    buildGuiCommandBuffer(imageIndex);
+    // the draws come from this frame's cull, objects come and go without waiting on the device
+    Clock::time_point renderStart = Clock::now();
+    recordCommandBuffer(_renderer._renderCommandBuffers[currentFrame], static_cast<UI32>(currentFrame), imageIndex);
+    F64 renderTime = milliseconds(renderStart);
+
+    guiRecordingMilliseconds = guiRecordingMilliseconds * 0.95 + guiTime * 0.05;
+    renderRecordingMilliseconds = renderRecordingMilliseconds * 0.95 + renderTime * 0.05;
 
     VkPipelineStageFlags waitStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
     VkSubmitInfo submitInfo{};
@@ -376,7 +505,7 @@ void Application::drawFrame() {
     submitInfo.signalSemaphoreCount = 1;
     submitInfo.pSignalSemaphores    = &_renderer._renderFinishedSemaphores[currentFrame];
 
-    std::array<VkCommandBuffer, 2> submitCommandBuffers = { _renderer._renderCommandBuffers[imageIndex], _renderer._guiCommandBuffers[imageIndex] };
+    std::array<VkCommandBuffer, 2> submitCommandBuffers = { _renderer._renderCommandBuffers[currentFrame], _renderer._guiCommandBuffers[currentFrame] };
     submitInfo.commandBufferCount = static_cast<uint32_t>(submitCommandBuffers.size());
     submitInfo.pCommandBuffers    = submitCommandBuffers.data();
 
@@ -389,6 +518,7 @@ void Application::drawFrame() {
     if (vkQueueSubmit(_renderer._context.graphicsQueue, 1, &submitInfo, _renderer._inFlightFences[currentFrame]) != VK_SUCCESS) {
         throw std::runtime_error("failed to submit draw command buffer!");
     }
+    _renderer._gpuProfiler.submitted(static_cast<UI32>(currentFrame));
 
     // submitting the result back to the swap chain to have it shown onto the screen
     VkPresentInfoKHR presentInfo{};
@@ -418,6 +548,7 @@ void Application::drawFrame() {
 }
 
 void Application::setGUI() {
+    PROFILE_ZONE("Application::setGUI");
     // Start the Dear ImGui frame
     ImGui_ImplVulkan_NewFrame(); // empty
     ImGui_ImplGlfw_NewFrame();
@@ -425,6 +556,22 @@ void Application::setGUI() {
 
     ImGui::Begin("Options", nullptr, ImGuiWindowFlags_NoMove);
     ImGui::Text("Application %.1f FPS", ImGui::GetIO().Framerate);
+    ImGui::Text("Recording: scene %.3f ms, gui %.3f ms", renderRecordingMilliseconds, guiRecordingMilliseconds);
+    if (!_renderer._gpuProfiler.enabled()) {
+        ImGui::Text("GPU timings: not supported");
+    }
+    else if (ImGui::CollapsingHeader("GPU timings")) {
+        const GpuProfiler& profiler = _renderer._gpuProfiler;
+        for (UI32 scope = 0; scope < profiler.scopeCount(); scope++) {
+            if (!profiler.hasResults(scope)) {
+                continue;
+            }
+            char overlay[32];
+            snprintf(overlay, sizeof(overlay), "%.3f ms", profiler.average(scope));
+            ImGui::PlotLines(profiler.scopeName(scope).c_str(), profiler.history(scope), GPU_PROFILER_HISTORY,
+                profiler.historyOffset(), overlay, 0.0f, FLT_MAX, ImVec2(210, 40));
+        }
+    }
     ImGui::BulletText("Transforms:");
     ImGui::PushItemWidth(210);
     ImGui::SliderFloat3("translate", &translate[0], -2.0f, 2.0f);
@@ -444,41 +591,47 @@ void Application::setGUI() {
 // Uniforms
 
 void Application::updateUniformBuffers(UI32 currentImage) {
-    // TODO: MAKE UNIFORM UPDATES MORE EFFICIENT (mapping/unmapping is costly operation every frame)
-
+    PROFILE_ZONE("Application::updateUniformBuffers");
     // offscreen ubo
     glm::mat4 proj = glm::perspective(glm::radians(45.0f), _renderer.aspectRatio(), 0.1f, 40.0f);
     proj[1][1] *= -1.0f; // y coordinates inverted, Vulkan origin top left vs OpenGL bottom left
 
-    glm::mat4 model = glm::translate(glm::mat4(1.0f), translate);
-    model = glm::scale(model, glm::vec3(scale, scale, scale));
-    glm::mat4 rotateZ(1.0f);
-    rotateZ[0][0] *= -1.0f;
-    rotateZ[1][1] *= -1.0f;
-    model *= rotateZ * glm::toMat4(glm::quat(glm::radians(rotate)));
+    // the gui moves the model's root node, turned half way round z. Its subtree is only updated when it moves
+    Transform modelTransform(translate,
+        glm::angleAxis(glm::radians(180.0f), glm::vec3(0.0f, 0.0f, 1.0f)) * glm::quat(glm::radians(rotate)),
+        glm::vec3(scale));
+    Transform current = _scene.local(_modelNode);
+    if (current.position != modelTransform.position || current.rotation != modelTransform.rotation ||
+        current.scale != modelTransform.scale) {
+        _scene.setLocal(_modelNode, modelTransform);
+    }
+    _scene.updateWorldTransforms();
+    glm::mat4 model = _scene.world(_modelNode);
 
     OffscreenUBO offscreenUbo{};
     offscreenUbo.model = model;
     offscreenUbo.projectionView = proj * camera.getViewMatrix();
+    offscreenUbo.positionOffset = glm::vec4(_gltfModel._quantization.offset, 0.0f);
+    offscreenUbo.positionScale = glm::vec4(_gltfModel._quantization.scale, 0.0f);
+
+    // each swap chain image has its own slice of the persistently mapped arena, the image's fence has been
+    // waited on so the slice is no longer read by the device
+    _renderer._uniformArena.write(currentImage, _gltfModel._uniformOffset, offscreenUbo);
 
-    void* data;
-    vkMapMemory(_renderer._context.device, _gltfModel._uniformBuffer._memory, 0, sizeof(offscreenUbo), 0, &data);
-    memcpy(data, &offscreenUbo, sizeof(offscreenUbo));
-    vkUnmapMemory(_renderer._context.device, _gltfModel._uniformBuffer._memory);
+    // primitive bounds are in model space, so the model transform is part of the frustum
+    _gltfModel.updateVisibility(offscreenUbo.projectionView * offscreenUbo.model);
 
     // shadow map ubo
     /*
     ShadowMap::UBO shadowMapUbo = { spotLight.getMVP(model) };
-    shadowMap.updateShadowMapUniformBuffer(shadowMapUbo); 
+    shadowMap.updateShadowMapUniformBuffer(_renderer._uniformArena, currentImage, shadowMapUbo); 
     */
 
     // skybox ubo
     SkyboxUBO skyboxUbo{};
     skyboxUbo.projectionView = proj * glm::mat4(glm::mat3(camera.getViewMatrix()));
 
-    vkMapMemory(_renderer._context.device, _skybox._uniformBuffer._memory, 0, sizeof(skyboxUbo), 0, &data);
-    memcpy(data, &skyboxUbo, sizeof(skyboxUbo));
-    vkUnmapMemory(_renderer._context.device, _skybox._uniformBuffer._memory);
+    _renderer._uniformArena.write(currentImage, _skybox._uniformOffset, skyboxUbo);
 
     // composition ubo
     CompositionUBO compositionUbo = {};
@@ -491,10 +644,7 @@ void Application::updateUniformBuffers(UI32 currentImage) {
     compositionUbo.lights[2] = lights[2];
     compositionUbo.lights[3] = lights[3];
     */
-    vkMapMemory(_renderer._context.device, _renderer._compositionUniforms._memory, sizeof(compositionUbo) * currentImage, 
-        sizeof(compositionUbo), 0, &data);
-    memcpy(data, &compositionUbo, sizeof(compositionUbo));
-    vkUnmapMemory(_renderer._context.device, _renderer._compositionUniforms._memory);
+    _renderer._uniformArena.write(currentImage, _renderer._compositionUniformOffset, compositionUbo);
 }
 
 int Application::processKeyInput() {
@@ -575,6 +725,9 @@ void Application::processMouseInput(glm::dvec2& curr) {
 //
 
 void Application::cleanup() {
+    // the frame loop has stopped, no thread is recording zones
+    Profiler::get().writeTrace(CPU_TRACE_PATH);
+
     // destroy the imgui context when the program ends
     ImGui_ImplVulkan_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -584,15 +737,15 @@ void Application::cleanup() {
 
     _gltfModel.cleanup(_renderer);
 
-    _offScreenUniform.cleanupBufferData(_renderer._context.device);
-    _compositionUniforms.cleanupBufferData(_renderer._context.device);
-
     // cleanup the descriptor pools and descriptor set layouts
     vkDestroyDescriptorPool(_renderer._context.device, descriptorPool, nullptr);
     vkDestroyDescriptorSetLayout(_renderer._context.device, descriptorSetLayout, nullptr);
 
+    _renderer._gpuProfiler.writeCsv(GPU_TIMINGS_PATH);
     _renderer.cleanup();
 
+    JobSystem::get().cleanup();
+
     // destory the window
     glfwDestroyWindow(_window);
 
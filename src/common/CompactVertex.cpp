@@ -0,0 +1,167 @@
+//
+// CompactVertex struct definition
+//
+
+#include <common/CompactVertex.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//-Component encodings-------------------------------------------------------------------------------------------//
+
+static UI16 toUnorm16(F32 value) {
+    return static_cast<UI16>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+static F32 fromUnorm16(UI16 value) {
+    return value / 65535.0f;
+}
+
+static I16 toSnorm16(F32 value) {
+    return static_cast<I16>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+static F32 fromSnorm16(I16 value) {
+    // -32768 and -32767 both map to -1
+    return std::max(value / 32767.0f, -1.0f);
+}
+
+// IEEE 754 binary16, rounded to nearest even
+static UI16 toHalf(F32 value) {
+    UI32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    UI32 sign = (bits >> 16) & 0x8000;
+    I32 exponent = static_cast<I32>((bits >> 23) & 0xff) - 127 + 15;
+    UI32 mantissa = bits & 0x7fffff;
+
+    if (((bits >> 23) & 0xff) == 0xff) {
+        return static_cast<UI16>(sign | 0x7c00 | (mantissa ? 0x200 : 0)); // inf or nan
+    }
+    if (exponent >= 31) {
+        return static_cast<UI16>(sign | 0x7c00); // too large, infinity
+    }
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return static_cast<UI16>(sign); // too small, zero
+        }
+        // subnormal, the implicit leading bit becomes explicit
+        mantissa |= 0x800000;
+        UI32 shift = static_cast<UI32>(14 - exponent);
+        UI32 half = mantissa >> shift;
+        UI32 remainder = mantissa & ((1u << shift) - 1);
+        UI32 halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1))) {
+            half++;
+        }
+        return static_cast<UI16>(sign | half);
+    }
+
+    UI32 half = sign | (static_cast<UI32>(exponent) << 10) | (mantissa >> 13);
+    UI32 remainder = mantissa & 0x1fff;
+    // a carry out of the mantissa correctly bumps the exponent
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+        half++;
+    }
+    return static_cast<UI16>(half);
+}
+
+static F32 fromHalf(UI16 value) {
+    UI32 sign = static_cast<UI32>(value & 0x8000) << 16;
+    UI32 exponent = (value >> 10) & 0x1f;
+    UI32 mantissa = value & 0x3ff;
+
+    if (exponent == 0) {
+        F32 subnormal = std::ldexp(static_cast<F32>(mantissa), -24);
+        return sign ? -subnormal : subnormal;
+    }
+
+    UI32 bits = exponent == 31 ? sign | 0x7f800000 | (mantissa << 13) :
+        sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    F32 result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// projects a direction onto the octahedron and unfolds the lower half over the upper one
+static void octEncode(const glm::vec3& direction, I16 encoded[2]) {
+    F32 l1 = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    if (l1 == 0.0f) {
+        encoded[0] = encoded[1] = 0;
+        return;
+    }
+
+    F32 x = direction.x / l1;
+    F32 y = direction.y / l1;
+    if (direction.z < 0.0f) {
+        F32 foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        F32 foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = foldedX;
+        y = foldedY;
+    }
+    encoded[0] = toSnorm16(x);
+    encoded[1] = toSnorm16(y);
+}
+
+// same as octDecode in offscreen_pbr_compact.vert
+static glm::vec3 octDecode(const I16 encoded[2]) {
+    glm::vec3 direction(fromSnorm16(encoded[0]), fromSnorm16(encoded[1]), 0.0f);
+    direction.z = 1.0f - std::abs(direction.x) - std::abs(direction.y);
+    F32 fold = std::max(-direction.z, 0.0f);
+    direction.x += direction.x >= 0.0f ? -fold : fold;
+    direction.y += direction.y >= 0.0f ? -fold : fold;
+    return glm::normalize(direction);
+}
+
+//-Encoding------------------------------------------------------------------------------------------------------//
+
+VertexQuantization CompactVertex::quantization(const Vertex* vertices, size_t count) {
+    VertexQuantization quantization;
+    if (count == 0) {
+        return quantization;
+    }
+
+    glm::vec3 min(vertices[0].positionU);
+    glm::vec3 max(vertices[0].positionU);
+    for (size_t v = 1; v < count; v++) {
+        min = glm::min(min, glm::vec3(vertices[v].positionU));
+        max = glm::max(max, glm::vec3(vertices[v].positionU));
+    }
+
+    quantization.offset = min;
+    quantization.scale = max - min;
+    // flat boxes quantize every position to 0 along that axis
+    for (UI32 i = 0; i < 3; i++) {
+        if (quantization.scale[i] == 0.0f) {
+            quantization.scale[i] = 1.0f;
+        }
+    }
+    return quantization;
+}
+
+CompactVertex CompactVertex::encode(const Vertex& vertex, const VertexQuantization& quantization) {
+    CompactVertex compact;
+    for (UI32 i = 0; i < 3; i++) {
+        compact.position[i] = toUnorm16((vertex.positionU[i] - quantization.offset[i]) / quantization.scale[i]);
+    }
+    compact.position[3] = vertex.tangent.w < 0.0f ? 0 : 65535;
+
+    octEncode(glm::vec3(vertex.normalV), compact.normal);
+    octEncode(glm::vec3(vertex.tangent), compact.tangent);
+
+    compact.texCoord[0] = toHalf(vertex.positionU.w);
+    compact.texCoord[1] = toHalf(vertex.normalV.w);
+    return compact;
+}
+
+Vertex CompactVertex::decode(const VertexQuantization& quantization) const {
+    glm::vec3 quantized(fromUnorm16(position[0]), fromUnorm16(position[1]), fromUnorm16(position[2]));
+    glm::vec3 decodedPosition = quantization.offset + quantized * quantization.scale;
+
+    Vertex vertex;
+    vertex.positionU = glm::vec4(decodedPosition, fromHalf(texCoord[0]));
+    vertex.normalV = glm::vec4(octDecode(normal), fromHalf(texCoord[1]));
+    vertex.tangent = glm::vec4(octDecode(tangent), position[3] ? 1.0f : -1.0f);
+    return vertex;
+}
@@ -0,0 +1,251 @@
+//
+// JobSystem class definition
+//
+
+#include <common/JobSystem.h>
+
+#include <common/Assert.h>
+#include <common/Profiler.h>
+
+// index of the calling thread in the system
+static thread_local UI32 t_threadIndex = UINT32_MAX;
+
+//-Deque-------------------------------------------------------------------------------------------------------------//
+
+JobDeque::JobDeque(UI32 capacity) : _jobs(new std::atomic<Job*>[capacity]), _mask(capacity - 1) {
+    m_assert((capacity & (capacity - 1)) == 0, "Job deque capacity must be a power of two");
+}
+
+bool JobDeque::push(Job* job) {
+    I64 bottom = _bottom.load(std::memory_order_relaxed);
+    I64 top = _top.load(std::memory_order_acquire);
+    if (bottom - top > _mask) {
+        return false;
+    }
+
+    // the job is visible before the bottom that publishes it
+    _jobs[bottom & _mask].store(job, std::memory_order_relaxed);
+    _bottom.store(bottom + 1, std::memory_order_release);
+    return true;
+}
+
+Job* JobDeque::pop() {
+    // claim the bottom job first, then check whether a thief got to it
+    I64 bottom = _bottom.load(std::memory_order_relaxed) - 1;
+    _bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    I64 top = _top.load(std::memory_order_relaxed);
+
+    if (top > bottom) {
+        // empty
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = _jobs[bottom & _mask].load(std::memory_order_relaxed);
+    if (top == bottom) {
+        // the last job, owner and thieves race for it on the top
+        if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            job = nullptr;
+        }
+        _bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* JobDeque::steal() {
+    I64 top = _top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    I64 bottom = _bottom.load(std::memory_order_acquire);
+    if (top >= bottom) {
+        return nullptr;
+    }
+
+    Job* job = _jobs[top & _mask].load(std::memory_order_relaxed);
+    if (!_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return job;
+}
+
+//-Initialisation and cleanup----------------------------------------------------------------------------------------//
+
+JobSystem& JobSystem::get() {
+    static JobSystem jobSystem;
+    return jobSystem;
+}
+
+void JobSystem::init(UI32 workerCount) {
+    m_assert(_threads.empty(), "Job system is already running");
+
+    _stopping = false;
+    for (UI32 thread = 0; thread <= workerCount; thread++) {
+        _threads.push_back(std::make_unique<ThreadState>());
+    }
+
+    t_threadIndex = 0;
+    for (UI32 thread = 1; thread <= workerCount; thread++) {
+        _workers.emplace_back(&JobSystem::work, this, thread);
+    }
+}
+
+void JobSystem::cleanup() {
+    if (_threads.empty()) {
+        return;
+    }
+
+    // queued jobs may still be referenced by counters someone waits on, they run before the workers stop
+    while (Job* job = take(0)) {
+        execute(job);
+    }
+    while (_queued.load() > 0) {
+        std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _condition.notify_all();
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+    _workers.clear();
+    _threads.clear();
+    t_threadIndex = UINT32_MAX;
+}
+
+UI32 JobSystem::threadIndex() {
+    return t_threadIndex;
+}
+
+//-Jobs--------------------------------------------------------------------------------------------------------------//
+
+Job* JobSystem::allocate() {
+    if (t_threadIndex >= _threads.size()) {
+        return nullptr;
+    }
+
+    // the next slot whose job has run, slots are only claimed by their thread
+    ThreadState& state = *_threads[t_threadIndex];
+    for (UI32 attempt = 0; attempt < MAX_JOBS_PER_THREAD; attempt++) {
+        Job* job = &state.jobs[state.nextJob];
+        state.nextJob = (state.nextJob + 1) & (MAX_JOBS_PER_THREAD - 1);
+        if (!job->busy.load(std::memory_order_acquire)) {
+            job->busy.store(true, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::submit(Job* job) {
+    if (!_threads[t_threadIndex]->deque.push(job)) {
+        // full, the job runs now rather than waiting for room
+        execute(job);
+        return;
+    }
+
+    // sleepers are counted before they look at the queue, so either they see this job or it sees them
+    _queued.fetch_add(1);
+    if (_sleeping.load() > 0) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _condition.notify_one();
+    }
+}
+
+Job* JobSystem::take(UI32 thread) {
+    if (Job* job = _threads[thread]->deque.pop()) {
+        _queued.fetch_sub(1);
+        return job;
+    }
+
+    // steal from the next threads in turn, so that thieves spread over their victims
+    UI32 threadCount = static_cast<UI32>(_threads.size());
+    for (UI32 offset = 1; offset < threadCount; offset++) {
+        if (Job* job = _threads[(thread + offset) % threadCount]->deque.steal()) {
+            _queued.fetch_sub(1);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+bool JobSystem::defer(Job* job, JobCounter& dependency) {
+    std::lock_guard<std::mutex> lock(dependency._mutex);
+    if (dependency._pending.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    job->next = dependency._continuations;
+    dependency._continuations = job;
+    return true;
+}
+
+void JobSystem::release(JobCounter& counter) {
+    // not the last job, there is nothing to queue
+    UI32 pending = counter._pending.load(std::memory_order_relaxed);
+    while (pending > 1) {
+        if (counter._pending.compare_exchange_weak(pending, pending - 1, std::memory_order_release,
+            std::memory_order_relaxed)) {
+            return;
+        }
+    }
+
+    // reaching zero and taking the continuations happen under the lock, so no job is parked after them. Waiters
+    // take the lock before returning, so the counter is not destroyed while it is held
+    Job* continuations = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(counter._mutex);
+        if (counter._pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            continuations = counter._continuations;
+            counter._continuations = nullptr;
+        }
+    }
+    while (continuations) {
+        Job* next = continuations->next;
+        continuations->next = nullptr;
+        submit(continuations);
+        continuations = next;
+    }
+}
+
+void JobSystem::execute(Job* job) {
+    JobCounter* counter = job->counter;
+    job->function(*job);
+    job->busy.store(false, std::memory_order_release);
+    if (counter) {
+        release(*counter);
+    }
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    UI32 thread = t_threadIndex;
+    while (!counter.done()) {
+        Job* job = thread < _threads.size() ? take(thread) : nullptr;
+        if (job) {
+            execute(job);
+        }
+        else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::work(UI32 thread) {
+    t_threadIndex = thread;
+    PROFILE_THREAD("job worker");
+    while (true) {
+        if (Job* job = take(thread)) {
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        _sleeping.fetch_add(1);
+        _condition.wait(lock, [this]() { return _stopping || _queued.load() > 0; });
+        _sleeping.fetch_sub(1);
+        if (_stopping) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,120 @@
+//
+// MappedFile class definition
+//
+
+#include <common/MappedFile.h>
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        std::swap(_data, other._data);
+        std::swap(_size, other._size);
+#ifdef _WIN32
+        std::swap(_file, other._file);
+        std::swap(_mapping, other._mapping);
+#else
+        std::swap(_fd, other._fd);
+#endif
+    }
+    return *this;
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    _file = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        close();
+        return false;
+    }
+    _size = static_cast<size_t>(size.QuadPart);
+
+    _mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!_mapping) {
+        close();
+        return false;
+    }
+
+    _data = static_cast<const UC*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    _fd = ::open(path.c_str(), O_RDONLY);
+    if (_fd < 0) {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(_fd, &status) != 0 || status.st_size == 0) {
+        close();
+        return false;
+    }
+    _size = static_cast<size_t>(status.st_size);
+
+    void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+    _data = data == MAP_FAILED ? nullptr : static_cast<const UC*>(data);
+    if (_data) {
+        // geometry is read front to back
+        madvise(data, _size, MADV_SEQUENTIAL);
+    }
+#endif
+
+    if (!_data) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (_data) {
+        UnmapViewOfFile(_data);
+    }
+    if (_mapping) {
+        CloseHandle(_mapping);
+    }
+    if (_file) {
+        CloseHandle(_file);
+    }
+    _file = nullptr;
+    _mapping = nullptr;
+#else
+    if (_data) {
+        munmap(const_cast<UC*>(_data), _size);
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+    _fd = -1;
+#endif
+    _data = nullptr;
+    _size = 0;
+}
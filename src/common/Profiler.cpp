@@ -0,0 +1,106 @@
+//
+// Profiler class definition
+//
+
+#include <common/Profiler.h>
+
+#include <common/Print.h>
+
+#include <fstream>
+
+Profiler::Profiler() : _epoch(std::chrono::steady_clock::now()) {}
+
+Profiler& Profiler::get() {
+    static Profiler profiler;
+    return profiler;
+}
+
+UI64 Profiler::now() {
+    // the epoch is set on first use, before the clock is read
+    const Profiler& profiler = get();
+    auto elapsed = std::chrono::steady_clock::now() - profiler._epoch;
+    return static_cast<UI64>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+//-Recording---------------------------------------------------------------------------------------------------------//
+
+Profiler::ThreadEvents& Profiler::threadEvents() {
+    // ring of the calling thread, null until it first records
+    static thread_local ThreadEvents* t_threadEvents = nullptr;
+    if (!t_threadEvents) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _threads.push_back(std::make_unique<ThreadEvents>());
+        _threads.back()->id = static_cast<UI32>(_threads.size());
+        t_threadEvents = _threads.back().get();
+    }
+    return *t_threadEvents;
+}
+
+void Profiler::setThreadName(const char* name) {
+    ThreadEvents& thread = threadEvents();
+    std::lock_guard<std::mutex> lock(_mutex);
+    thread.name = name;
+}
+
+void Profiler::record(const char* name, UI64 start, UI64 end) {
+    // only this thread writes its ring, the count publishes the event to the exporter
+    ThreadEvents& thread = threadEvents();
+    UI64 count = thread.count.load(std::memory_order_relaxed);
+    thread.events[count % PROFILER_EVENTS_PER_THREAD] = { name, start, end };
+    thread.count.store(count + 1, std::memory_order_release);
+}
+
+//-Export------------------------------------------------------------------------------------------------------------//
+
+// names are literals, only quotes and backslashes need escaping
+static void writeJsonString(std::ofstream& file, const char* string) {
+    file << '"';
+    for (const char* c = string; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            file << '\\';
+        }
+        file << *c;
+    }
+    file << '"';
+}
+
+bool Profiler::writeTrace(const std::string& path) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        print("Could not open %s for writing\n", path.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    UI64 eventCount = 0;
+    for (const auto& thread : _threads) {
+        if (thread->name) {
+            file << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread->id
+                << ",\"args\":{\"name\":";
+            writeJsonString(file, thread->name);
+            file << "}}";
+            first = false;
+        }
+
+        // complete events in microseconds, oldest first
+        UI64 count = thread->count.load(std::memory_order_acquire);
+        UI64 begin = count > PROFILER_EVENTS_PER_THREAD ? count - PROFILER_EVENTS_PER_THREAD : 0;
+        for (UI64 e = begin; e < count; e++) {
+            const ProfileEvent& event = thread->events[e % PROFILER_EVENTS_PER_THREAD];
+            file << (first ? "\n" : ",\n") << "{\"name\":";
+            writeJsonString(file, event.name);
+            file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread->id << ",\"ts\":" << event.start / 1000 << "."
+                << event.start / 100 % 10 << ",\"dur\":" << (event.end - event.start) / 1000 << "."
+                << (event.end - event.start) / 100 % 10 << "}";
+            first = false;
+        }
+        eventCount += count - begin;
+    }
+    file << "\n]}\n";
+
+    print("Wrote %llu cpu zones of %zu threads to %s\n", static_cast<unsigned long long>(eventCount), _threads.size(),
+        path.c_str());
+    return true;
+}
@@ -40,6 +40,18 @@ namespace utils {
             }
             i++;
         }
+
+        // look for a queue family dedicated to transfers, prefer one without compute support as it is most likely 
+        // to map onto a copy engine that runs asynchronously to the graphics queue
+        for (UI32 j = 0; j < queueFamilyCount; j++) {
+            VkQueueFlags flags = queueFamilies[j].queueFlags;
+            if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+                if (!indices.transferFamily.has_value() || !(flags & VK_QUEUE_COMPUTE_BIT)) {
+                    indices.transferFamily = j;
+                }
+            }
+        }
+
         return indices;
     }
 
@@ -136,7 +136,7 @@ namespace vkinit {
 
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo (
         UI32 layoutCount,
-        VkDescriptorSetLayout* layouts,
+        const VkDescriptorSetLayout* layouts,
         VkPipelineLayoutCreateFlags flags) {
         VkPipelineLayoutCreateInfo info{};
         info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -460,5 +460,19 @@ namespace vkinit {
         fenceCreateInfo.flags = flags;
         return fenceCreateInfo;
     }
+
+    //-----------------------------------------------------------------------------------------------------------//
+    //-QUERY STRUCTS---------------------------------------------------------------------------------------------//
+    //-----------------------------------------------------------------------------------------------------------//
+
+    VkQueryPoolCreateInfo queryPoolCreateInfo(
+        VkQueryType queryType,
+        UI32 queryCount) {
+        VkQueryPoolCreateInfo queryPoolCreateInfo{};
+        queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolCreateInfo.queryType = queryType;
+        queryPoolCreateInfo.queryCount = queryCount;
+        return queryPoolCreateInfo;
+    }
     
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 //
 
 #include <hpg/Buffer.h>
+#include <hpg/UploadContext.h>
 
 #include <common/utils.h>
 #include <common/vkinit.h>
@@ -10,7 +11,7 @@
 
 void Buffer::cleanupBufferData(VkDevice device) {
     vkDestroyBuffer(device, _vkBuffer, nullptr);
-    vkFreeMemory(device, _memory, nullptr);
+    _allocation.free();
 }
 
 void Buffer::copyBufferToImage(const VulkanContext* vkSetup, const VkCommandPool& renderCommandPool, VkBuffer buffer,
@@ -35,26 +36,10 @@ Buffer Buffer::createBuffer(const VulkanContext& context, UI64 size, VkBufferUsa
         throw std::runtime_error("failed to create vertex buffer!");
     }
 
-    // created a buffer, but haven't assigned any memory yet, also get the right memory requirements
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(context.device, newBuffer._vkBuffer, &memRequirements);
-
-    // allocate the memory for the buffer
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = utils::findMemoryType(context.physicalDevice, memRequirements.memoryTypeBits, properties);
-
-    // allocate memory for the buffer. In a real world application, not supposed to actually call vkAllocateMemory for every individual buffer. 
-    // The maximum number of simultaneous memory allocations is limited by the maxMemoryAllocationCount physical device limit. The right way to 
-    // allocate memory for large number of objects at the same time is to create a custom allocator that splits up a single allocation among many 
-    // different objects by using the offset parameters seen in other functions
-    if (vkAllocateMemory(context.device, &allocInfo, nullptr, &newBuffer._memory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate vertex buffer memory!");
-    }
-
-    // associate memory with buffer
-    vkBindBufferMemory(context.device, newBuffer._vkBuffer, newBuffer._memory, 0);
+    // created a buffer, but haven't assigned any memory yet. Memory is sub-allocated from one of the allocator's
+    // blocks and bound at the right offset, rather than calling vkAllocateMemory for every individual buffer
+    // which is limited by the maxMemoryAllocationCount physical device limit
+    newBuffer._allocation = context.allocator.allocateBufferMemory(newBuffer._vkBuffer, properties);
 
     return newBuffer;
 }
@@ -67,33 +52,14 @@ void Buffer::copyBuffer(const VulkanContext* vkSetup, const VkCommandPool& comma
     cmd::endSingleTimeCommands(vkSetup->device, vkSetup->graphicsQueue, commandBuffer, commandPool);
 }
 
-Buffer Buffer::createDeviceLocalBuffer(const VulkanContext* vkSetup, const VkCommandPool& commandPool, 
-    const BufferData& bufferData, VkBufferUsageFlagBits usage) {
-
-    Buffer stagingBuffer = createBuffer(*vkSetup, bufferData._size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-    void* data;
-    vkMapMemory(vkSetup->device, stagingBuffer._memory, 0, bufferData._size, 0, &data);
-    memcpy(data, bufferData._data, bufferData._size);
-    vkUnmapMemory(vkSetup->device, stagingBuffer._memory);
+Buffer Buffer::createDeviceLocalBuffer(const VulkanContext* vkSetup, UploadContext& uploadContext, 
+    const BufferData& bufferData, VkBufferUsageFlags usage) {
 
     Buffer deviceLocalBuffer = Buffer::createBuffer(*vkSetup, bufferData._size, 
         VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-    VkBufferCopy copyRegion{};
-    copyRegion.size = bufferData._size;
-    copyRegion.srcOffset = 0;
-    copyRegion.dstOffset = 0;
-
-    Buffer::CopyInfo copyInfo{};
-    copyInfo.pSrc = &stagingBuffer._vkBuffer;
-    copyInfo.pDst = &deviceLocalBuffer._vkBuffer;
-    copyInfo.copyRegion = copyRegion;
-
-    Buffer::copyBuffer(vkSetup, commandPool, &copyInfo);
-
-    stagingBuffer.cleanupBufferData(vkSetup->device);
+    // the copy is recorded in the upload context's current batch, contents are valid once it has been flushed
+    uploadContext.uploadBuffer(deviceLocalBuffer._vkBuffer, usage, bufferData._data, bufferData._size);
 
     return deviceLocalBuffer;
-}
\ No newline at end of file
+}
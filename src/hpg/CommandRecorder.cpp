@@ -0,0 +1,109 @@
+//
+// CommandRecorder class definition
+//
+
+#include <hpg/CommandRecorder.h>
+
+#include <common/vkinit.h>
+#include <common/utils.h>
+#include <common/Assert.h>
+#include <common/JobSystem.h>
+#include <common/Profiler.h>
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+
+//-Initialisation and cleanup----------------------------------------------------------------------------------------//
+
+void CommandRecorder::init(const VulkanContext* context, UI32 maxPartCount) {
+    _context = context;
+    _maxPartCount = std::max(1u, maxPartCount);
+
+    // buffers are recorded once per frame and never reset on their own
+    UI32 graphicsFamily = _context->queueFamilyIndices.graphicsFamily.value();
+    _commandPools.resize(MAX_FRAMES_IN_FLIGHT * _maxPartCount);
+    _commandBuffers.resize(MAX_FRAMES_IN_FLIGHT * _maxPartCount);
+    for (UI32 i = 0; i < _commandPools.size(); i++) {
+        VkCommandPoolCreateInfo poolInfo = vkinit::commandPoolCreateInfo(graphicsFamily,
+            VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+        if (vkCreateCommandPool(_context->device, &poolInfo, nullptr, &_commandPools[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create recording command pool!");
+        }
+
+        VkCommandBufferAllocateInfo allocInfo = vkinit::commandBufferAllocateInfo(_commandPools[i],
+            VK_COMMAND_BUFFER_LEVEL_SECONDARY, 1);
+        if (vkAllocateCommandBuffers(_context->device, &allocInfo, &_commandBuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate secondary command buffer!");
+        }
+    }
+}
+
+void CommandRecorder::cleanup() {
+    // destroying a pool frees its buffers
+    for (VkCommandPool pool : _commandPools) {
+        vkDestroyCommandPool(_context->device, pool, nullptr);
+    }
+    _commandPools.clear();
+    _commandBuffers.clear();
+}
+
+//-Recording---------------------------------------------------------------------------------------------------------//
+
+const VkCommandBuffer* CommandRecorder::record(UI32 frame, UI32 partCount, VkRenderPass renderPass, UI32 subpass,
+    VkFramebuffer framebuffer, const Job& job) {
+    m_assert(frame < MAX_FRAMES_IN_FLIGHT && partCount > 0 && partCount <= _maxPartCount,
+        "Recording more parts than the recorder has pools for");
+
+    _job = &job;
+    _frame = frame;
+    _partCount = partCount;
+
+    _inheritance = {};
+    _inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    _inheritance.renderPass = renderPass;
+    _inheritance.subpass = subpass;
+    _inheritance.framebuffer = framebuffer;
+
+    // exceptions cannot leave a job, the first one is rethrown once every part has finished
+    std::mutex errorMutex;
+    std::exception_ptr error;
+    JobSystem::get().parallelFor(partCount, [&](size_t part) {
+        try {
+            recordPart(static_cast<UI32>(part));
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            error = error ? error : std::current_exception();
+        }
+    }, 1);
+    _job = nullptr;
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return _commandBuffers.data() + frame * _maxPartCount;
+}
+
+void CommandRecorder::recordPart(UI32 part) {
+    PROFILE_ZONE("CommandRecorder::recordPart");
+    VkCommandPool pool = _commandPools[_frame * _maxPartCount + part];
+    VkCommandBuffer commandBuffer = _commandBuffers[_frame * _maxPartCount + part];
+
+    // the frame's previous commands have completed, this part's pool is only used by this job
+    vkResetCommandPool(_context->device, pool, 0);
+
+    VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo(
+        VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    beginInfo.pInheritanceInfo = &_inheritance;
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("failed to begin recording secondary command buffer!");
+    }
+
+    (*_job)(commandBuffer, part, _partCount);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to record secondary command buffer!");
+    }
+}
@@ -0,0 +1,157 @@
+//
+// GpuProfiler class definition
+//
+
+#include <hpg/GpuProfiler.h>
+
+#include <common/vkinit.h>
+#include <common/Print.h>
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+//-Initialisation and cleanup----------------------------------------------------------------------------------------//
+
+void GpuProfiler::init(const VulkanContext* context, const char* const* scopeNames, UI32 scopeCount) {
+    _context = context;
+    _names.assign(scopeNames, scopeNames + scopeCount);
+    _recorded.assign(scopeCount, false);
+    _history.assign(static_cast<size_t>(scopeCount) * GPU_PROFILER_HISTORY, 0.0f);
+    _results.resize(scopeCount * 4);
+    _submitted.fill(false);
+    _collected = 0;
+
+    // timestamps are written on the graphics queue, a family without valid bits does not support them
+    UI32 graphicsFamily = _context->queueFamilyIndices.graphicsFamily.value();
+    UI32 familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(_context->physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(_context->physicalDevice, &familyCount, families.data());
+
+    UI32 validBits = families[graphicsFamily].timestampValidBits;
+    _period = _context->deviceProperties.limits.timestampPeriod;
+    _enabled = validBits > 0 && _period > 0.0;
+    if (!_enabled) {
+        print("Queue family %u has no timestamps, gpu profiling is disabled\n", graphicsFamily);
+        return;
+    }
+    _mask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkQueryPoolCreateInfo poolInfo = vkinit::queryPoolCreateInfo(VK_QUERY_TYPE_TIMESTAMP, scopeCount * 2);
+    for (VkQueryPool& pool : _queryPools) {
+        if (vkCreateQueryPool(_context->device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create timestamp query pool!");
+        }
+    }
+}
+
+void GpuProfiler::cleanup() {
+    for (VkQueryPool& pool : _queryPools) {
+        if (pool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(_context->device, pool, nullptr);
+            pool = VK_NULL_HANDLE;
+        }
+    }
+    _enabled = false;
+}
+
+//-Recording---------------------------------------------------------------------------------------------------------//
+
+void GpuProfiler::reset(VkCommandBuffer commandBuffer, UI32 frame) {
+    if (_enabled) {
+        vkCmdResetQueryPool(commandBuffer, _queryPools[frame], 0, scopeCount() * 2);
+    }
+}
+
+void GpuProfiler::begin(VkCommandBuffer commandBuffer, UI32 frame, UI32 scope) {
+    if (_enabled) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPools[frame], scope * 2);
+    }
+}
+
+void GpuProfiler::end(VkCommandBuffer commandBuffer, UI32 frame, UI32 scope) {
+    if (_enabled) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPools[frame], scope * 2 + 1);
+    }
+}
+
+//-Results-----------------------------------------------------------------------------------------------------------//
+
+void GpuProfiler::submitted(UI32 frame) {
+    _submitted[frame] = _enabled;
+}
+
+void GpuProfiler::collect(UI32 frame) {
+    if (!_submitted[frame]) {
+        return;
+    }
+    _submitted[frame] = false;
+
+    // the frame's fence has signalled, so every timestamp it wrote is available. Those it did not write are
+    // reported unavailable rather than waited on, the call returns VK_NOT_READY then
+    VkResult result = vkGetQueryPoolResults(_context->device, _queryPools[frame], 0, scopeCount() * 2,
+        _results.size() * sizeof(UI64), _results.data(), 2 * sizeof(UI64),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (result != VK_SUCCESS && result != VK_NOT_READY) {
+        return;
+    }
+
+    UI32 slot = historyOffset();
+    for (UI32 scope = 0; scope < scopeCount(); scope++) {
+        const UI64* begin = &_results[scope * 4];
+        const UI64* end = begin + 2;
+        F32 milliseconds = 0.0f;
+        if (begin[1] && end[1]) {
+            // the counter may have wrapped between the two within its valid bits
+            UI64 ticks = (end[0] - begin[0]) & _mask;
+            milliseconds = static_cast<F32>(ticks * _period * 1e-6);
+            _recorded[scope] = true;
+        }
+        _history[scope * GPU_PROFILER_HISTORY + slot] = milliseconds;
+    }
+    _collected++;
+}
+
+F32 GpuProfiler::average(UI32 scope) const {
+    UI64 count = std::min<UI64>(_collected, GPU_PROFILER_HISTORY);
+    if (count == 0) {
+        return 0.0f;
+    }
+
+    F64 sum = 0.0;
+    for (UI32 i = 0; i < count; i++) {
+        sum += history(scope)[i];
+    }
+    return static_cast<F32>(sum / count);
+}
+
+bool GpuProfiler::writeCsv(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) {
+        print("Could not open %s for writing\n", path.c_str());
+        return false;
+    }
+
+    file << "frame";
+    for (UI32 scope = 0; scope < scopeCount(); scope++) {
+        if (_recorded[scope]) {
+            file << "," << _names[scope] << " (ms)";
+        }
+    }
+    file << "\n";
+
+    // oldest frame first, frames are numbered from the first one collected
+    UI64 count = std::min<UI64>(_collected, GPU_PROFILER_HISTORY);
+    UI64 first = _collected - count;
+    for (UI64 frame = first; frame < _collected; frame++) {
+        file << frame;
+        for (UI32 scope = 0; scope < scopeCount(); scope++) {
+            if (_recorded[scope]) {
+                file << "," << history(scope)[frame % GPU_PROFILER_HISTORY];
+            }
+        }
+        file << "\n";
+    }
+    return true;
+}
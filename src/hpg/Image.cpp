@@ -10,6 +10,19 @@
 // image loading
 #include <stb_image.h>
 
+VkImage Image::createImage(const VulkanContext& context, const VkImageCreateInfo& imageCreateInfo,
+    VkMemoryPropertyFlags properties, MemoryAllocator::Allocation* pAllocation) {
+    VkImage image;
+    if (vkCreateImage(context.device, &imageCreateInfo, nullptr, &image) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create image!");
+    }
+
+    // sub-allocate the image's memory and bind it
+    *pAllocation = context.allocator.allocateImageMemory(image, properties);
+
+    return image;
+}
+
 VkImageView Image::createImageView(const VulkanContext* vkSetup, const VkImageViewCreateInfo& imageViewCreateInfo) {
     VkImageView imageView;
     if (vkCreateImageView(vkSetup->device, &imageViewCreateInfo, nullptr, &imageView) != VK_SUCCESS) {
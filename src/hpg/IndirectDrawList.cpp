@@ -0,0 +1,169 @@
+//
+// IndirectDrawList class definition
+//
+
+#include <hpg/IndirectDrawList.h>
+
+#include <common/vkinit.h>
+#include <common/CompactVertex.h>
+
+#include <stdexcept>
+
+// push constants of cull.comp
+struct CullConstants {
+    UI32 recordCount;
+    UI32 packCommands; // visible commands are packed and counted, for draws with a count buffer
+};
+
+//-Initialisation and cleanup----------------------------------------------------------------------------------------//
+
+void IndirectDrawList::init(Renderer& renderer, const std::vector<IndirectDrawRecord>& records,
+    VkDeviceSize uniformOffset) {
+    _context = &renderer._context;
+    _recordCount = static_cast<UI32>(records.size());
+
+    _records = Buffer::createDeviceLocalBuffer(_context, renderer._uploadContext,
+        BufferData{ (UC*)records.data(), records.size() * sizeof(IndirectDrawRecord) },
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+    // written by the culling shader and read by the draw of the same frame
+    UI32 sliceCount = renderer._uniformArena.sliceCount();
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    _commands.resize(sliceCount);
+    _counts.resize(sliceCount);
+    for (UI32 i = 0; i < sliceCount; i++) {
+        _commands[i] = Buffer::createBuffer(*_context, _recordCount * sizeof(VkDrawIndexedIndirectCommand), usage,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        _counts[i] = Buffer::createBuffer(*_context, sizeof(UI32), usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+
+    PipelineState state{ CULL_DESCRIPTOR_LAYOUT, VERTEX_FORMAT_FULL, VK_NULL_HANDLE, 0 };
+    _pipeline = renderer._pipelines.request("cull", state, [&renderer](const PipelineState& state, VkPipelineCache cache) {
+        return buildCullPipeline(renderer, state, cache);
+    });
+
+    // a set per slice, the uniforms of the slice are selected with the dynamic offset when culling
+    _descriptorPool = renderer._descriptorPool;
+    std::vector<VkDescriptorSetLayout> layouts(sliceCount, renderer._descriptorSetLayouts[CULL_DESCRIPTOR_LAYOUT]);
+    VkDescriptorSetAllocateInfo allocInfo = vkinit::descriptorSetAllocInfo(_descriptorPool, sliceCount,
+        layouts.data());
+
+    _descriptorSets.resize(sliceCount);
+    if (vkAllocateDescriptorSets(_context->device, &allocInfo, _descriptorSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate culling descriptor sets!");
+    }
+
+    VkDescriptorBufferInfo uniformInfo = renderer._uniformArena.descriptorInfo(uniformOffset, sizeof(OffscreenUBO));
+    VkDescriptorBufferInfo recordsInfo{ _records._vkBuffer, 0, VK_WHOLE_SIZE };
+    for (UI32 i = 0; i < sliceCount; i++) {
+        VkDescriptorBufferInfo commandsInfo{ _commands[i]._vkBuffer, 0, VK_WHOLE_SIZE };
+        VkDescriptorBufferInfo countInfo{ _counts[i]._vkBuffer, 0, VK_WHOLE_SIZE };
+
+        VkWriteDescriptorSet writeDescriptorSets[4] = {
+            vkinit::writeDescriptorSet(_descriptorSets[i], CULL_UNIFORM_BINDING,
+                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &uniformInfo),
+            vkinit::writeDescriptorSet(_descriptorSets[i], CULL_RECORDS_BINDING,
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &recordsInfo),
+            vkinit::writeDescriptorSet(_descriptorSets[i], CULL_COMMANDS_BINDING,
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &commandsInfo),
+            vkinit::writeDescriptorSet(_descriptorSets[i], CULL_COUNT_BINDING,
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &countInfo)
+        };
+
+        vkUpdateDescriptorSets(_context->device, 4, writeDescriptorSets, 0, nullptr);
+    }
+}
+
+void IndirectDrawList::cleanup(Renderer& renderer) {
+    // the pipeline belongs to the renderer's registry
+    vkFreeDescriptorSets(renderer._context.device, _descriptorPool, static_cast<UI32>(_descriptorSets.size()),
+        _descriptorSets.data());
+    _descriptorSets.clear();
+
+    for (UI32 i = 0; i < _commands.size(); i++) {
+        _commands[i].cleanupBufferData(renderer._context.device);
+        _counts[i].cleanupBufferData(renderer._context.device);
+    }
+    _commands.clear();
+    _counts.clear();
+
+    _records.cleanupBufferData(renderer._context.device);
+    _recordCount = 0;
+}
+
+PipelineRegistry::Pipeline IndirectDrawList::buildCullPipeline(const Renderer& renderer, const PipelineState& state,
+    VkPipelineCache cache) {
+    PipelineRegistry::Pipeline pipeline;
+
+    VkPushConstantRange constantsRange{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants) };
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vkinit::pipelineLayoutCreateInfo(1,
+        &renderer._descriptorSetLayouts[state.type]);
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &constantsRange;
+
+    if (vkCreatePipelineLayout(renderer._context.device, &pipelineLayoutCreateInfo, nullptr, &pipeline.layout)
+        != VK_SUCCESS) {
+        throw std::runtime_error("Could not create culling pipeline layout!");
+    }
+
+    VkShaderModule shaderModule = renderer._shaders.get(kShaders[state.type].first);
+
+    VkComputePipelineCreateInfo pipelineCreateInfo{};
+    pipelineCreateInfo.sType  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineCreateInfo.stage  = vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT, shaderModule,
+        "main");
+    pipelineCreateInfo.layout = pipeline.layout;
+
+    if (vkCreateComputePipelines(renderer._context.device, cache, 1, &pipelineCreateInfo, nullptr, &pipeline.pipeline)
+        != VK_SUCCESS) {
+        throw std::runtime_error("Could not create culling pipeline!");
+    }
+
+    return pipeline;
+}
+
+//-Recording---------------------------------------------------------------------------------------------------------//
+
+void IndirectDrawList::cull(VkCommandBuffer commandBuffer, UI32 slice, UI32 dynamicOffset) const {
+    // the previous use of the slice has completed, its fence was waited on before recording or submitting again
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+
+    // the shader counts the visible records
+    if (_context->drawIndirectCount) {
+        vkCmdFillBuffer(commandBuffer, _counts[slice]._vkBuffer, 0, sizeof(UI32), 0);
+
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+            1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline->layout, 0, 1,
+        &_descriptorSets[slice], 1, &dynamicOffset);
+
+    CullConstants constants{ _recordCount, _context->drawIndirectCount ? 1u : 0u };
+    vkCmdPushConstants(commandBuffer, _pipeline->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants),
+        &constants);
+    vkCmdDispatch(commandBuffer, (_recordCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+
+    // commands and count are consumed by the draw
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+        1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void IndirectDrawList::draw(VkCommandBuffer commandBuffer, UI32 slice) const {
+    if (_context->drawIndirectCount) {
+        _context->cmdDrawIndexedIndirectCount(commandBuffer, _commands[slice]._vkBuffer, 0, _counts[slice]._vkBuffer,
+            0, _recordCount, sizeof(VkDrawIndexedIndirectCommand));
+    }
+    else {
+        // culled commands draw no instances
+        vkCmdDrawIndexedIndirect(commandBuffer, _commands[slice]._vkBuffer, 0, _recordCount,
+            sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
@@ -1,20 +1,49 @@
 #include <hpg/Material.h>
-#include <hpg/Shader.h>
 
 #include <common/Vertex.h>
 #include <common/vkinit.h>
 #include <common/Print.h>
 
-void Material::createPipeline(Renderer& renderer, kDescriptorSetLayout type) {
+void Material::createPipeline(Renderer& renderer, kDescriptorSetLayout type, kVertexFormat vertexFormat) {
     // store descriptor pool
     _descriptorPool = renderer._descriptorPool;
 
+    _pipeline = requestPipeline(renderer, type, vertexFormat);
+}
+
+const PipelineRegistry::Pipeline* Material::requestPipeline(Renderer& renderer, kDescriptorSetLayout type,
+    kVertexFormat vertexFormat) {
+    // materials of the same type share the pipeline owned by the renderer's registry, it is compiled on a
+    // worker thread while the rest of the model is uploaded
+    PipelineState state{ type, vertexFormat, renderer._renderPass, OFFSCREEN_SUBPASS };
+    return renderer._pipelines.request(
+        vertexFormat == VERTEX_FORMAT_COMPACT ? std::string(kShaders[type].second) + " (compact)" : kShaders[type].second,
+        state, [&renderer](const PipelineState& state, VkPipelineCache cache) {
+            return buildPipeline(renderer, state, cache);
+        });
+}
+
+PipelineRegistry::Pipeline Material::buildPipeline(const Renderer& renderer, const PipelineState& state,
+    VkPipelineCache cache) {
+    kDescriptorSetLayout type = static_cast<kDescriptorSetLayout>(state.type);
+    PipelineRegistry::Pipeline pipeline;
+
 	// create pipeline layout
     {
+        // indirect draws read the bindless set, their material comes in as the first instance
+        kDescriptorSetLayout setLayout = type == OFFSCREEN_INDIRECT_DESCRIPTOR_LAYOUT ? 
+            OFFSCREEN_BINDLESS_DESCRIPTOR_LAYOUT : type;
         VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vkinit::pipelineLayoutCreateInfo(1, 
-            &renderer._descriptorSetLayouts[type]);
+            &renderer._descriptorSetLayouts[setLayout]);
+
+        // index of the material drawn, into the bindless material buffer
+        VkPushConstantRange materialRange{ VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(UI32) };
+        if (type == OFFSCREEN_BINDLESS_DESCRIPTOR_LAYOUT) {
+            pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+            pipelineLayoutCreateInfo.pPushConstantRanges = &materialRange;
+        }
 
-        if (vkCreatePipelineLayout(renderer._context.device, &pipelineLayoutCreateInfo, nullptr, &_pipelineLayout) 
+        if (vkCreatePipelineLayout(renderer._context.device, &pipelineLayoutCreateInfo, nullptr, &pipeline.layout) 
             != VK_SUCCESS) {
             throw std::runtime_error("Could not create deferred pipeline layout!");
         }
@@ -57,23 +86,27 @@ void Material::createPipeline(Renderer& renderer, kDescriptorSetLayout type) {
         VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = 
             vkinit::pipelineDynamicStateCreateInfo(dynamicStateEnables, 2);
 
-        auto bindingDescription = Vertex::getBindingDescriptions(0);
+        bool compact = state.vertexFormat == VERTEX_FORMAT_COMPACT;
+
+        auto bindingDescription = compact ? CompactVertex::getBindingDescriptions(0) : Vertex::getBindingDescriptions(0);
         auto attributeDescriptions = Vertex::getAttributeDescriptions(0);
+        auto compactAttributeDescriptions = CompactVertex::getAttributeDescriptions(0);
 
-        VkPipelineVertexInputStateCreateInfo   vertexInputStateCreateInfo =
+        VkPipelineVertexInputStateCreateInfo   vertexInputStateCreateInfo = compact ?
+            vkinit::pipelineVertexInputStateCreateInfo(1, &bindingDescription,
+                static_cast<uint32_t>(compactAttributeDescriptions.size()), compactAttributeDescriptions.data()) :
             vkinit::pipelineVertexInputStateCreateInfo(1, &bindingDescription,
                 static_cast<uint32_t>(attributeDescriptions.size()), attributeDescriptions.data());
 
-        VkShaderModule vertShaderModule, fragShaderModule;
-        vertShaderModule = Shader::createShaderModule(&renderer._context, Shader::readFile(kShaders[type].first));
-        fragShaderModule = Shader::createShaderModule(&renderer._context, Shader::readFile(kShaders[type].second));
+        VkShaderModule vertShaderModule = renderer._shaders.get(compact ? kCompactVertexShader : kShaders[type].first);
+        VkShaderModule fragShaderModule = renderer._shaders.get(kShaders[type].second);
         std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{
             vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule, "main"),
             vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule, "main")
         };
 
         VkGraphicsPipelineCreateInfo pipelineCreateInfo =
-            vkinit::graphicsPipelineCreateInfo(_pipelineLayout, renderer._renderPass, OFFSCREEN_SUBPASS);
+            vkinit::graphicsPipelineCreateInfo(pipeline.layout, state.renderPass, state.subpass);
 
         pipelineCreateInfo.stageCount          = static_cast<uint32_t>(shaderStages.size());
         pipelineCreateInfo.pStages             = shaderStages.data();
@@ -86,21 +119,21 @@ void Material::createPipeline(Renderer& renderer, kDescriptorSetLayout type) {
         pipelineCreateInfo.pRasterizationState = &rasterizerStateCreateInfo;
         pipelineCreateInfo.pInputAssemblyState = &inputAssemblyStateCreateInfo;
 
-        if (vkCreateGraphicsPipelines(renderer._context.device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, 
-            &_pipeline) != VK_SUCCESS) {
+        if (vkCreateGraphicsPipelines(renderer._context.device, cache, 1, &pipelineCreateInfo, nullptr, 
+            &pipeline.pipeline) != VK_SUCCESS) {
             throw std::runtime_error("Could not create graphics pipeline!");
         }
-
-        vkDestroyShaderModule(renderer._context.device, vertShaderModule, nullptr);
-        vkDestroyShaderModule(renderer._context.device, fragShaderModule, nullptr);
     }
+
+    return pipeline;
 }
 
 void Material::cleanup(VkDevice device) {
     for (auto& texture : _textures) {
         texture.cleanup(device);
     }
-    vkFreeDescriptorSets(device, _descriptorPool, 1, &_descriptorSet);
-    vkDestroyPipeline(device, _pipeline, nullptr);
-    vkDestroyPipelineLayout(device, _pipelineLayout, nullptr);
+    // the pipeline belongs to the renderer's registry
+    if (_descriptorSet != VK_NULL_HANDLE) {
+        vkFreeDescriptorSets(device, _descriptorPool, 1, &_descriptorSet);
+    }
 }
\ No newline at end of file
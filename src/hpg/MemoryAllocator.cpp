@@ -0,0 +1,406 @@
+//
+// MemoryAllocator class definition
+//
+
+#include <hpg/MemoryAllocator.h>
+
+#include <common/vkinit.h>
+#include <common/Print.h>
+#include <common/Assert.h>
+
+#include <iterator>
+#include <stdexcept>
+
+// default size of a block, smaller heaps (integrated gpus, the host visible BAR heap) use a fraction of the heap
+const VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024ull * 1024ull;
+const VkDeviceSize SMALL_HEAP_SIZE    = 1024ull * 1024ull * 1024ull;
+
+static inline VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+//-Initialisation and cleanup----------------------------------------------------------------------------------------//
+
+void MemoryAllocator::init(VkPhysicalDevice physicalDevice, VkDevice device) {
+    _physicalDevice = physicalDevice;
+    _device = device;
+
+    vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &_memoryProperties);
+
+    _pools.resize(static_cast<size_t>(_memoryProperties.memoryTypeCount) * RESOURCE_TYPE_MAX_ENUM);
+}
+
+void MemoryAllocator::cleanup() {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (auto& pool : _pools) {
+        for (auto& block : pool) {
+            if (block.memory == VK_NULL_HANDLE) {
+                continue;
+            }
+            if (!block.allocations.empty()) {
+                print("MemoryAllocator: %zu allocation(s) still alive in block of %llu bytes\n",
+                    block.allocations.size(), (unsigned long long)block.size);
+            }
+            if (block.mapped) {
+                vkUnmapMemory(_device, block.memory);
+            }
+            vkFreeMemory(_device, block.memory, nullptr);
+        }
+        pool.clear();
+    }
+
+    for (auto& dedicated : _dedicated) {
+        if (dedicated._mapped) {
+            vkUnmapMemory(_device, dedicated._memory);
+        }
+        vkFreeMemory(_device, dedicated._memory, nullptr);
+    }
+    _dedicated.clear();
+}
+
+//-Allocation--------------------------------------------------------------------------------------------------------//
+
+MemoryAllocator::Allocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements,
+    VkMemoryPropertyFlags properties, kResourceType type, void* pUserData) {
+    Allocation allocation{};
+    allocation._memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+    allocation._size = requirements.size;
+    allocation._alignment = requirements.alignment > 0 ? requirements.alignment : 1;
+    allocation._type = type;
+    allocation._pUserData = pUserData;
+    allocation._pAllocator = this;
+
+    VkDeviceSize blockSize = preferredBlockSize(allocation._memoryType);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // large resources would waste most of a block, give them their own memory
+    if (requirements.size > blockSize / 2) {
+        allocation._memory = allocateDeviceMemory(requirements.size, allocation._memoryType, &allocation._mapped);
+        allocation._offset = 0;
+        allocation._dedicated = true;
+        _dedicated.push_back(allocation);
+        return allocation;
+    }
+
+    std::vector<Block>& pool = _pools[poolIndex(allocation._memoryType, type)];
+
+    // first fit in the existing blocks
+    for (UI32 i = 0; i < static_cast<UI32>(pool.size()); ++i) {
+        Block& block = pool[i];
+        if (block.memory == VK_NULL_HANDLE || block.size - block.used < requirements.size) {
+            continue;
+        }
+        if (allocateFromBlock(block, requirements.size, allocation._alignment, &allocation._offset)) {
+            allocation._memory = block.memory;
+            allocation._mapped = block.mapped ? block.mapped + allocation._offset : nullptr;
+            allocation._block = i;
+            block.allocations[allocation._offset] = allocation;
+            return allocation;
+        }
+    }
+
+    // no room, reuse a released slot or append a new block to the pool
+    UI32 blockIndex = static_cast<UI32>(pool.size());
+    for (UI32 i = 0; i < static_cast<UI32>(pool.size()); ++i) {
+        if (pool[i].memory == VK_NULL_HANDLE) {
+            blockIndex = i;
+            break;
+        }
+    }
+    if (blockIndex == pool.size()) {
+        pool.push_back({});
+    }
+
+    Block& block = pool[blockIndex];
+    block.memory = allocateDeviceMemory(blockSize, allocation._memoryType, &block.mapped);
+    block.size = blockSize;
+    block.used = 0;
+    block.freeRanges.clear();
+    block.freeRanges[0] = blockSize;
+    block.allocations.clear();
+
+    // larger requests are dedicated, so a fresh block always has room
+    if (!allocateFromBlock(block, requirements.size, allocation._alignment, &allocation._offset)) {
+        throw std::runtime_error("failed to allocate from a new memory block!");
+    }
+    allocation._memory = block.memory;
+    allocation._mapped = block.mapped ? block.mapped + allocation._offset : nullptr;
+    allocation._block = blockIndex;
+    block.allocations[allocation._offset] = allocation;
+
+    return allocation;
+}
+
+void MemoryAllocator::free(Allocation& allocation) {
+    if (allocation._memory == VK_NULL_HANDLE) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (allocation._dedicated) {
+        for (auto it = _dedicated.begin(); it != _dedicated.end(); ++it) {
+            if (it->_memory == allocation._memory) {
+                if (it->_mapped) {
+                    vkUnmapMemory(_device, it->_memory);
+                }
+                vkFreeMemory(_device, it->_memory, nullptr);
+                _dedicated.erase(it);
+                break;
+            }
+        }
+    }
+    else {
+        Block& block = _pools[poolIndex(allocation._memoryType, allocation._type)][allocation._block];
+        m_assert(block.memory == allocation._memory, "Allocation does not belong to the block it refers to");
+        block.allocations.erase(allocation._offset);
+        freeToBlock(block, allocation._offset, allocation._size);
+    }
+
+    allocation = Allocation{};
+}
+
+MemoryAllocator::Allocation MemoryAllocator::allocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties,
+    void* pUserData) {
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(_device, buffer, &memRequirements);
+
+    Allocation allocation = allocate(memRequirements, properties, LINEAR_RESOURCE, pUserData);
+
+    if (vkBindBufferMemory(_device, buffer, allocation._memory, allocation._offset) != VK_SUCCESS) {
+        throw std::runtime_error("failed to bind buffer memory!");
+    }
+
+    return allocation;
+}
+
+MemoryAllocator::Allocation MemoryAllocator::allocateImageMemory(VkImage image, VkMemoryPropertyFlags properties,
+    void* pUserData) {
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(_device, image, &memRequirements);
+
+    Allocation allocation = allocate(memRequirements, properties, OPTIMAL_RESOURCE, pUserData);
+
+    if (vkBindImageMemory(_device, image, allocation._memory, allocation._offset) != VK_SUCCESS) {
+        throw std::runtime_error("failed to bind image memory!");
+    }
+
+    return allocation;
+}
+
+//-Defragmentation---------------------------------------------------------------------------------------------------//
+
+std::vector<MemoryAllocator::DefragmentationMove> MemoryAllocator::beginDefragmentation(UI32 memoryType,
+    kResourceType type, UI32 maxMoves) {
+    std::vector<DefragmentationMove> moves;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::vector<Block>& pool = _pools[poolIndex(memoryType, type)];
+
+    // walk the blocks back to front, moving allocations into the free space of earlier blocks so that the
+    // last blocks empty out and can be handed back to the driver with releaseEmptyBlocks
+    for (I32 src = static_cast<I32>(pool.size()) - 1; src > 0 && moves.size() < maxMoves; --src) {
+        if (pool[src].memory == VK_NULL_HANDLE) {
+            continue;
+        }
+
+        // copy the keys first, the source block is not modified until the moves are committed
+        std::vector<Allocation> candidates;
+        for (auto& entry : pool[src].allocations) {
+            candidates.push_back(entry.second);
+        }
+
+        for (auto& candidate : candidates) {
+            if (moves.size() >= maxMoves) {
+                break;
+            }
+            for (I32 dst = 0; dst < src; ++dst) {
+                Block& block = pool[dst];
+                VkDeviceSize offset;
+                if (block.memory == VK_NULL_HANDLE || block.size - block.used < candidate._size ||
+                    !allocateFromBlock(block, candidate._size, candidate._alignment, &offset)) {
+                    continue;
+                }
+
+                Allocation destination = candidate;
+                destination._memory = block.memory;
+                destination._offset = offset;
+                destination._mapped = block.mapped ? block.mapped + offset : nullptr;
+                destination._block = static_cast<UI32>(dst);
+                block.allocations[offset] = destination;
+
+                moves.push_back({ candidate, destination });
+                break;
+            }
+        }
+    }
+
+    return moves;
+}
+
+void MemoryAllocator::endDefragmentation(std::vector<DefragmentationMove>& moves) {
+    // by now the owners have copied their data and rebound their resources, release the old ranges
+    for (auto& move : moves) {
+        free(move.src);
+    }
+    moves.clear();
+}
+
+UI32 MemoryAllocator::releaseEmptyBlocks() {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    UI32 released = 0;
+    for (auto& pool : _pools) {
+        for (auto& block : pool) {
+            if (block.memory == VK_NULL_HANDLE || block.used > 0) {
+                continue;
+            }
+            if (block.mapped) {
+                vkUnmapMemory(_device, block.memory);
+            }
+            vkFreeMemory(_device, block.memory, nullptr);
+            // the slot is kept so that block indices held by live allocations stay valid
+            block = Block{};
+            ++released;
+        }
+    }
+
+    return released;
+}
+
+//-Statistics--------------------------------------------------------------------------------------------------------//
+
+MemoryAllocator::Statistics MemoryAllocator::statistics() {
+    Statistics stats{};
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    for (size_t i = 0; i < _pools.size(); ++i) {
+        UI32 heapIndex = _memoryProperties.memoryTypes[i / RESOURCE_TYPE_MAX_ENUM].heapIndex;
+        for (auto& block : _pools[i]) {
+            if (block.memory == VK_NULL_HANDLE) {
+                continue;
+            }
+            stats.blockCount++;
+            stats.allocationCount += static_cast<UI32>(block.allocations.size());
+            stats.reservedBytes += block.size;
+            stats.usedBytes += block.used;
+            stats.heapUsage[heapIndex] += block.size;
+        }
+    }
+
+    for (auto& dedicated : _dedicated) {
+        stats.dedicatedCount++;
+        stats.allocationCount++;
+        stats.reservedBytes += dedicated._size;
+        stats.usedBytes += dedicated._size;
+        stats.heapUsage[_memoryProperties.memoryTypes[dedicated._memoryType].heapIndex] += dedicated._size;
+    }
+
+    return stats;
+}
+
+void MemoryAllocator::printStatistics() {
+    Statistics stats = statistics();
+
+    print("MemoryAllocator: %u block(s), %u dedicated, %u allocation(s), %.2f / %.2f MiB used\n",
+        stats.blockCount, stats.dedicatedCount, stats.allocationCount,
+        stats.usedBytes / (1024.0 * 1024.0), stats.reservedBytes / (1024.0 * 1024.0));
+
+    for (UI32 i = 0; i < _memoryProperties.memoryHeapCount; ++i) {
+        print("\theap %u: %.2f MiB of %.2f MiB\n", i, stats.heapUsage[i] / (1024.0 * 1024.0),
+            _memoryProperties.memoryHeaps[i].size / (1024.0 * 1024.0));
+    }
+}
+
+//-Helpers-----------------------------------------------------------------------------------------------------------//
+
+UI32 MemoryAllocator::findMemoryType(UI32 typeFilter, VkMemoryPropertyFlags properties) {
+    for (UI32 i = 0; i < _memoryProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("failed to find suitable memory type!");
+}
+
+VkDeviceSize MemoryAllocator::preferredBlockSize(UI32 memoryType) {
+    VkDeviceSize heapSize = _memoryProperties.memoryHeaps[_memoryProperties.memoryTypes[memoryType].heapIndex].size;
+    return heapSize <= SMALL_HEAP_SIZE ? alignUp(heapSize / 8, 32) : DEFAULT_BLOCK_SIZE;
+}
+
+VkDeviceMemory MemoryAllocator::allocateDeviceMemory(VkDeviceSize size, UI32 memoryType, UC** ppMapped) {
+    VkMemoryAllocateInfo allocInfo = vkinit::memoryAllocateInfo(size, memoryType);
+
+    VkDeviceMemory memory;
+    if (vkAllocateMemory(_device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate device memory!");
+    }
+
+    // host visible memory stays mapped until it is freed
+    *ppMapped = nullptr;
+    if (_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        void* data;
+        if (vkMapMemory(_device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS) {
+            throw std::runtime_error("failed to map device memory!");
+        }
+        *ppMapped = static_cast<UC*>(data);
+    }
+
+    return memory;
+}
+
+bool MemoryAllocator::allocateFromBlock(Block& block, VkDeviceSize size, VkDeviceSize alignment,
+    VkDeviceSize* pOffset) {
+    for (auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it) {
+        VkDeviceSize rangeOffset = it->first;
+        VkDeviceSize rangeSize = it->second;
+        VkDeviceSize alignedOffset = alignUp(rangeOffset, alignment);
+        VkDeviceSize padding = alignedOffset - rangeOffset;
+
+        if (padding + size > rangeSize) {
+            continue;
+        }
+
+        // split the range, the alignment padding and the tail go back to the free list
+        block.freeRanges.erase(it);
+        if (padding > 0) {
+            block.freeRanges[rangeOffset] = padding;
+        }
+        if (rangeSize - padding - size > 0) {
+            block.freeRanges[alignedOffset + size] = rangeSize - padding - size;
+        }
+
+        block.used += size;
+        *pOffset = alignedOffset;
+        return true;
+    }
+
+    return false;
+}
+
+void MemoryAllocator::freeToBlock(Block& block, VkDeviceSize offset, VkDeviceSize size) {
+    block.used -= size;
+
+    auto it = block.freeRanges.emplace(offset, size).first;
+
+    // merge with the following range
+    auto next = std::next(it);
+    if (next != block.freeRanges.end() && it->first + it->second == next->first) {
+        it->second += next->second;
+        block.freeRanges.erase(next);
+    }
+
+    // merge with the preceding range
+    if (it != block.freeRanges.begin()) {
+        auto prev = std::prev(it);
+        if (prev->first + prev->second == it->first) {
+            prev->second += it->second;
+            block.freeRanges.erase(it);
+        }
+    }
+}
@@ -0,0 +1,256 @@
+//
+// PipelineRegistry class definition
+//
+
+#include <hpg/PipelineRegistry.h>
+
+#include <common/Print.h>
+#include <common/JobSystem.h>
+#include <common/Profiler.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+size_t PipelineStateHash::operator()(const PipelineState& state) const {
+    // FNV-1a over each field, the struct itself may contain padding
+    UI64 hash = 14695981039346656037ull;
+    auto combine = [&hash](const void* data, size_t size) {
+        const UC* bytes = static_cast<const UC*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+    combine(&state.type, sizeof(state.type));
+    combine(&state.vertexFormat, sizeof(state.vertexFormat));
+    combine(&state.renderPass, sizeof(state.renderPass));
+    combine(&state.subpass, sizeof(state.subpass));
+    return static_cast<size_t>(hash);
+}
+
+//-Initialisation and cleanup----------------------------------------------------------------------------------------//
+
+void PipelineRegistry::init(const VulkanContext* context, const std::string& cachePath) {
+    _context = context;
+    _cachePath = cachePath;
+
+    // seed the cache with the data of a previous run on the same device and driver
+    std::vector<UC> data;
+    std::ifstream file(_cachePath, std::ios::binary);
+    if (file.is_open()) {
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if (!isCompatible(data)) {
+            print("Ignoring pipeline cache %s, it was written by another device or driver\n", _cachePath.c_str());
+            data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo cacheCreateInfo{};
+    cacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheCreateInfo.initialDataSize = data.size();
+    cacheCreateInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(_context->device, &cacheCreateInfo, nullptr, &_cache) != VK_SUCCESS) {
+        throw std::runtime_error("Could not create pipeline cache!");
+    }
+
+    // a fixed few next to the job system's threads, which load the scene meanwhile
+    _stopping = false;
+    for (UI32 i = 0; i < PIPELINE_BUILD_THREADS; i++) {
+        _workers.emplace_back(&PipelineRegistry::work, this);
+    }
+}
+
+void PipelineRegistry::cleanup() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _condition.notify_all();
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+    _workers.clear();
+    _jobs.clear();
+    _backgroundJobs.clear();
+
+    save();
+
+    // pipelines whose build was dropped or failed still hold null handles
+    for (auto& entry : _pipelines) {
+        vkDestroyPipeline(_context->device, entry.second.pipeline, nullptr);
+        vkDestroyPipelineLayout(_context->device, entry.second.layout, nullptr);
+    }
+    _pipelines.clear();
+
+    vkDestroyPipelineCache(_context->device, _cache, nullptr);
+    _cache = VK_NULL_HANDLE;
+}
+
+//-Pipelines---------------------------------------------------------------------------------------------------------//
+
+const PipelineRegistry::Pipeline* PipelineRegistry::request(const std::string& name, const PipelineState& state,
+    const Builder& build, bool background) {
+    if (_requests++ == 0) {
+        _firstRequest = Clock::now();
+    }
+
+    auto it = _pipelines.find(state);
+    if (it != _pipelines.end()) {
+        // a pipeline the first frame needs can not stay behind background builds
+        if (!background && it->second.background) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto job = std::find_if(_backgroundJobs.begin(), _backgroundJobs.end(),
+                [&it](const Job& job) { return job.entry == &it->second; });
+            if (job != _backgroundJobs.end()) {
+                _jobs.push_back(std::move(*job));
+                _backgroundJobs.erase(job);
+            }
+            it->second.background = false;
+        }
+        return &it->second;
+    }
+
+    // map nodes never move, the worker writes the handles straight into the entry
+    Entry& entry = _pipelines[state];
+    entry.name = name;
+    entry.background = background;
+
+    Job job{ &entry, state, build, std::promise<void>() };
+    entry.built = job.done.get_future().share();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        (background ? _backgroundJobs : _jobs).push_back(std::move(job));
+    }
+    _condition.notify_one();
+
+    return &entry;
+}
+
+void PipelineRegistry::wait(const Pipeline* pipeline) const {
+    // every pipeline handed out is the base of an entry
+    static_cast<const Entry*>(pipeline)->built.get();
+}
+
+void PipelineRegistry::waitRequired() const {
+    for (const auto& entry : _pipelines) {
+        if (!entry.second.background) {
+            entry.second.built.get();
+        }
+    }
+}
+
+void PipelineRegistry::printTimings() const {
+    F64 buildTime = 0.0;
+    Clock::time_point lastFinished = _firstRequest;
+    size_t built = 0;
+
+    for (const auto& entry : _pipelines) {
+        const Entry& pipeline = entry.second;
+        if (pipeline.built.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            print("    %-32s still building\n", pipeline.name.c_str());
+            continue;
+        }
+
+        print("    %-32s %8.2f ms%s\n", pipeline.name.c_str(), pipeline.buildTime,
+            pipeline.background ? " (background)" : "");
+        buildTime += pipeline.buildTime;
+        lastFinished = std::max(lastFinished, pipeline.finished);
+        built++;
+    }
+
+    F64 wallTime = std::chrono::duration<F64, std::milli>(lastFinished - _firstRequest).count();
+    print("Built %zu pipelines on %zu threads: %.2f ms of compilation in %.2f ms\n", built, _workers.size(), buildTime,
+        wallTime);
+}
+
+void PipelineRegistry::work() {
+    PROFILE_THREAD("pipeline builder");
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this]() { return _stopping || !_jobs.empty() || !_backgroundJobs.empty(); });
+            if (_stopping) {
+                return;
+            }
+
+            std::deque<Job>& queue = _jobs.empty() ? _backgroundJobs : _jobs;
+            job = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        Clock::time_point start = Clock::now();
+        std::exception_ptr error;
+        try {
+            PROFILE_ZONE("build pipeline");
+            Pipeline pipeline = job.build(job.state, _cache);
+            job.entry->pipeline = pipeline.pipeline;
+            job.entry->layout = pipeline.layout;
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+        // timings are written before waiters are released
+        job.entry->finished = Clock::now();
+        job.entry->buildTime = std::chrono::duration<F64, std::milli>(job.entry->finished - start).count();
+
+        if (error) {
+            job.done.set_exception(error);
+        }
+        else {
+            job.done.set_value();
+        }
+    }
+}
+
+//-Cache file--------------------------------------------------------------------------------------------------------//
+
+bool PipelineRegistry::isCompatible(const std::vector<UC>& data) const {
+    if (data.size() < sizeof(VkPipelineCacheHeaderVersionOne)) {
+        return false;
+    }
+
+    VkPipelineCacheHeaderVersionOne header;
+    std::memcpy(&header, data.data(), sizeof(header));
+
+    const VkPhysicalDeviceProperties& properties = _context->deviceProperties;
+    return header.headerSize >= sizeof(header) && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+        std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineRegistry::save() const {
+    size_t size = 0;
+    if (vkGetPipelineCacheData(_context->device, _cache, &size, nullptr) != VK_SUCCESS || size == 0) {
+        return;
+    }
+
+    std::vector<UC> data(size);
+    if (vkGetPipelineCacheData(_context->device, _cache, &size, data.data()) != VK_SUCCESS) {
+        return;
+    }
+
+    // written next to the old cache and swapped in, so an interrupted write never leaves a truncated cache
+    std::string temporaryPath = _cachePath + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open() || !file.write(reinterpret_cast<const char*>(data.data()), size)) {
+            print("Could not write pipeline cache %s\n", temporaryPath.c_str());
+            return;
+        }
+    }
+
+    // filesystem::rename replaces an existing file in one step, std::rename fails on windows if it exists
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, _cachePath, error);
+    if (error) {
+        print("Could not replace pipeline cache %s\n", _cachePath.c_str());
+    }
+}
@@ -1,14 +1,31 @@
 #include <hpg/Renderer.h>
-#include <hpg/Shader.h>
 #include <hpg/Image.h>
 
+#include <app/AppConstants.h>
+
 #include <common/vkinit.h>
 
+#include <cstdlib>
+
 void Renderer::init(GLFWwindow* window) {
 	_context.init(window);
 
+    // shader modules are created once and shared by every pipeline
+    const char* shaderDir = std::getenv(SHADER_DIR_VARIABLE);
+    _shaders.init(&_context, shaderDir ? shaderDir : SHADER_DIR);
+
+    // every pipeline is created through the cache saved by the previous run
+    _pipelines.init(&_context, PIPELINE_CACHE_PATH);
+
     createCommandPool(&_commandPools[RENDER_CMD_POOL], VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
     createCommandPool(&_commandPools[GUI_CMD_POOL], VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    _recorder.init(&_context, RECORDING_PART_COUNT);
+
+    static const char* gpuScopeNames[GPU_SCOPES_MAX_ENUM] = { "gbuffer", "skybox", "composition", "gui" };
+    _gpuProfiler.init(&_context, gpuScopeNames, GPU_SCOPES_MAX_ENUM);
+
+    // batches resource uploads, submitted on the transfer queue if the device has one
+    _uploadContext.init(&_context);
 
     _swapChain.create(_context);
 
@@ -26,8 +43,8 @@ void Renderer::init(GLFWwindow* window) {
     //
     createFramebuffers();
 
-    // command buffers
-    createCommandBuffers();
+    // command buffers of each frame in flight
+    createFrameCommandBuffers();
 
     // descriptor layouts
     createDescriptorPool();
@@ -36,9 +53,9 @@ void Renderer::init(GLFWwindow* window) {
     // composition pipeline
     createCompositionPipeline();
 
-    // create the uniform buffer for composition
-    _compositionUniforms = Buffer::createBuffer(_context, sizeof(CompositionUBO) * _swapChain.imageCount(), 0x10, 
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    // uniforms of every object live in the arena, one slice per swap chain image
+    _uniformArena.init(&_context, UNIFORM_ARENA_SLICE_SIZE, MAX_SWAPCHAIN_IMAGES);
+    _compositionUniformOffset = _uniformArena.reserve(sizeof(CompositionUBO));
 
     createCompositionDescriptorSets();
 
@@ -48,12 +65,14 @@ void Renderer::init(GLFWwindow* window) {
 }
 
 void Renderer::cleanup() {
-    for (UI32 i = 0; i < _swapChain.imageCount(); i++) {
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         vkDestroySemaphore(_context.device, _renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(_context.device, _imageAvailableSemaphores[i], nullptr);
         
         vkDestroyFence(_context.device, _inFlightFences[i], nullptr);
+    }
 
+    for (UI32 i = 0; i < _swapChain.imageCount(); i++) {
         vkDestroyFramebuffer(_context.device, _framebuffers[i], nullptr);
         vkDestroyFramebuffer(_context.device, _guiFramebuffers[i], nullptr);
     }
@@ -63,8 +82,9 @@ void Renderer::cleanup() {
     }
 
     // composition descriptors
-    _compositionUniforms.cleanupBufferData(_context.device);
-    vkFreeDescriptorSets(_context.device, _descriptorPool, _swapChain.imageCount(), _compositionDescriptorSets.data());
+    vkFreeDescriptorSets(_context.device, _descriptorPool, 1, &_compositionDescriptorSet);
+
+    _uniformArena.cleanup(_context.device);
 
     // descriptor set layouts used in application
     for (UI32 i = 0; i < DESCRIPTOR_SET_LAYOUT_MAX_ENUM; i++) {
@@ -72,10 +92,13 @@ void Renderer::cleanup() {
     }
     
     vkDestroyDescriptorPool(_context.device, _descriptorPool, nullptr);
+    vkDestroyDescriptorPool(_context.device, _bindlessDescriptorPool, nullptr);
 
-    // composition pipeline
-    vkDestroyPipeline(_context.device, _compositionPipeline, nullptr);
-    vkDestroyPipelineLayout(_context.device, _compositionPipelineLayout, nullptr);
+    // every pipeline, the cache is written back to disk
+    _pipelines.cleanup();
+
+    // after the pipelines, background builds may use the modules until the registry stops
+    _shaders.cleanup();
     
     vkDestroySampler(_context.device, _colorSampler, nullptr);
 
@@ -87,6 +110,14 @@ void Renderer::cleanup() {
 
     vkDestroyCommandPool(_context.device, _commandPools[RENDER_CMD_POOL], nullptr);
     vkDestroyCommandPool(_context.device, _commandPools[GUI_CMD_POOL], nullptr);
+    // destroying a pool frees its buffers
+    for (VkCommandPool pool : _frameCommandPools) {
+        vkDestroyCommandPool(_context.device, pool, nullptr);
+    }
+    _recorder.cleanup();
+    _gpuProfiler.cleanup();
+
+    _uploadContext.cleanup();
 
     _context.cleanup();
 }
@@ -95,8 +126,7 @@ void Renderer::resize() {
     UI32 imageCount = _swapChain.imageCount();
     {
         // delete descriptor set
-        vkFreeDescriptorSets(_context.device, _descriptorPool,
-            static_cast<UI32>(_compositionDescriptorSets.size()), _compositionDescriptorSets.data());
+        vkFreeDescriptorSets(_context.device, _descriptorPool, 1, &_compositionDescriptorSet);
 
         // delete framebuffers
         for (UI32 i = 0; i < imageCount; i++) {
@@ -125,22 +155,14 @@ void Renderer::resize() {
         createFramebuffers();
 
         createCompositionDescriptorSets();
+
+        // the device is idle, no image is in use by a frame anymore
+        _imagesInFlight.assign(_swapChain.imageCount(), VK_NULL_HANDLE);
     
         // if create the swapchain == false, only need to recreate the framebuffers
         if (hasNewImageCount) {
             // destroy structures dependent on old image count
             {
-                for (UI32 i = 0; i < imageCount; i++) {
-                    vkDestroySemaphore(_context.device, _renderFinishedSemaphores[i], nullptr);
-                    vkDestroySemaphore(_context.device, _imageAvailableSemaphores[i], nullptr);
-                    vkDestroyFence(_context.device, _inFlightFences[i], nullptr);
-                }
-
-                vkFreeCommandBuffers(_context.device, _commandPools[RENDER_CMD_POOL], 
-                    static_cast<UI32>(_renderCommandBuffers.size()), _renderCommandBuffers.data());
-                vkFreeCommandBuffers(_context.device, _commandPools[GUI_CMD_POOL],
-                    static_cast<UI32>(_guiCommandBuffers.size()), _guiCommandBuffers.data());
-
                 vkDestroyRenderPass(_context.device, _guiRenderPass, nullptr);
                 vkDestroyRenderPass(_context.device, _renderPass, nullptr);
             }
@@ -148,10 +170,6 @@ void Renderer::resize() {
             {
                 createRenderPass();
                 createGuiRenderPass();
-
-                createCommandBuffers();
-
-                createSyncObjects();
             }
         }
     }
@@ -171,17 +189,18 @@ void Renderer::createCommandPool(VkCommandPool* commandPool, VkCommandPoolCreate
 }
 
 void Renderer::createSyncObjects() {
-    _imageAvailableSemaphores.resize(_swapChain.imageCount());
-    _renderFinishedSemaphores.resize(_swapChain.imageCount());
+    // semaphores and fences are per frame in flight, independent of the swap chain image count
+    _imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+    _renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 
-    _inFlightFences.resize(_swapChain.imageCount());
+    _inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
     _imagesInFlight.resize(_swapChain.imageCount(), VK_NULL_HANDLE);
 
     VkSemaphoreCreateInfo semaphoreCreateInfo = vkinit::semaphoreCreateInfo();
 
     VkFenceCreateInfo fenceCreateInfo = vkinit::fenceCreateInfo(VK_FENCE_CREATE_SIGNALED_BIT);
 
-    for (UI32 i = 0; i < _swapChain.imageCount(); i++) {
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         if (vkCreateSemaphore(_context.device, &semaphoreCreateInfo, nullptr, &_imageAvailableSemaphores[i]) != VK_SUCCESS ||
             vkCreateSemaphore(_context.device, &semaphoreCreateInfo, nullptr, &_renderFinishedSemaphores[i]) != VK_SUCCESS) {
             throw std::runtime_error("failed to create semaphores!");
@@ -239,25 +258,8 @@ void Renderer::createAttachment(Attachment& attachment, VkImageUsageFlags usage,
         imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
         imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 
-        if (vkCreateImage(_context.device, &imageCreateInfo, nullptr, &attachment._image) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create image!");
-        }
-
-        // get memory requirements for this particular image
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(_context.device, attachment._image, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo = vkinit::memoryAllocateInfo(memRequirements.size,
-            utils::findMemoryType(_context.physicalDevice, memRequirements.memoryTypeBits,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
-
-        // allocate memory on device
-        if (vkAllocateMemory(_context.device, &allocInfo, nullptr, &attachment._memory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate image memory!");
-        }
-
-        // bind image to memory
-        vkBindImageMemory(_context.device, attachment._image, attachment._memory, 0);
+        attachment._image = Image::createImage(_context, imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            &attachment._allocation);
     }
 
     // create the image view
@@ -291,16 +293,17 @@ void Renderer::createColorSampler() {
     }
 }
 
-void Renderer::createCommandBuffers() {
-    _renderCommandBuffers.resize(_swapChain.imageCount());
-    _guiCommandBuffers.resize(_swapChain.imageCount());
-    VkCommandBufferAllocateInfo allocInfo = vkinit::commandBufferAllocateInfo(_commandPools[RENDER_CMD_POOL], 
-        VK_COMMAND_BUFFER_LEVEL_PRIMARY, _swapChain.imageCount());
-    if (vkAllocateCommandBuffers(_context.device, &allocInfo, _renderCommandBuffers.data()) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate command buffers!");
-    }
-    if (vkAllocateCommandBuffers(_context.device, &allocInfo, _guiCommandBuffers.data()) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate command buffers!");
+void Renderer::createFrameCommandBuffers() {
+    // independent of the swap chain, the pools are recycled by frame rather than by image
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        createCommandPool(&_frameCommandPools[i], VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+        VkCommandBufferAllocateInfo allocInfo = vkinit::commandBufferAllocateInfo(_frameCommandPools[i],
+            VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+        if (vkAllocateCommandBuffers(_context.device, &allocInfo, &_renderCommandBuffers[i]) != VK_SUCCESS ||
+            vkAllocateCommandBuffers(_context.device, &allocInfo, &_guiCommandBuffers[i]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate command buffers!");
+        }
     }
 }
 
@@ -329,6 +332,26 @@ void Renderer::createDescriptorPool() {
         VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor pool!");
     }
+
+    if (!_context.descriptorIndexing) {
+        return;
+    }
+
+    // bindless sets take as many textures as their model has out of the pool
+    std::vector<VkDescriptorPoolSize> bindlessPoolSizes = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, MAX_BINDLESS_SETS },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         MAX_BINDLESS_SETS },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, _context.maxBindlessTextures }
+    };
+
+    descriptorPoolCreateInfo = vkinit::descriptorPoolCreateInfo(MAX_BINDLESS_SETS,
+        static_cast<UI32>(bindlessPoolSizes.size()), bindlessPoolSizes.data(),
+        VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
+
+    if (vkCreateDescriptorPool(_context.device, &descriptorPoolCreateInfo, nullptr, &_bindlessDescriptorPool) !=
+        VK_SUCCESS) {
+        throw std::runtime_error("failed to create bindless descriptor pool!");
+    }
 }
 
 void Renderer::createDescriptorSetLayouts() {
@@ -340,7 +363,7 @@ void Renderer::createDescriptorSetLayouts() {
     // 0: default material (no textures, plain color)
     std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings = {
         // binding 0: vertex shader uniform buffer 
-        vkinit::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT),
+        vkinit::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT),
     };
 
     VkDescriptorSetLayoutCreateInfo descriptorSetlayoutCreateInfo = vkinit::descriptorSetLayoutCreateInfo(
@@ -354,7 +377,7 @@ void Renderer::createDescriptorSetLayouts() {
     // 1: PBR material
     descriptorSetLayoutBindings = {
         // binding 0: vertex shader uniform buffer 
-        vkinit::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT),
+        vkinit::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT),
         // binding 1: fragment shader albedo texture
         vkinit::descriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
         // binding 2: fragment shader occlusion metallic roughness texture
@@ -372,7 +395,7 @@ void Renderer::createDescriptorSetLayouts() {
     // 2: PBR material with normal map
     descriptorSetLayoutBindings = {
         // binding 0: vertex shader uniform buffer 
-        vkinit::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT),
+        vkinit::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT),
         // binding 1: fragment shader albedo texture
         vkinit::descriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
         // binding 2: fragment shader occlusion metallic roughness texture
@@ -389,10 +412,48 @@ void Renderer::createDescriptorSetLayouts() {
         throw std::runtime_error("failed to create descriptor set layout!");
     }
 
+    // bindless materials: every texture and material parameter of a model in one set
+    _descriptorSetLayouts[OFFSCREEN_BINDLESS_DESCRIPTOR_LAYOUT] = VK_NULL_HANDLE;
+    if (_context.descriptorIndexing) {
+        descriptorSetLayoutBindings = {
+            // binding 0: vertex shader uniform buffer 
+            vkinit::descriptorSetLayoutBinding(BINDLESS_UNIFORM_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                VK_SHADER_STAGE_VERTEX_BIT),
+            // binding 1: fragment shader material parameters
+            vkinit::descriptorSetLayoutBinding(BINDLESS_MATERIALS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                VK_SHADER_STAGE_FRAGMENT_BIT),
+            // binding 2: fragment shader textures, up to the device limit
+            vkinit::descriptorSetLayoutBinding(BINDLESS_TEXTURES_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                VK_SHADER_STAGE_FRAGMENT_BIT)
+        };
+        descriptorSetLayoutBindings[BINDLESS_TEXTURES_BINDING].descriptorCount = _context.maxBindlessTextures;
+
+        // unused slots stay unwritten, each set is allocated with the texture count of its model
+        std::array<VkDescriptorBindingFlagsEXT, 3> bindingFlags = { 0, 0,
+            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT_EXT };
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsCreateInfo{};
+        bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+        bindingFlagsCreateInfo.bindingCount = static_cast<UI32>(bindingFlags.size());
+        bindingFlagsCreateInfo.pBindingFlags = bindingFlags.data();
+
+        descriptorSetlayoutCreateInfo = vkinit::descriptorSetLayoutCreateInfo(
+            descriptorSetLayoutBindings.data(), static_cast<UI32>(descriptorSetLayoutBindings.size()));
+        descriptorSetlayoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+
+        if (vkCreateDescriptorSetLayout(_context.device, &descriptorSetlayoutCreateInfo, nullptr,
+            &_descriptorSetLayouts[OFFSCREEN_BINDLESS_DESCRIPTOR_LAYOUT]) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor set layout!");
+        }
+    }
+
+    // indirect draws bind the bindless set
+    _descriptorSetLayouts[OFFSCREEN_INDIRECT_DESCRIPTOR_LAYOUT] = VK_NULL_HANDLE;
+
     // 3: skybox
     descriptorSetLayoutBindings = {
         // binding 0: vertex shader uniform buffer 
-        vkinit::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT),
+        vkinit::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT),
         // binding 1: fragment shader texture sampler
         vkinit::descriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT),
     };
@@ -408,7 +469,7 @@ void Renderer::createDescriptorSetLayouts() {
     // 4: shadowmap
     descriptorSetLayoutBindings = {
         // binding 0: vertex shader uniform buffer 
-        vkinit::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+        vkinit::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
     };
 
     descriptorSetlayoutCreateInfo = vkinit::descriptorSetLayoutCreateInfo(
@@ -423,7 +484,7 @@ void Renderer::createDescriptorSetLayouts() {
 
     descriptorSetLayoutBindings = {
         // binding 0: composition fragment shader uniform buffer 
-        vkinit::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT),
+        vkinit::descriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_FRAGMENT_BIT),
         // binding 1: position input attachment
         vkinit::descriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT),
         // binding 2: normal input attachment
@@ -441,13 +502,54 @@ void Renderer::createDescriptorSetLayouts() {
         &_descriptorSetLayouts[COMPOSITION_DESCRIPTOR_LAYOUT]) != VK_SUCCESS) {
         throw std::runtime_error("failed to create descriptor set layout!");
     }
+
+    // CULLING:
+
+    _descriptorSetLayouts[CULL_DESCRIPTOR_LAYOUT] = VK_NULL_HANDLE;
+    if (!_context.indirectDraws) {
+        return;
+    }
+
+    descriptorSetLayoutBindings = {
+        // binding 0: uniform buffer of the model culled
+        vkinit::descriptorSetLayoutBinding(CULL_UNIFORM_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            VK_SHADER_STAGE_COMPUTE_BIT),
+        // binding 1: draw records
+        vkinit::descriptorSetLayoutBinding(CULL_RECORDS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            VK_SHADER_STAGE_COMPUTE_BIT),
+        // binding 2: indirect commands written for the visible records
+        vkinit::descriptorSetLayoutBinding(CULL_COMMANDS_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            VK_SHADER_STAGE_COMPUTE_BIT),
+        // binding 3: draw count
+        vkinit::descriptorSetLayoutBinding(CULL_COUNT_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            VK_SHADER_STAGE_COMPUTE_BIT)
+    };
+
+    descriptorSetlayoutCreateInfo = vkinit::descriptorSetLayoutCreateInfo(
+        descriptorSetLayoutBindings.data(), static_cast<UI32>(descriptorSetLayoutBindings.size()));
+
+    if (vkCreateDescriptorSetLayout(_context.device, &descriptorSetlayoutCreateInfo, nullptr,
+        &_descriptorSetLayouts[CULL_DESCRIPTOR_LAYOUT]) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create descriptor set layout!");
+    }
 }
 
 void Renderer::createCompositionPipeline() {
+    // compiled on a worker thread while the scene loads
+    PipelineState state{ COMPOSITION_DESCRIPTOR_LAYOUT, VERTEX_FORMAT_FULL, _renderPass, COMPOSITION_SUBPASS };
+    _compositionPipeline = _pipelines.request("composition", state,
+        [this](const PipelineState& state, VkPipelineCache cache) {
+            return buildCompositionPipeline(state, cache);
+        });
+}
+
+PipelineRegistry::Pipeline Renderer::buildCompositionPipeline(const PipelineState& state, VkPipelineCache cache) const {
+    PipelineRegistry::Pipeline pipeline;
+
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = 
         vkinit::pipelineLayoutCreateInfo(1, &_descriptorSetLayouts[COMPOSITION_DESCRIPTOR_LAYOUT]);
 
-    if (vkCreatePipelineLayout(_context.device, &pipelineLayoutCreateInfo, nullptr, &_compositionPipelineLayout) != VK_SUCCESS) {
+    if (vkCreatePipelineLayout(_context.device, &pipelineLayoutCreateInfo, nullptr, &pipeline.layout) != VK_SUCCESS) {
         throw std::runtime_error("Could not create composition pipeline layout!");
     }
 
@@ -457,7 +559,6 @@ void Renderer::createCompositionPipeline() {
     VkPipelineColorBlendAttachmentState colorBlendAttachment =
         vkinit::pipelineColorBlendAttachmentState(colBlendAttachFlag, VK_FALSE);
 
-    VkShaderModule vertShaderModule, fragShaderModule;
     std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages;
 
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateInfo =
@@ -486,7 +587,7 @@ void Renderer::createCompositionPipeline() {
         vkinit::pipelineVertexInputStateCreateInfo(0, nullptr, 0, nullptr); // no vertex data input
 
     VkGraphicsPipelineCreateInfo pipelineCreateInfo =
-        vkinit::graphicsPipelineCreateInfo(_compositionPipelineLayout, _renderPass, COMPOSITION_SUBPASS); // composition pipeline uses swapchain render pass
+        vkinit::graphicsPipelineCreateInfo(pipeline.layout, state.renderPass, state.subpass); // composition pipeline uses swapchain render pass
     pipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
     pipelineCreateInfo.pStages = shaderStages.data();
     pipelineCreateInfo.pInputAssemblyState = &inputAssemblyStateInfo;
@@ -499,24 +600,21 @@ void Renderer::createCompositionPipeline() {
     pipelineCreateInfo.pVertexInputState = &emptyVertexInputStateCreateInfo;
 
 #ifndef NDEBUG
-    vertShaderModule = Shader::createShaderModule(&_context, Shader::readFile("composition_debug.vert.spv"));
-    fragShaderModule = Shader::createShaderModule(&_context, Shader::readFile("composition_debug.frag.spv"));
+    VkShaderModule vertShaderModule = _shaders.get("composition_debug.vert.spv");
+    VkShaderModule fragShaderModule = _shaders.get("composition_debug.frag.spv");
 #else
-    vertShaderModule = Shader::createShaderModule(&_context, 
-        Shader::readFile(kShaders[COMPOSITION_DESCRIPTOR_LAYOUT].first));
-    fragShaderModule = Shader::createShaderModule(&_context, 
-        Shader::readFile(kShaders[COMPOSITION_DESCRIPTOR_LAYOUT].second));
+    VkShaderModule vertShaderModule = _shaders.get(kShaders[COMPOSITION_DESCRIPTOR_LAYOUT].first);
+    VkShaderModule fragShaderModule = _shaders.get(kShaders[COMPOSITION_DESCRIPTOR_LAYOUT].second);
 #endif
 
     shaderStages[0] = vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule, "main");
     shaderStages[1] = vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule, "main");
 
-    if (vkCreateGraphicsPipelines(_context.device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &_compositionPipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(_context.device, cache, 1, &pipelineCreateInfo, nullptr, &pipeline.pipeline) != VK_SUCCESS) {
         throw std::runtime_error("Could not create deferred graphics pipeline!");
     }
 
-    vkDestroyShaderModule(_context.device, vertShaderModule, nullptr);
-    vkDestroyShaderModule(_context.device, fragShaderModule, nullptr);
+    return pipeline;
 }
 
 void Renderer::createGuiRenderPass() {
@@ -562,15 +660,11 @@ void Renderer::createGuiRenderPass() {
 }
 
 void Renderer::createCompositionDescriptorSets() {
-    // we want one descriptor set per swap chain image
-    std::vector<VkDescriptorSetLayout> _compositionDescriptorSetLayouts(_swapChain.imageCount(), 
-        _descriptorSetLayouts[COMPOSITION_DESCRIPTOR_LAYOUT]);
-    _compositionDescriptorSets.resize(_compositionDescriptorSetLayouts.size());
+    // a single set is shared by all swap chain images, the uniform slice is selected with a dynamic offset
+    VkDescriptorSetAllocateInfo allocInfo = vkinit::descriptorSetAllocInfo(_descriptorPool, 1, 
+        &_descriptorSetLayouts[COMPOSITION_DESCRIPTOR_LAYOUT]);
 
-    VkDescriptorSetAllocateInfo allocInfo = vkinit::descriptorSetAllocInfo(_descriptorPool, 
-        static_cast<UI32>(_compositionDescriptorSetLayouts.size()), _compositionDescriptorSetLayouts.data());
-
-    if (vkAllocateDescriptorSets(_context.device, &allocInfo, _compositionDescriptorSets.data()) != VK_SUCCESS) {
+    if (vkAllocateDescriptorSets(_context.device, &allocInfo, &_compositionDescriptorSet) != VK_SUCCESS) {
         throw std::runtime_error("failed to allocate descriptor sets!");
     }
 
@@ -603,35 +697,29 @@ void Renderer::createCompositionDescriptorSets() {
     texDescriptorShadowMap.sampler = shadowMap.depthSampler;
     */
 
-    std::vector<VkWriteDescriptorSet> writeDescriptorSets{};
-
-    for (UI32 i = 0; i < _swapChain.imageCount(); i++) {
-        // forward rendering uniform buffer
-        VkDescriptorBufferInfo compositionUboInf{};
-        compositionUboInf.buffer = _compositionUniforms._vkBuffer;
-        compositionUboInf.offset = sizeof(CompositionUBO) * i;
-        compositionUboInf.range = sizeof(CompositionUBO);
-
-        // composition descriptor writes
-        writeDescriptorSets = {
-            // binding 1: shadow map
-            //vkinit::writeDescriptorSet(_compositionDescriptorSets[i], 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &texDescriptorShadowMap),
-            // binding 0: composition fragment shader uniform
-            vkinit::writeDescriptorSet(_compositionDescriptorSets[i], 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &compositionUboInf),
-            // binding 1: position input attachment 
-            vkinit::writeDescriptorSet(_compositionDescriptorSets[i], 1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, &texDescriptorPosition),
-            // binding 2: normal input attachment
-            vkinit::writeDescriptorSet(_compositionDescriptorSets[i], 2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, &texDescriptorNormal),
-            // binding 3: albedo input attachment
-            vkinit::writeDescriptorSet(_compositionDescriptorSets[i], 3, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, &texDescriptorAlbedo),
-            // binding 4: metallic roughness input attachment
-            vkinit::writeDescriptorSet(_compositionDescriptorSets[i], 4, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, &texDescriptorMetallicRoughness)
-        };
+    // composition uniform buffer
+    VkDescriptorBufferInfo compositionUboInf = _uniformArena.descriptorInfo(_compositionUniformOffset, 
+        sizeof(CompositionUBO));
+
+    // composition descriptor writes
+    std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+        // binding 1: shadow map
+        //vkinit::writeDescriptorSet(_compositionDescriptorSet, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &texDescriptorShadowMap),
+        // binding 0: composition fragment shader uniform
+        vkinit::writeDescriptorSet(_compositionDescriptorSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &compositionUboInf),
+        // binding 1: position input attachment 
+        vkinit::writeDescriptorSet(_compositionDescriptorSet, 1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, &texDescriptorPosition),
+        // binding 2: normal input attachment
+        vkinit::writeDescriptorSet(_compositionDescriptorSet, 2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, &texDescriptorNormal),
+        // binding 3: albedo input attachment
+        vkinit::writeDescriptorSet(_compositionDescriptorSet, 3, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, &texDescriptorAlbedo),
+        // binding 4: metallic roughness input attachment
+        vkinit::writeDescriptorSet(_compositionDescriptorSet, 4, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, &texDescriptorMetallicRoughness)
+    };
 
-        // update according to the configuration
-        vkUpdateDescriptorSets(_context.device, static_cast<UI32>(writeDescriptorSets.size()), 
-            writeDescriptorSets.data(), 0, nullptr);
-    }
+    // update according to the configuration
+    vkUpdateDescriptorSets(_context.device, static_cast<UI32>(writeDescriptorSets.size()), 
+        writeDescriptorSets.data(), 0, nullptr);
 }
 
 void Renderer::createRenderPass() {
@@ -0,0 +1,106 @@
+//
+// ShaderLibrary class definition
+//
+
+#include <hpg/ShaderLibrary.h>
+
+#include <app/AppConstants.h>
+
+#include <common/Print.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+//-Initialisation and cleanup----------------------------------------------------------------------------------------//
+
+void ShaderLibrary::init(const VulkanContext* context, const std::string& directory) {
+    _context = context;
+    _directory = directory;
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::error_code error;
+    std::filesystem::directory_iterator files(_directory, error);
+    if (error) {
+        throw std::runtime_error("Could not open shader directory " + _directory + "!");
+    }
+
+    for (const auto& file : files) {
+        if (!file.is_regular_file() || file.path().extension() != ".spv") {
+            continue;
+        }
+        std::string name = file.path().filename().string();
+
+        // words, so that the code handed to vulkan is aligned
+        std::ifstream stream(file.path(), std::ios::ate | std::ios::binary);
+        size_t size = stream.is_open() ? static_cast<size_t>(stream.tellg()) : 0;
+        if (size % sizeof(UI32) != 0) {
+            print("Skipping shader %s: size is not a multiple of 4 bytes\n", name.c_str());
+            continue;
+        }
+
+        std::vector<UI32> code(size / sizeof(UI32));
+        stream.seekg(0);
+        stream.read(reinterpret_cast<char*>(code.data()), size);
+
+        if (const char* problem = validate(code)) {
+            print("Skipping shader %s: %s\n", name.c_str(), problem);
+            continue;
+        }
+
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = size;
+        createInfo.pCode = code.data();
+
+        VkShaderModule module;
+        if (vkCreateShaderModule(_context->device, &createInfo, nullptr, &module) != VK_SUCCESS) {
+            throw std::runtime_error("Could not create shader module " + name + "!");
+        }
+        _modules.emplace(name, module);
+    }
+
+    if (std::getenv(PRINT_STATS_VARIABLE)) {
+        print("Loaded %zu shader modules from %s in %.2f ms\n", _modules.size(), _directory.c_str(),
+            std::chrono::duration<F64, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+void ShaderLibrary::cleanup() {
+    for (auto& module : _modules) {
+        vkDestroyShaderModule(_context->device, module.second, nullptr);
+    }
+    _modules.clear();
+}
+
+//-Modules-----------------------------------------------------------------------------------------------------------//
+
+VkShaderModule ShaderLibrary::get(const std::string& name) const {
+    auto it = _modules.find(name);
+    if (it == _modules.end()) {
+        throw std::runtime_error("No valid shader " + name + " in " + _directory + "!");
+    }
+    return it->second;
+}
+
+const char* ShaderLibrary::validate(const std::vector<UI32>& code) {
+    // magic, version, generator, id bound and a reserved word
+    if (code.size() < 5) {
+        return "shorter than a SPIR-V header";
+    }
+    if (code[0] != SPIRV_MAGIC) {
+        return code[0] == ((SPIRV_MAGIC >> 24) | ((SPIRV_MAGIC >> 8) & 0xff00) | ((SPIRV_MAGIC << 8) & 0xff0000) |
+            (SPIRV_MAGIC << 24)) ? "SPIR-V of the wrong endianness" : "not a SPIR-V binary";
+    }
+    // version is 0 | major | minor | 0, a newer module than the device consumes fails in the driver instead
+    if (((code[1] >> 16) & 0xff) != 1 || ((code[1] >> 8) & 0xff) > SPIRV_MAX_MINOR_VERSION) {
+        return "SPIR-V version newer than the device consumes";
+    }
+    if (code[3] == 0) {
+        return "invalid id bound";
+    }
+    return nullptr;
+}
@@ -3,11 +3,10 @@
 #include <common/vkinit.h>
 
 #include <hpg/ShadowMap.h>
-#include <hpg/Shader.h>
 
 #include <array>
 
-void ShadowMap::createShadowMap(const Renderer& renderer) {
+void ShadowMap::createShadowMap(Renderer& renderer) {
 	// create the depth image to sample from
 	createAttachment(renderer);
 
@@ -17,45 +16,38 @@ void ShadowMap::createShadowMap(const Renderer& renderer) {
 
 	createShadowMapFrameBuffer();
 
-	createShadowMapPipeline(renderer._descriptorSetLayouts[OFFSCREEN_SHADOWMAP_DESCRIPTOR_LAYOUT]);
+	createShadowMapPipeline(renderer);
 
-	// uniform buffer
-	shadowMapUniformBuffer = Buffer::createBuffer(*vkSetup, sizeof(ShadowMap::UBO), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	// uniforms live in the renderer's arena
+	uniformOffset = renderer._uniformArena.reserve(sizeof(ShadowMap::UBO));
 }
 
 void ShadowMap::cleanupShadowMap(VkDevice device) {
-	shadowMapUniformBuffer.cleanupBufferData(device);
-
 	vkDestroySampler(device, depthSampler, nullptr);
 	vkDestroyFramebuffer(device, shadowMapFrameBuffer, nullptr);
 
-	vkDestroyPipeline(device, shadowMapPipeline, nullptr);
-	vkDestroyPipelineLayout(device, layout, nullptr);
-
 	vkDestroyRenderPass(device, shadowMapRenderPass, nullptr);
 
 	vkDestroyImageView(device, imageView, nullptr);
+	vkDestroyImage(device, image, nullptr);
+	imageAllocation.free();
 }
 
 void ShadowMap::createAttachment(const Renderer& renderer) {
-	/*
 	// create the image 
-	Image::ImageCreateInfo info{};
-	info.extent = { extent, extent };
-	info.format = format;
-	info.tiling = VK_IMAGE_TILING_OPTIMAL;
-	info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-	info.pImage = &image;
+	VkImageCreateInfo imageCreateInfo = vkinit::imageCreateInfo(format, { extent, extent, 1 }, 1, 1,
+		VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 
-	Image::createImage(renderer, info);
+	image = Image::createImage(renderer._context, imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
+		&imageAllocation);
 
 	// create the image view
-	VkImageViewCreateInfo imageViewCreateInfo = vkinit::imageViewCreateInfo(image._vkImage,
+	VkImageViewCreateInfo imageViewCreateInfo = vkinit::imageViewCreateInfo(image,
 		VK_IMAGE_VIEW_TYPE_2D, format, {}, { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 });
 
-	imageView = Image::createImageView(vkSetup, imageViewCreateInfo);
-	*/
+	imageView = Image::createImageView(&renderer._context, imageViewCreateInfo);
 }
 
 void ShadowMap::createShadowMapRenderPass() {
@@ -150,10 +142,23 @@ void ShadowMap::createShadowMapSampler() {
 	}
 }
 
-void ShadowMap::createShadowMapPipeline(VkDescriptorSetLayout descriptorSetLayout) {
-	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vkinit::pipelineLayoutCreateInfo(1, &descriptorSetLayout);
+void ShadowMap::createShadowMapPipeline(Renderer& renderer) {
+	// not drawn by the first frame, compiled in the background and waited on before recording the shadow pass
+	PipelineState state{ OFFSCREEN_SHADOWMAP_DESCRIPTOR_LAYOUT, VERTEX_FORMAT_FULL, shadowMapRenderPass, 0 };
+	pipeline = renderer._pipelines.request("shadowmap", state,
+		[&renderer](const PipelineState& state, VkPipelineCache cache) {
+			return buildPipeline(renderer, state, cache);
+		}, true);
+}
+
+PipelineRegistry::Pipeline ShadowMap::buildPipeline(const Renderer& renderer, const PipelineState& state,
+	VkPipelineCache cache) {
+	PipelineRegistry::Pipeline pipeline;
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = vkinit::pipelineLayoutCreateInfo(1,
+		&renderer._descriptorSetLayouts[state.type]);
 
-	if (vkCreatePipelineLayout(vkSetup->device, &pipelineLayoutCreateInfo, nullptr, &layout) != VK_SUCCESS) {
+	if (vkCreatePipelineLayout(renderer._context.device, &pipelineLayoutCreateInfo, nullptr, &pipeline.layout) != VK_SUCCESS) {
 		throw std::runtime_error("Could not create shadow map pipeline layout!");
 	}
 
@@ -193,12 +198,11 @@ void ShadowMap::createShadowMapPipeline(VkDescriptorSetLayout descriptorSetLayou
 	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = vkinit::pipelineDynamicStateCreateInfo(
 		dynamicStateEnables.data(), static_cast<UI32>(dynamicStateEnables.size()), 0);
 
-	VkShaderModule vertShaderModule; // , fragShaderModule;
 	std::array<VkPipelineShaderStageCreateInfo, 1> shaderStages;
-	vertShaderModule = Shader::createShaderModule(vkSetup, Shader::readFile("shadowmap.vert.spv"));
+	VkShaderModule vertShaderModule = renderer._shaders.get(kShaders[OFFSCREEN_SHADOWMAP_DESCRIPTOR_LAYOUT].first);
 	shaderStages[0] = vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule, "main");
 
-	VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = vkinit::graphicsPipelineCreateInfo(layout, shadowMapRenderPass, 0);
+	VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = vkinit::graphicsPipelineCreateInfo(pipeline.layout, state.renderPass, state.subpass);
 	graphicsPipelineCreateInfo.pInputAssemblyState = &inputAssemblyStateCreateInfo;
 	graphicsPipelineCreateInfo.pRasterizationState = &rasterizationStateCreateInfo;
 	graphicsPipelineCreateInfo.pColorBlendState    = &colorBlendStateCreateInfo;
@@ -209,19 +213,14 @@ void ShadowMap::createShadowMapPipeline(VkDescriptorSetLayout descriptorSetLayou
 	graphicsPipelineCreateInfo.stageCount		   = static_cast<UI32>(shaderStages.size());
 	graphicsPipelineCreateInfo.pStages             = shaderStages.data();
 	graphicsPipelineCreateInfo.pVertexInputState   = &vertexInputStateCreateInfo; // vertex input bindings / attributes from gltf model
-	graphicsPipelineCreateInfo.renderPass = shadowMapRenderPass;
 
-	if (vkCreateGraphicsPipelines(vkSetup->device, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, &shadowMapPipeline) != VK_SUCCESS) {
+	if (vkCreateGraphicsPipelines(renderer._context.device, cache, 1, &graphicsPipelineCreateInfo, nullptr, &pipeline.pipeline) != VK_SUCCESS) {
 		throw std::runtime_error("Could not create deferred graphics pipeline!");
 	}
 
-	vkDestroyShaderModule(vkSetup->device, vertShaderModule, nullptr);
-	//vkDestroyShaderModule(vkSetup->device, fragShaderModule, nullptr);
+	return pipeline;
 }
 
-void ShadowMap::updateShadowMapUniformBuffer(const ShadowMap::UBO& ubo) {
-	void* data;
-	vkMapMemory(vkSetup->device, shadowMapUniformBuffer._memory, 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(vkSetup->device, shadowMapUniformBuffer._memory);
+void ShadowMap::updateShadowMapUniformBuffer(UniformArena& arena, UI32 currentImage, const ShadowMap::UBO& ubo) {
+	arena.write(currentImage, uniformOffset, ubo);
 }
\ No newline at end of file
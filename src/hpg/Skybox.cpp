@@ -11,7 +11,6 @@
 #include <common/vkinit.h>
 
 #include <hpg/Skybox.h>
-#include <hpg/Shader.h>
 #include <hpg/Buffer.h>
 
 #include <stb_image.h>
@@ -75,12 +74,70 @@ bool Skybox::uploadToGpu(Renderer& renderer) {
 
     _descriptorPool = renderer._descriptorPool;
 
+    // compiled on a worker thread while the cube map is uploaded
+    PipelineState state{ OFFSCREEN_SKYBOX_DESCRIPTOR_LAYOUT, VERTEX_FORMAT_FULL, renderer._renderPass, OFFSCREEN_SUBPASS };
+    _pipeline = renderer._pipelines.request("skybox", state,
+        [&renderer](const PipelineState& state, VkPipelineCache cache) {
+            return buildPipeline(renderer, state, cache);
+        });
+
+    // vertex buffer
+    _vertexBuffer = Buffer::createDeviceLocalBuffer(&renderer._context, renderer._uploadContext,
+        BufferData{ (UC*)Skybox::cubeVerts, 36 * sizeof(glm::vec3) }, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+    // create the desriptors
+    {
+        // cube map
+        _cubeMap.uploadToGpu(renderer, _imageData);
+         
+        // uniforms live in the renderer's arena
+        _uniformOffset = renderer._uniformArena.reserve(sizeof(SkyboxUBO));
+    }
+
+    // create the descriptor sets
+    {
+        VkDescriptorSetAllocateInfo allocInfo = vkinit::descriptorSetAllocInfo(renderer._descriptorPool,
+            1, &renderer._descriptorSetLayouts[OFFSCREEN_SKYBOX_DESCRIPTOR_LAYOUT]);
+
+        // skybox descriptor set
+        if (vkAllocateDescriptorSets(renderer._context.device, &allocInfo, &_descriptorSet) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate descriptor sets!");
+        }
+
+        // skybox uniform
+        VkDescriptorBufferInfo skyboxUboInf = renderer._uniformArena.descriptorInfo(_uniformOffset, sizeof(SkyboxUBO));
+
+        // skybox texture
+        VkDescriptorImageInfo skyboxTexDescriptor{};
+        skyboxTexDescriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        skyboxTexDescriptor.imageView = _cubeMap._imageView;
+        skyboxTexDescriptor.sampler = renderer._colorSampler;
+
+        std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+            // binding 0: vertex shader uniform buffer 
+            vkinit::writeDescriptorSet(_descriptorSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &skyboxUboInf),
+            // binding 1: skybox texture 
+            vkinit::writeDescriptorSet(_descriptorSet, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &skyboxTexDescriptor)
+        };
+
+        vkUpdateDescriptorSets(renderer._context.device, static_cast<UI32>(writeDescriptorSets.size()),
+            writeDescriptorSets.data(), 0, nullptr);
+    }
+    
+    _onGpu = true;
+    return _onGpu;
+}
+
+PipelineRegistry::Pipeline Skybox::buildPipeline(const Renderer& renderer, const PipelineState& state,
+    VkPipelineCache cache) {
+    PipelineRegistry::Pipeline pipeline;
+
     // pipeline layout 
     {
         VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo =
             vkinit::pipelineLayoutCreateInfo(1, &renderer._descriptorSetLayouts[OFFSCREEN_SKYBOX_DESCRIPTOR_LAYOUT]);
 
-        if (vkCreatePipelineLayout(renderer._context.device, &pipelineLayoutCreateInfo, nullptr, &_pipelineLayout)
+        if (vkCreatePipelineLayout(renderer._context.device, &pipelineLayoutCreateInfo, nullptr, &pipeline.layout)
             != VK_SUCCESS) {
             throw std::runtime_error("Could not create skybox pipeline layout!");
         }
@@ -88,11 +145,8 @@ bool Skybox::uploadToGpu(Renderer& renderer) {
 
     // pipeline
     {
-        VkShaderModule vertShaderModule, fragShaderModule;
-        vertShaderModule = Shader::createShaderModule(&renderer._context,
-            Shader::readFile(kShaders[OFFSCREEN_SKYBOX_DESCRIPTOR_LAYOUT].first));
-        fragShaderModule = Shader::createShaderModule(&renderer._context,
-            Shader::readFile(kShaders[OFFSCREEN_SKYBOX_DESCRIPTOR_LAYOUT].second));
+        VkShaderModule vertShaderModule = renderer._shaders.get(kShaders[OFFSCREEN_SKYBOX_DESCRIPTOR_LAYOUT].first);
+        VkShaderModule fragShaderModule = renderer._shaders.get(kShaders[OFFSCREEN_SKYBOX_DESCRIPTOR_LAYOUT].second);
 
         std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{};
         shaderStages[0] = vkinit::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule, "main");
@@ -137,7 +191,7 @@ bool Skybox::uploadToGpu(Renderer& renderer) {
 
         // skybox in offscreen subpass
         VkGraphicsPipelineCreateInfo pipelineCreateInfo =
-            vkinit::graphicsPipelineCreateInfo(_pipelineLayout, renderer._renderPass, OFFSCREEN_SUBPASS);
+            vkinit::graphicsPipelineCreateInfo(pipeline.layout, state.renderPass, state.subpass);
 
         pipelineCreateInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
         pipelineCreateInfo.pStages = shaderStages.data();
@@ -153,71 +207,20 @@ bool Skybox::uploadToGpu(Renderer& renderer) {
         colorBlendingStateInfo.pAttachments = colorBlendAttachmentStates.data();
 
         // skybox pipeline
-        if (vkCreateGraphicsPipelines(renderer._context.device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr,
-            &_pipeline) != VK_SUCCESS) {
+        if (vkCreateGraphicsPipelines(renderer._context.device, cache, 1, &pipelineCreateInfo,
+            nullptr, &pipeline.pipeline) != VK_SUCCESS) {
             throw std::runtime_error("Could not create skybox graphics pipeline!");
         }
-
-        vkDestroyShaderModule(renderer._context.device, vertShaderModule, nullptr);
-        vkDestroyShaderModule(renderer._context.device, fragShaderModule, nullptr);
     }
 
-    // vertex buffer
-    _vertexBuffer = Buffer::createDeviceLocalBuffer(&renderer._context, renderer._commandPools[RENDER_CMD_POOL],
-        BufferData{ (UC*)Skybox::cubeVerts, 36 * sizeof(glm::vec3) }, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-
-    // create the desriptors
-    {
-        // cube map
-        _cubeMap.uploadToGpu(renderer, _imageData);
-         
-        // uniform buffer
-        _uniformBuffer = Buffer::createBuffer(renderer._context, sizeof(SkyboxUBO), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    }
-
-    // create the descriptor sets
-    {
-        VkDescriptorSetAllocateInfo allocInfo = vkinit::descriptorSetAllocInfo(renderer._descriptorPool,
-            1, &renderer._descriptorSetLayouts[OFFSCREEN_SKYBOX_DESCRIPTOR_LAYOUT]);
-
-        // skybox descriptor set
-        if (vkAllocateDescriptorSets(renderer._context.device, &allocInfo, &_descriptorSet) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate descriptor sets!");
-        }
-
-        // skybox uniform
-        VkDescriptorBufferInfo skyboxUboInf{};
-        skyboxUboInf.buffer = _uniformBuffer._vkBuffer;
-        skyboxUboInf.offset = 0;
-        skyboxUboInf.range = sizeof(SkyboxUBO);
-
-        // skybox texture
-        VkDescriptorImageInfo skyboxTexDescriptor{};
-        skyboxTexDescriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        skyboxTexDescriptor.imageView = _cubeMap._imageView;
-        skyboxTexDescriptor.sampler = renderer._colorSampler;
-
-        std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
-            // binding 0: vertex shader uniform buffer 
-            vkinit::writeDescriptorSet(_descriptorSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &skyboxUboInf),
-            // binding 1: skybox texture 
-            vkinit::writeDescriptorSet(_descriptorSet, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &skyboxTexDescriptor)
-        };
-
-        vkUpdateDescriptorSets(renderer._context.device, static_cast<UI32>(writeDescriptorSets.size()),
-            writeDescriptorSets.data(), 0, nullptr);
-    }
-    
-    _onGpu = true;
-    return _onGpu;
+    return pipeline;
 }
 
-void Skybox::draw(VkCommandBuffer cmdBuffer) {
-    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline);
+void Skybox::draw(VkCommandBuffer cmdBuffer, UI32 dynamicOffset) {
+    vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline->pipeline);
 
-    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout, 0, 1,
-        &_descriptorSet, 0, nullptr);
+    vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipeline->layout, 0, 1,
+        &_descriptorSet, 1, &dynamicOffset);
 
     VkDeviceSize offset = 0;
     vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &_vertexBuffer._vkBuffer, &offset);
@@ -231,16 +234,13 @@ void Skybox::cleanup(VkDevice device) {
 
     // cleanup uniforms
     _cubeMap.cleanup(device);
-    _uniformBuffer.cleanupBufferData(device);
 
     // free pixels stored on cpu
     if (_imageData.pixels._data) {
         free(_imageData.pixels._data);
     }
 
-    // destroy descriptor set and pipelines
+    // destroy descriptor set, the pipeline belongs to the renderer's registry
     vkFreeDescriptorSets(device, _descriptorPool, 1, &_descriptorSet);
-    vkDestroyPipeline(device, _pipeline, nullptr);
-    vkDestroyPipelineLayout(device, _pipelineLayout, nullptr);
 }
 
@@ -7,11 +7,13 @@
 #include <scene/Model.h>
 
 #include <common/vkinit.h>
+#include <common/Assert.h>
 
 #include <hpg/SwapChain.h>// include the class declaration
-#include <hpg/Shader.h>   // include the shader struct 
 #include <hpg/Image.h>    // image view create
 
+#include <algorithm>
+
 // exceptions
 #include <iostream>
 #include <stdexcept>
@@ -33,6 +35,8 @@ bool SwapChain::create(VulkanContext& context) {
             newImageCount > context._swapChainSupportDetails.capabilities.maxImageCount) {
             newImageCount = context._swapChainSupportDetails.capabilities.maxImageCount;
         }
+        newImageCount = std::max(std::min(newImageCount, MAX_SWAPCHAIN_IMAGES), 
+            context._swapChainSupportDetails.capabilities.minImageCount);
 
         if (newImageCount != _imageCount) {
             hasNewImageCount = true; // means we need to recreate a lot of vulkan structures
@@ -79,6 +83,8 @@ bool SwapChain::create(VulkanContext& context) {
 
         // specify desired num of images, then get pointers
         vkGetSwapchainImagesKHR(context.device, _swapChain, &_imageCount, nullptr);
+        m_assert(_imageCount <= MAX_SWAPCHAIN_IMAGES, "more swap chain images than per image resources!");
+        _images.resize(_imageCount);
         vkGetSwapchainImagesKHR(context.device, _swapChain, &_imageCount, _images.data());
     }
 
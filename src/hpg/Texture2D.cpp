@@ -1,86 +1,50 @@
 #include <hpg/Texture2D.h>
 
 #include <common/vkinit.h>
-#include <common/commands.h>
 
-bool Texture2D::uploadToGpu(const Renderer& renderer, const ImageData& imageData) {
+#include <algorithm>
+
+bool Texture2D::uploadToGpu(Renderer& renderer, const ImageData& imageData) {
+    const VkDeviceSize baseLevel = 0;
+    return uploadToGpu(renderer, imageData, 1, &baseLevel);
+}
+
+bool Texture2D::uploadToGpu(Renderer& renderer, const ImageData& imageData, UI32 mipLevels, 
+    const VkDeviceSize* pMipOffsets) {
     if (_onGpu) {
         return _onGpu;
     }
 
     // create image and allocate image memory on Gpu
     {
-        VkImageCreateInfo imageCreateInfo = vkinit::imageCreateInfo(imageData.format, imageData.extent, 1, 1,
-            VK_IMAGE_TILING_OPTIMAL, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        VkImageCreateInfo imageCreateInfo = vkinit::imageCreateInfo(imageData.format, imageData.extent, mipLevels, 1,
+            VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
         imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
         imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 
-        if (vkCreateImage(renderer._context.device, &imageCreateInfo, nullptr, &_image) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create image!");
-        }
-
-        // get memory requirements for this particular image
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(renderer._context.device, _image, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo = vkinit::memoryAllocateInfo(memRequirements.size,
-            utils::findMemoryType(renderer._context.physicalDevice, memRequirements.memoryTypeBits,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
-
-        // allocate memory on device
-        if (vkAllocateMemory(renderer._context.device, &allocInfo, nullptr, &_memory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate image memory!");
-        }
-        
-        // bind image to memory
-        vkBindImageMemory(renderer._context.device, _image, _memory, 0);
+        _image = Image::createImage(renderer._context, imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            &_allocation);
     }
 
-    Buffer stagingBuffer;
-    
-    // copy pixels on cpu into a staging buffer
+    // copy host data to device, recorded in the current upload batch along with the layout transitions
     {
-        stagingBuffer = Buffer::createBuffer(renderer._context, imageData.pixels._size,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        void* data;
-        vkMapMemory(renderer._context.device, stagingBuffer._memory, 0, imageData.pixels._size, 0, &data);
-        memcpy(data, imageData.pixels._data, imageData.pixels._size);
-        vkUnmapMemory(renderer._context.device, stagingBuffer._memory);
-    }
-
-    // copy host data to device
-    {
-        VkCommandBuffer commandBuffer;
-
-        // transition layout from undefined to transfer destination
-        commandBuffer = cmd::beginSingleTimeCommands(renderer._context.device, 
-            renderer._commandPools[RENDER_CMD_POOL]);
-        cmd::transitionLayoutUndefinedToTransferDest(commandBuffer, _image, 0, 1, 0, 1);
-        cmd::endSingleTimeCommands(renderer._context.device, renderer._context.graphicsQueue, commandBuffer,
-            renderer._commandPools[RENDER_CMD_POOL]);
-
         // need to specify which parts of the buffer we are going to copy to which part of the image
-        std::vector<VkBufferImageCopy> regions = {
-            { 0, 0, 0, { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 }, { 0, 0, 0 }, imageData.extent } };
-
-        Buffer::copyBufferToImage(&renderer._context, renderer._commandPools[RENDER_CMD_POOL], stagingBuffer._vkBuffer, _image, regions);
+        // one region per mip level
+        std::vector<VkBufferImageCopy> regions(mipLevels);
+        for (UI32 level = 0; level < mipLevels; level++) {
+            VkExtent3D extent = { std::max(imageData.extent.width >> level, 1u), 
+                std::max(imageData.extent.height >> level, 1u), 1 };
+            regions[level] = { pMipOffsets[level], 0, 0, { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 }, { 0, 0, 0 }, extent };
+        }
 
-        // transfer layout from transfer dest to shader read
-        commandBuffer = cmd::beginSingleTimeCommands(renderer._context.device,
-            renderer._commandPools[RENDER_CMD_POOL]);
-        cmd::transitionLayoutTransferDestToFragShaderRead(commandBuffer, _image, 0, 1, 0, 1);
-        cmd::endSingleTimeCommands(renderer._context.device, renderer._context.graphicsQueue, commandBuffer,
-            renderer._commandPools[RENDER_CMD_POOL]);
+        renderer._uploadContext.uploadImage(_image, { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 }, 
+            imageData.pixels._data, imageData.pixels._size, regions);
     }
 
-    // cleanup the staging buffer and its memory
-    stagingBuffer.cleanupBufferData(renderer._context.device);
-
     // create image view
     {
         VkImageViewCreateInfo imageViewCreateInfo = vkinit::imageViewCreateInfo(_image,
-            VK_IMAGE_VIEW_TYPE_2D, imageData.format, {}, { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 });
+            VK_IMAGE_VIEW_TYPE_2D, imageData.format, {}, { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 });
         _imageView = Image::createImageView(&renderer._context, imageViewCreateInfo);
 
     }
@@ -121,7 +85,7 @@ bool Texture2D::uploadToGpu(const Renderer& renderer, const ImageData& imageData
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         samplerInfo.mipLodBias = 0.0f;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = 0.0f;
+        samplerInfo.maxLod = static_cast<F32>(mipLevels);
 
         // now create the configured sampler
         if (vkCreateSampler(renderer._context.device, &samplerInfo, nullptr, &_sampler) != VK_SUCCESS) {
@@ -1,9 +1,8 @@
 #include <hpg/TextureCube.h>
 
 #include <common/vkinit.h>
-#include <common/commands.h>
 
-bool TextureCube::uploadToGpu(const Renderer& renderer, const ImageData& imageData) {
+bool TextureCube::uploadToGpu(Renderer& renderer, const ImageData& imageData) {
     if (_onGpu) {
         return _onGpu;
     }
@@ -11,56 +10,17 @@ bool TextureCube::uploadToGpu(const Renderer& renderer, const ImageData& imageDa
     // create image and allocate image memory on Gpu
     {
         VkImageCreateInfo imageCreateInfo = vkinit::imageCreateInfo(imageData.format, imageData.extent, 1, 6,
-            VK_IMAGE_TILING_OPTIMAL, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
             VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT); // cube texture flag
         imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
         imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 
-        if (vkCreateImage(renderer._context.device, &imageCreateInfo, nullptr, &_image) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create image!");
-        }
-
-        // get memory requirements for this particular image
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(renderer._context.device, _image, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo = vkinit::memoryAllocateInfo(memRequirements.size,
-            utils::findMemoryType(renderer._context.physicalDevice, memRequirements.memoryTypeBits,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
-
-        // allocate memory on device
-        if (vkAllocateMemory(renderer._context.device, &allocInfo, nullptr, &_memory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate image memory!");
-        }
-        
-        // bind image to memory
-        vkBindImageMemory(renderer._context.device, _image, _memory, 0);
-    }
-
-    Buffer stagingBuffer;
-    
-    // copy pixels on cpu into a staging buffer
-    {
-        stagingBuffer = Buffer::createBuffer(renderer._context, imageData.pixels._size,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-        void* data;
-        vkMapMemory(renderer._context.device, stagingBuffer._memory, 0, imageData.pixels._size, 0, &data);
-        memcpy(data, imageData.pixels._data, imageData.pixels._size);
-        vkUnmapMemory(renderer._context.device, stagingBuffer._memory);
+        _image = Image::createImage(renderer._context, imageCreateInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            &_allocation);
     }
 
-    // copy host data to device
+    // copy host data to device, recorded in the current upload batch along with the layout transitions
     {
-        VkCommandBuffer commandBuffer;
-
-        // transition layout from undefined to transfer destination
-        commandBuffer = cmd::beginSingleTimeCommands(renderer._context.device, 
-            renderer._commandPools[RENDER_CMD_POOL]);
-        cmd::transitionLayoutUndefinedToTransferDest(commandBuffer, _image, 0, 1, 0, 6);
-        cmd::endSingleTimeCommands(renderer._context.device, renderer._context.graphicsQueue, commandBuffer,
-            renderer._commandPools[RENDER_CMD_POOL]);
-
         // need to specify which parts of the buffer we are going to copy to which part of the image
         std::vector<VkBufferImageCopy> regions;
         
@@ -79,19 +39,10 @@ bool TextureCube::uploadToGpu(const Renderer& renderer, const ImageData& imageDa
             offset += imageData.extent.width * imageData.extent.height * 4; // TODO remove hardcoded channel depth
         }
 
-        Buffer::copyBufferToImage(&renderer._context, renderer._commandPools[RENDER_CMD_POOL], stagingBuffer._vkBuffer, _image, regions);
-
-        // transfer layout from transfer dest to shader read
-        commandBuffer = cmd::beginSingleTimeCommands(renderer._context.device,
-            renderer._commandPools[RENDER_CMD_POOL]);
-        cmd::transitionLayoutTransferDestToFragShaderRead(commandBuffer, _image, 0, 1, 0, 6);
-        cmd::endSingleTimeCommands(renderer._context.device, renderer._context.graphicsQueue, commandBuffer,
-            renderer._commandPools[RENDER_CMD_POOL]);
+        renderer._uploadContext.uploadImage(_image, { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 6 },
+            imageData.pixels._data, imageData.pixels._size, regions);
     }
 
-    // cleanup the staging buffer and its memory
-    stagingBuffer.cleanupBufferData(renderer._context.device);
-
     // create image view
     {
         VkImageViewCreateInfo imageViewCreateInfo = vkinit::imageViewCreateInfo(_image,
@@ -0,0 +1,46 @@
+//
+// UniformArena class definition
+//
+
+#include <hpg/UniformArena.h>
+
+#include <common/Assert.h>
+
+#include <stdexcept>
+
+void UniformArena::init(const VulkanContext* context, VkDeviceSize sliceSize, UI32 sliceCount) {
+    _alignment = context->deviceProperties.limits.minUniformBufferOffsetAlignment;
+
+    // dynamic offsets are multiples of the slice size, so it must respect the alignment too
+    _sliceSize = (sliceSize + _alignment - 1) / _alignment * _alignment;
+    _sliceCount = sliceCount;
+    _used = 0;
+
+    _buffer = Buffer::createBuffer(*context, _sliceSize * _sliceCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+void UniformArena::cleanup(VkDevice device) {
+    _buffer.cleanupBufferData(device);
+}
+
+VkDeviceSize UniformArena::reserve(VkDeviceSize size) {
+    VkDeviceSize offset = (_used + _alignment - 1) / _alignment * _alignment;
+
+    if (offset + size > _sliceSize) {
+        throw std::runtime_error("uniform arena slice is full!");
+    }
+
+    _used = offset + size;
+    return offset;
+}
+
+VkDescriptorBufferInfo UniformArena::descriptorInfo(VkDeviceSize offset, VkDeviceSize range) const {
+    m_assert(offset + range <= _used, "Descriptor range outside of the reserved uniforms");
+
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = _buffer._vkBuffer;
+    bufferInfo.offset = offset;
+    bufferInfo.range = range;
+    return bufferInfo;
+}
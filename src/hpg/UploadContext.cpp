@@ -0,0 +1,445 @@
+//
+// UploadContext class definition
+//
+
+#include <hpg/UploadContext.h>
+
+#include <common/vkinit.h>
+#include <common/commands.h>
+#include <common/Assert.h>
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+//-Initialisation and cleanup----------------------------------------------------------------------------------------//
+
+void UploadContext::init(const VulkanContext* context) {
+    _context = context;
+
+    _graphicsFamily = _context->queueFamilyIndices.graphicsFamily.value();
+    _transferFamily = _context->queueFamilyIndices.transferFamily.value_or(_graphicsFamily);
+
+    // command buffers are short lived and individually reset when their batch is recycled
+    VkCommandPoolCreateFlags flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+        VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+    VkCommandPoolCreateInfo poolInfo = vkinit::commandPoolCreateInfo(_graphicsFamily, flags);
+    if (vkCreateCommandPool(_context->device, &poolInfo, nullptr, &_graphicsCommandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload command pool!");
+    }
+
+    if (hasDedicatedTransferQueue()) {
+        poolInfo = vkinit::commandPoolCreateInfo(_transferFamily, flags);
+        if (vkCreateCommandPool(_context->device, &poolInfo, nullptr, &_transferCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create transfer command pool!");
+        }
+    }
+
+    // the staging ring stays mapped for the lifetime of the context
+    _ringSize = STAGING_RING_SIZE;
+    _ring = Buffer::createBuffer(*_context, _ringSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    _head = 0;
+    _tail = 0;
+
+    // offsets of buffer to image copies should respect the device's preferred alignment
+    _copyAlignment = std::max<VkDeviceSize>(4, _context->deviceProperties.limits.optimalBufferCopyOffsetAlignment);
+}
+
+void UploadContext::cleanup() {
+    // anything recorded but never flushed is submitted so that staging memory is released through the normal path
+    flush();
+    waitIdle();
+
+    for (auto& batch : _free) {
+        destroyBatch(batch);
+    }
+    _free.clear();
+
+    _ring.cleanupBufferData(_context->device);
+
+    vkDestroyCommandPool(_context->device, _graphicsCommandPool, nullptr);
+    if (_transferCommandPool != VK_NULL_HANDLE) {
+        vkDestroyCommandPool(_context->device, _transferCommandPool, nullptr);
+    }
+}
+
+//-Recording uploads-------------------------------------------------------------------------------------------------//
+
+void UploadContext::uploadBuffer(VkBuffer dst, VkBufferUsageFlags usage, const void* data, VkDeviceSize size,
+    VkDeviceSize dstOffset) {
+    const UC* src = static_cast<const UC*>(data);
+
+    // large buffers are streamed through the ring in chunks, each one is copied as soon as there is room
+    for (VkDeviceSize offset = 0; offset < size; offset += maxChunkSize()) {
+        VkDeviceSize chunkSize = std::min(size - offset, maxChunkSize());
+
+        VkDeviceSize ringOffset = reserve(chunkSize, 4);
+        memcpy(_ring.mapped() + ringOffset, src + offset, chunkSize);
+
+        recordBufferCopy(ringOffset, dst, dstOffset + offset, chunkSize, usage);
+    }
+}
+
+void UploadContext::uploadImage(VkImage dst, const VkImageSubresourceRange& range, const void* data,
+    VkDeviceSize size, const std::vector<VkBufferImageCopy>& regions) {
+    const UC* src = static_cast<const UC*>(data);
+
+    // texel size is deduced from the tightly packed data, used to keep copy offsets texel aligned
+    VkDeviceSize texelCount = 0;
+    for (const auto& region : regions) {
+        texelCount += static_cast<VkDeviceSize>(region.imageExtent.width) * region.imageExtent.height *
+            region.imageExtent.depth * region.imageSubresource.layerCount;
+    }
+    m_assert(texelCount > 0 && size % texelCount == 0, "Image upload data is not tightly packed");
+    VkDeviceSize texelSize = size / texelCount;
+    VkDeviceSize alignment = std::lcm(std::lcm(texelSize, _copyAlignment), static_cast<VkDeviceSize>(4));
+
+    // transition the whole range to transfer destination before any copy
+    {
+        Batch& batch = currentBatch();
+        cmd::transitionLayoutUndefinedToTransferDest(hasDedicatedTransferQueue() ? batch.transferCommandBuffer :
+            batch.graphicsCommandBuffer, dst, range.baseMipLevel, range.levelCount, range.baseArrayLayer, 
+            range.layerCount);
+    }
+
+    if (size <= maxChunkSize()) {
+        // the whole image fits, copy all the regions at once
+        VkDeviceSize ringOffset = reserve(size, alignment);
+        memcpy(_ring.mapped() + ringOffset, src, size);
+
+        std::vector<VkBufferImageCopy> ringRegions = regions;
+        for (auto& region : ringRegions) {
+            region.bufferOffset += ringOffset;
+        }
+
+        Batch& batch = currentBatch();
+        vkCmdCopyBufferToImage(hasDedicatedTransferQueue() ? batch.transferCommandBuffer : 
+            batch.graphicsCommandBuffer, _ring._vkBuffer, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
+            static_cast<UI32>(ringRegions.size()), ringRegions.data());
+        batch.operationCount++;
+    }
+    else {
+        // stream the image through the ring a few rows of one layer at a time
+        for (const auto& region : regions) {
+            m_assert(region.imageExtent.depth == 1, "Chunked uploads only support 2D images");
+
+            VkDeviceSize rowSize = region.imageExtent.width * texelSize;
+            VkDeviceSize layerSize = rowSize * region.imageExtent.height;
+            UI32 rowsPerChunk = static_cast<UI32>(std::max<VkDeviceSize>(1, maxChunkSize() / rowSize));
+
+            for (UI32 layer = 0; layer < region.imageSubresource.layerCount; layer++) {
+                for (UI32 row = 0; row < region.imageExtent.height; row += rowsPerChunk) {
+                    UI32 rowCount = std::min(rowsPerChunk, region.imageExtent.height - row);
+                    VkDeviceSize chunkSize = rowCount * rowSize;
+
+                    VkDeviceSize ringOffset = reserve(chunkSize, alignment);
+                    memcpy(_ring.mapped() + ringOffset, src + region.bufferOffset + layer * layerSize + 
+                        row * rowSize, chunkSize);
+
+                    VkBufferImageCopy chunk = region;
+                    chunk.bufferOffset = ringOffset;
+                    chunk.bufferRowLength = 0;
+                    chunk.bufferImageHeight = 0;
+                    chunk.imageSubresource.baseArrayLayer = region.imageSubresource.baseArrayLayer + layer;
+                    chunk.imageSubresource.layerCount = 1;
+                    chunk.imageOffset.y = region.imageOffset.y + static_cast<I32>(row);
+                    chunk.imageExtent.height = rowCount;
+
+                    Batch& batch = currentBatch();
+                    vkCmdCopyBufferToImage(hasDedicatedTransferQueue() ? batch.transferCommandBuffer :
+                        batch.graphicsCommandBuffer, _ring._vkBuffer, dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 
+                        1, &chunk);
+                    batch.operationCount++;
+                }
+            }
+        }
+    }
+
+    // make the image readable by fragment shaders, recorded in whichever batch holds the last copy
+    Batch& batch = currentBatch();
+    if (hasDedicatedTransferQueue()) {
+        // the layout transition to shader read is part of the queue family ownership transfer, the release
+        // and acquire barriers must describe the same transition
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcQueueFamilyIndex = _transferFamily;
+        barrier.dstQueueFamilyIndex = _graphicsFamily;
+        barrier.image = dst;
+        barrier.subresourceRange = range;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(batch.transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(batch.graphicsCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+    else {
+        cmd::transitionLayoutTransferDestToFragShaderRead(batch.graphicsCommandBuffer, dst, range.baseMipLevel,
+            range.levelCount, range.baseArrayLayer, range.layerCount);
+    }
+}
+
+void UploadContext::recordBufferCopy(VkDeviceSize srcOffset, VkBuffer dst, VkDeviceSize dstOffset, 
+    VkDeviceSize size, VkBufferUsageFlags usage) {
+    Batch& batch = currentBatch();
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = srcOffset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+
+    VkAccessFlags dstAccess;
+    VkPipelineStageFlags dstStages;
+    bufferUsageToAccess(usage, &dstAccess, &dstStages);
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.buffer = dst;
+    barrier.offset = dstOffset;
+    barrier.size = size;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+    if (hasDedicatedTransferQueue()) {
+        vkCmdCopyBuffer(batch.transferCommandBuffer, _ring._vkBuffer, dst, 1, &copyRegion);
+
+        // release ownership of the buffer to the graphics queue family
+        barrier.dstAccessMask = 0;
+        barrier.srcQueueFamilyIndex = _transferFamily;
+        barrier.dstQueueFamilyIndex = _graphicsFamily;
+        vkCmdPipelineBarrier(batch.transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+        // and acquire it on the graphics queue with the same barrier
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(batch.graphicsCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0,
+            0, nullptr, 1, &barrier, 0, nullptr);
+    }
+    else {
+        vkCmdCopyBuffer(batch.graphicsCommandBuffer, _ring._vkBuffer, dst, 1, &copyRegion);
+
+        barrier.dstAccessMask = dstAccess;
+        vkCmdPipelineBarrier(batch.graphicsCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0,
+            0, nullptr, 1, &barrier, 0, nullptr);
+    }
+
+    batch.operationCount++;
+}
+
+//-Submission--------------------------------------------------------------------------------------------------------//
+
+void UploadContext::flush() {
+    if (!_recording) {
+        return;
+    }
+
+    Batch& batch = _current;
+    batch.ringEnd = _head;
+
+    vkEndCommandBuffer(batch.graphicsCommandBuffer);
+
+    if (hasDedicatedTransferQueue()) {
+        vkEndCommandBuffer(batch.transferCommandBuffer);
+
+        VkSubmitInfo submitInfo = vkinit::submitInfo(nullptr, 0, nullptr, 1, &batch.transferComplete, 1,
+            &batch.transferCommandBuffer);
+        if (vkQueueSubmit(_context->transferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit transfer command buffer!");
+        }
+
+        // the acquire barriers wait on the copies
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        submitInfo = vkinit::submitInfo(&waitStage, 1, &batch.transferComplete, 0, nullptr, 1,
+            &batch.graphicsCommandBuffer);
+        if (vkQueueSubmit(_context->graphicsQueue, 1, &submitInfo, batch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+    }
+    else {
+        VkSubmitInfo submitInfo = vkinit::submitInfo(nullptr, 0, nullptr, 0, nullptr, 1,
+            &batch.graphicsCommandBuffer);
+        if (vkQueueSubmit(_context->graphicsQueue, 1, &submitInfo, batch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+    }
+
+    _inFlight.push_back(std::move(_current));
+    _current = Batch{};
+    _recording = false;
+
+    // opportunistically release older batches
+    collect();
+}
+
+void UploadContext::collect() {
+    // batches complete in submission order, stop at the first one still pending so the ring tail only moves forward
+    while (!_inFlight.empty() && vkGetFenceStatus(_context->device, _inFlight.front().fence) == VK_SUCCESS) {
+        Batch& batch = _inFlight.front();
+
+        _tail = batch.ringEnd;
+        batch.operationCount = 0;
+
+        _free.push_back(std::move(batch));
+        _inFlight.erase(_inFlight.begin());
+    }
+}
+
+void UploadContext::waitIdle() {
+    for (auto& batch : _inFlight) {
+        vkWaitForFences(_context->device, 1, &batch.fence, VK_TRUE, UINT64_MAX);
+    }
+    collect();
+}
+
+//-Batches-----------------------------------------------------------------------------------------------------------//
+
+UploadContext::Batch& UploadContext::currentBatch() {
+    if (_recording) {
+        return _current;
+    }
+
+    // recycle a completed batch if there is one
+    if (!_free.empty()) {
+        _current = std::move(_free.back());
+        _free.pop_back();
+
+        vkResetFences(_context->device, 1, &_current.fence);
+        vkResetCommandBuffer(_current.graphicsCommandBuffer, 0);
+        if (_current.transferCommandBuffer != VK_NULL_HANDLE) {
+            vkResetCommandBuffer(_current.transferCommandBuffer, 0);
+        }
+    }
+    else {
+        _current = createBatch();
+    }
+
+    VkCommandBufferBeginInfo beginInfo = vkinit::commandBufferBeginInfo(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    vkBeginCommandBuffer(_current.graphicsCommandBuffer, &beginInfo);
+    if (_current.transferCommandBuffer != VK_NULL_HANDLE) {
+        vkBeginCommandBuffer(_current.transferCommandBuffer, &beginInfo);
+    }
+
+    _recording = true;
+    return _current;
+}
+
+UploadContext::Batch UploadContext::createBatch() {
+    Batch batch{};
+
+    VkCommandBufferAllocateInfo allocInfo = vkinit::commandBufferAllocateInfo(_graphicsCommandPool,
+        VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+    if (vkAllocateCommandBuffers(_context->device, &allocInfo, &batch.graphicsCommandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+
+    if (hasDedicatedTransferQueue()) {
+        allocInfo = vkinit::commandBufferAllocateInfo(_transferCommandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+        if (vkAllocateCommandBuffers(_context->device, &allocInfo, &batch.transferCommandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate transfer command buffer!");
+        }
+
+        VkSemaphoreCreateInfo semaphoreInfo = vkinit::semaphoreCreateInfo();
+        if (vkCreateSemaphore(_context->device, &semaphoreInfo, nullptr, &batch.transferComplete) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload semaphore!");
+        }
+    }
+
+    VkFenceCreateInfo fenceInfo = vkinit::fenceCreateInfo();
+    if (vkCreateFence(_context->device, &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload fence!");
+    }
+
+    return batch;
+}
+
+void UploadContext::destroyBatch(Batch& batch) {
+    vkFreeCommandBuffers(_context->device, _graphicsCommandPool, 1, &batch.graphicsCommandBuffer);
+    if (batch.transferCommandBuffer != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(_context->device, _transferCommandPool, 1, &batch.transferCommandBuffer);
+        vkDestroySemaphore(_context->device, batch.transferComplete, nullptr);
+    }
+    vkDestroyFence(_context->device, batch.fence, nullptr);
+}
+
+//-Helpers-----------------------------------------------------------------------------------------------------------//
+
+VkDeviceSize UploadContext::reserve(VkDeviceSize size, VkDeviceSize alignment) {
+    m_assert(size <= _ringSize, "Staging ring reservation larger than the ring");
+
+    VkDeviceSize offset;
+    while (!tryReserve(size, alignment, &offset)) {
+        // the ring is full, submit what has been recorded so far and wait for the oldest batch to free its region
+        flush();
+        if (_inFlight.empty()) {
+            throw std::runtime_error("staging ring reservation cannot be satisfied!");
+        }
+        vkWaitForFences(_context->device, 1, &_inFlight.front().fence, VK_TRUE, UINT64_MAX);
+        collect();
+    }
+
+    return offset;
+}
+
+bool UploadContext::tryReserve(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* pOffset) {
+    VkDeviceSize physical = _head % _ringSize;
+    VkDeviceSize aligned = (physical + alignment - 1) / alignment * alignment;
+    VkDeviceSize padding = aligned - physical;
+
+    // allocations never straddle the end of the ring, skip to the start instead
+    if (aligned + size > _ringSize) {
+        padding = _ringSize - physical;
+        aligned = 0;
+    }
+
+    if (_head + padding + size - _tail > _ringSize) {
+        return false;
+    }
+
+    _head += padding + size;
+    *pOffset = aligned;
+    return true;
+}
+
+void UploadContext::bufferUsageToAccess(VkBufferUsageFlags usage, VkAccessFlags* pAccess,
+    VkPipelineStageFlags* pStages) {
+    *pAccess = 0;
+    *pStages = 0;
+
+    if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) {
+        *pAccess |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+        *pStages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+    }
+    if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) {
+        *pAccess |= VK_ACCESS_INDEX_READ_BIT;
+        *pStages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+    }
+    if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) {
+        *pAccess |= VK_ACCESS_UNIFORM_READ_BIT;
+        *pStages |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    }
+    if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) {
+        *pAccess |= VK_ACCESS_SHADER_READ_BIT;
+        *pStages |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    }
+    if (usage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT) {
+        *pAccess |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        *pStages |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+    }
+
+    // unknown consumer, make the copy visible to everything
+    if (*pStages == 0) {
+        *pAccess = VK_ACCESS_MEMORY_READ_BIT;
+        *pStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    }
+}
@@ -19,6 +19,8 @@
 #include <iostream> 
 #include <stdexcept>
 
+#include <algorithm>
+#include <cstring>
 #include <set>
 #include <string>
 
@@ -45,9 +47,17 @@ void VulkanContext::init(GLFWwindow* theWindow) {
 
     // create the logical device for interfacing with the physical device
     createLogicalDevice();
+
+    // device memory is sub-allocated from large blocks rather than one vkAllocateMemory per resource
+    allocator.init(physicalDevice, device);
 }
 
 void VulkanContext::cleanup() {
+    // release the memory blocks while the device is still alive
+#ifndef NDEBUG
+    allocator.printStatistics();
+#endif // !NDEBUG
+    allocator.cleanup();
     // remove the logical device, no direct interaction with instance so not passed as argument
     vkDestroyDevice(device, nullptr);
     // destroy the window surface
@@ -131,6 +141,18 @@ std::vector<const char*> VulkanContext::getRequiredExtensions() {
         extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
     }
 
+    // needed to query descriptor indexing support, optional
+    uint32_t availableCount = 0;
+    vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, nullptr);
+    std::vector<VkExtensionProperties> available(availableCount);
+    vkEnumerateInstanceExtensionProperties(nullptr, &availableCount, available.data());
+    for (const auto& extension : available) {
+        if (std::strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0) {
+            extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+            _physicalDeviceProperties2 = true;
+        }
+    }
+
     // return the vector
     return extensions;
 }
@@ -297,6 +319,9 @@ void VulkanContext::pickPhysicalDevice() {
 
     // list the properties of the selected device
     vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    queryDescriptorIndexing();
+    queryIndirectDraws();
 }
 
 bool VulkanContext::isDeviceSuitable(VkPhysicalDevice device) {
@@ -330,7 +355,7 @@ bool VulkanContext::isDeviceSuitable(VkPhysicalDevice device) {
     return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
 }
 
-bool VulkanContext::checkDeviceExtensionSupport(VkPhysicalDevice device) {
+bool VulkanContext::checkDeviceExtensionSupport(VkPhysicalDevice device, const std::vector<const char*>& extensions) {
     // intit the extension count
     uint32_t extensionCount;
     // set the extension count using the right vulkan enumerate function 
@@ -342,7 +367,7 @@ bool VulkanContext::checkDeviceExtensionSupport(VkPhysicalDevice device) {
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
     // wrap the const vector of extensions deviceExtensions defined at top of header file into a set, to get unique extensions names
-    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
     // loop through available extensions, erasing any occurence of the required extension(s)
     for (const auto& extension : availableExtensions) {
@@ -353,6 +378,54 @@ bool VulkanContext::checkDeviceExtensionSupport(VkPhysicalDevice device) {
     return requiredExtensions.empty();
 }
 
+void VulkanContext::queryDescriptorIndexing() {
+    descriptorIndexing = false;
+    maxBindlessTextures = 0;
+
+    if (!_physicalDeviceProperties2 || !checkDeviceExtensionSupport(physicalDevice, descriptorIndexingExtensions)) {
+        return;
+    }
+
+    auto getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(
+        vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+    if (!getFeatures2) {
+        return;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    VkPhysicalDeviceFeatures2KHR features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+    features.pNext = &indexingFeatures;
+    getFeatures2(physicalDevice, &features);
+
+    // materials index the array with a push constant, which is dynamically uniform
+    const VkPhysicalDeviceLimits& limits = deviceProperties.limits;
+    maxBindlessTextures = std::min({ MAX_BINDLESS_TEXTURES, limits.maxPerStageDescriptorSamplers,
+        limits.maxPerStageDescriptorSampledImages, limits.maxDescriptorSetSamplers, limits.maxDescriptorSetSampledImages });
+
+    descriptorIndexing = features.features.shaderSampledImageArrayDynamicIndexing &&
+        indexingFeatures.runtimeDescriptorArray && indexingFeatures.descriptorBindingPartiallyBound &&
+        indexingFeatures.descriptorBindingVariableDescriptorCount && maxBindlessTextures > 0;
+}
+
+void VulkanContext::queryIndirectDraws() {
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+
+    // culling runs in a compute shader recorded next to the draws
+    UI32 graphicsFamily = utils::QueueFamilyIndices::findQueueFamilies(physicalDevice, surface).graphicsFamily.value();
+    UI32 familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+    // the first instance of a draw carries its material
+    indirectDraws = features.multiDrawIndirect && features.drawIndirectFirstInstance &&
+        (families[graphicsFamily].queueFlags & VK_QUEUE_COMPUTE_BIT);
+    drawIndirectCount = indirectDraws && checkDeviceExtensionSupport(physicalDevice, drawIndirectCountExtensions);
+}
+
 void VulkanContext::createLogicalDevice() {
     // query the queue families available on the device
     utils::QueueFamilyIndices indices = utils::QueueFamilyIndices::findQueueFamilies(physicalDevice, surface);
@@ -361,6 +434,9 @@ void VulkanContext::createLogicalDevice() {
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     // using a set makes sure that there are no dulpicate references to a same queue!
     std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+    if (indices.transferFamily.has_value()) {
+        uniqueQueueFamilies.insert(indices.transferFamily.value());
+    }
 
     // queue priority, for now give queues the same priority
     float queuePriority = 1.0f;
@@ -380,6 +456,27 @@ void VulkanContext::createLogicalDevice() {
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE; // we want the device to use anisotropic filtering if available
 
+    // bindless materials, only what the material descriptor set needs
+    std::vector<const char*> extensions = deviceExtensions;
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    if (descriptorIndexing) {
+        extensions.insert(extensions.end(), descriptorIndexingExtensions.begin(), descriptorIndexingExtensions.end());
+        deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+        indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+        indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+        indexingFeatures.descriptorBindingVariableDescriptorCount = VK_TRUE;
+    }
+
+    // gpu driven draws
+    if (indirectDraws) {
+        deviceFeatures.multiDrawIndirect = VK_TRUE;
+        deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+    }
+    if (drawIndirectCount) {
+        extensions.insert(extensions.end(), drawIndirectCountExtensions.begin(), drawIndirectCountExtensions.end());
+    }
+
     // the struct containing the device info
     VkDeviceCreateInfo createInfo{};
     createInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO; // inform on type of struct
@@ -387,9 +484,10 @@ void VulkanContext::createLogicalDevice() {
     createInfo.pQueueCreateInfos       = queueCreateInfos.data(); // pointer to queue(s) info, here the raw underlying array in a vector (guaranteed contiguous!)
 
     createInfo.pEnabledFeatures        = &deviceFeatures; // desired device features
+    createInfo.pNext                   = descriptorIndexing ? &indexingFeatures : nullptr;
     // setting validation layers and extensions is per device
-    createInfo.enabledExtensionCount   = static_cast<uint32_t>(deviceExtensions.size()); // the number of desired extensions
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data(); // pointer to the vector containing the desired extensions 
+    createInfo.enabledExtensionCount   = static_cast<uint32_t>(extensions.size()); // the number of desired extensions
+    createInfo.ppEnabledExtensionNames = extensions.data(); // pointer to the vector containing the desired extensions 
 
     // older implementation compatibility, no disitinction instance and device specific validations
     if (enableValidationLayers) {
@@ -410,6 +508,16 @@ void VulkanContext::createLogicalDevice() {
     vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
     // set the presentation queue handle like above
     vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+    // uploads go through the dedicated transfer queue if there is one, otherwise they share the graphics queue
+    vkGetDeviceQueue(device, indices.transferFamily.value_or(indices.graphicsFamily.value()), 0, &transferQueue);
+
+    if (drawIndirectCount) {
+        cmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+            vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR"));
+        drawIndirectCount = cmdDrawIndexedIndirectCount != nullptr;
+    }
+
+    queueFamilyIndices = indices;
 }
 
 void VulkanContext::querySwapChainSupport() {
@@ -0,0 +1,273 @@
+//
+// Bvh class definition
+//
+
+#include <scene/Bvh.h>
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef BVH_SSE
+#include <emmintrin.h>
+#endif
+
+// centroid bins of the surface area heuristic, per axis
+const UI32 BVH_BINS = 12;
+
+// nodes with more items than this are split even when the heuristic prefers a leaf
+const UI32 BVH_MAX_HEURISTIC_LEAF_ITEMS = 4 * Bvh::MAX_LEAF_ITEMS;
+
+//-Frustum-----------------------------------------------------------------------------------------------------------//
+
+Frustum Frustum::fromMatrix(const glm::mat4& matrix) {
+    // rows of the matrix, glm matrices are column major
+    glm::vec4 rows[4];
+    for (UI32 r = 0; r < 4; r++) {
+        rows[r] = glm::vec4(matrix[0][r], matrix[1][r], matrix[2][r], matrix[3][r]);
+    }
+
+    // left, right, bottom, top, near, far. The tests only compare signs, the planes are not normalised
+    const glm::vec4 planes[8] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1],
+        rows[2], rows[3] - rows[2], glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) };
+
+    Frustum frustum;
+    for (UI32 p = 0; p < 8; p++) {
+        frustum.x[p] = planes[p].x;
+        frustum.y[p] = planes[p].y;
+        frustum.z[p] = planes[p].z;
+        frustum.w[p] = planes[p].w;
+    }
+    return frustum;
+}
+
+kFrustumTest Frustum::test(const Aabb& box) const {
+    // distance of the centre to each plane against the extent of the box projected on its normal
+    glm::vec3 c = box.centre();
+    glm::vec3 e = box.extent();
+
+#ifdef BVH_SSE
+    const __m128 cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+    const __m128 ex = _mm_set1_ps(e.x), ey = _mm_set1_ps(e.y), ez = _mm_set1_ps(e.z);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    int outside = 0;
+    int inside = 0xF;
+    for (UI32 p = 0; p < 8; p += 4) {
+        __m128 px = _mm_load_ps(x + p), py = _mm_load_ps(y + p), pz = _mm_load_ps(z + p);
+        __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, cx), _mm_mul_ps(py, cy)),
+            _mm_add_ps(_mm_mul_ps(pz, cz), _mm_load_ps(w + p)));
+        __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(sign, px), ex), _mm_mul_ps(_mm_andnot_ps(sign, py), ey)),
+            _mm_mul_ps(_mm_andnot_ps(sign, pz), ez));
+
+        outside |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(d, r), zero));
+        inside &= _mm_movemask_ps(_mm_cmpge_ps(_mm_sub_ps(d, r), zero));
+    }
+#else
+    int outside = 0;
+    int inside = 0xF;
+    for (UI32 p = 0; p < 6; p++) {
+        F32 d = x[p] * c.x + y[p] * c.y + z[p] * c.z + w[p];
+        F32 r = std::abs(x[p]) * e.x + std::abs(y[p]) * e.y + std::abs(z[p]) * e.z;
+        outside |= d + r < 0.0f;
+        inside = d - r >= 0.0f ? inside : 0;
+    }
+#endif
+
+    if (outside) {
+        return FRUSTUM_OUTSIDE;
+    }
+    return inside == 0xF ? FRUSTUM_INSIDE : FRUSTUM_INTERSECTS;
+}
+
+//-Construction------------------------------------------------------------------------------------------------------//
+
+void Bvh::build(const std::vector<Aabb>& boxes) {
+    _nodes.clear();
+    _items.resize(boxes.size());
+    for (UI32 i = 0; i < _items.size(); i++) {
+        _items[i] = i;
+    }
+    if (boxes.empty()) {
+        _itemBoxes.clear();
+        return;
+    }
+
+    std::vector<glm::vec3> centres(boxes.size());
+    for (size_t i = 0; i < boxes.size(); i++) {
+        centres[i] = boxes[i].centre();
+    }
+
+    // a binary tree with leaves of at least one item has fewer than twice as many nodes as items
+    _nodes.reserve(2 * boxes.size());
+    buildNode(boxes, centres, 0, static_cast<UI32>(boxes.size()));
+
+    // leaves test their items' boxes, kept in item order
+    _itemBoxes.resize(boxes.size());
+    for (size_t i = 0; i < _items.size(); i++) {
+        _itemBoxes[i] = boxes[_items[i]];
+    }
+}
+
+UI32 Bvh::buildNode(const std::vector<Aabb>& boxes, const std::vector<glm::vec3>& centres, UI32 first, UI32 count) {
+    // children are appended after their parent, only indices are held across the recursion
+    UI32 index = static_cast<UI32>(_nodes.size());
+    _nodes.push_back({});
+
+    Aabb bounds = boxes[_items[first]];
+    Aabb centroids{ centres[_items[first]], centres[_items[first]] };
+    for (UI32 i = first + 1; i < first + count; i++) {
+        bounds.grow(boxes[_items[i]]);
+        centroids.grow({ centres[_items[i]], centres[_items[i]] });
+    }
+    _nodes[index] = { bounds, first, count, 0 };
+
+    glm::vec3 size = centroids.max - centroids.min;
+    if (count <= MAX_LEAF_ITEMS || (size.x <= 0.0f && size.y <= 0.0f && size.z <= 0.0f)) {
+        return index;
+    }
+
+    // binned surface area heuristic over each axis, the cost of a split is the area of each side times its items
+    struct Bin {
+        Aabb bounds;
+        UI32 count = 0;
+    };
+
+    F32 bestCost = count * bounds.area();
+    UI32 bestAxis = 0, bestSplit = 0;
+    for (UI32 axis = 0; axis < 3; axis++) {
+        if (size[axis] <= 0.0f) {
+            continue;
+        }
+
+        Bin bins[BVH_BINS];
+        F32 scale = BVH_BINS / size[axis];
+        for (UI32 i = first; i < first + count; i++) {
+            UI32 b = std::min(BVH_BINS - 1, static_cast<UI32>((centres[_items[i]][axis] - centroids.min[axis]) * scale));
+            bins[b].bounds = bins[b].count == 0 ? boxes[_items[i]] : bins[b].bounds;
+            bins[b].bounds.grow(boxes[_items[i]]);
+            bins[b].count++;
+        }
+
+        // areas to the right of each split, swept from the last bin
+        F32 rightCosts[BVH_BINS];
+        Aabb right;
+        UI32 rightCount = 0;
+        for (UI32 b = BVH_BINS - 1; b > 0; b--) {
+            if (bins[b].count > 0) {
+                right = rightCount == 0 ? bins[b].bounds : right;
+                right.grow(bins[b].bounds);
+                rightCount += bins[b].count;
+            }
+            rightCosts[b] = rightCount == 0 ? 0.0f : rightCount * right.area();
+        }
+
+        Aabb left;
+        UI32 leftCount = 0;
+        for (UI32 split = 1; split < BVH_BINS; split++) {
+            const Bin& bin = bins[split - 1];
+            if (bin.count > 0) {
+                left = leftCount == 0 ? bin.bounds : left;
+                left.grow(bin.bounds);
+                leftCount += bin.count;
+            }
+            if (leftCount == 0 || leftCount == count) {
+                continue;
+            }
+
+            F32 cost = leftCount * left.area() + rightCosts[split];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = split;
+            }
+        }
+    }
+
+    UI32 middle = first;
+    if (bestSplit > 0) {
+        F32 scale = BVH_BINS / size[bestAxis];
+        F32 minimum = centroids.min[bestAxis];
+        middle = static_cast<UI32>(std::partition(_items.begin() + first, _items.begin() + first + count,
+            [&](UI32 item) {
+                return std::min(BVH_BINS - 1, static_cast<UI32>((centres[item][bestAxis] - minimum) * scale)) < bestSplit;
+            }) - _items.begin());
+    }
+    else if (count <= BVH_MAX_HEURISTIC_LEAF_ITEMS) {
+        // cheaper as a leaf
+        return index;
+    }
+
+    // nothing worth splitting by area, halve on the widest axis
+    if (middle == first || middle == first + count) {
+        UI32 axis = size.x >= size.y && size.x >= size.z ? 0 : size.y >= size.z ? 1 : 2;
+        middle = first + count / 2;
+        std::nth_element(_items.begin() + first, _items.begin() + middle, _items.begin() + first + count,
+            [&](UI32 a, UI32 b) { return centres[a][axis] < centres[b][axis]; });
+    }
+
+    buildNode(boxes, centres, first, middle - first);
+    UI32 rightChild = buildNode(boxes, centres, middle, first + count - middle);
+    _nodes[index].rightChild = rightChild;
+    return index;
+}
+
+//-Culling-----------------------------------------------------------------------------------------------------------//
+
+void Bvh::cull(const Frustum& frustum, std::vector<UI32>* pVisible, BvhCullStats* pStats) const {
+    if (_nodes.empty()) {
+        return;
+    }
+
+    BvhCullStats stats;
+
+    // depth first, the left child is visited first and follows its parent in memory
+    UI32 stack[64];
+    UI32 top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = _nodes[stack[--top]];
+        stats.nodesVisited++;
+        stats.boxesTested++;
+
+        kFrustumTest result = frustum.test(node.bounds);
+        if (result == FRUSTUM_OUTSIDE) {
+            continue;
+        }
+
+        // everything below is visible
+        if (result == FRUSTUM_INSIDE) {
+            pVisible->insert(pVisible->end(), _items.begin() + node.firstItem,
+                _items.begin() + node.firstItem + node.itemCount);
+            stats.itemsAccepted += node.itemCount;
+            continue;
+        }
+
+        if (node.rightChild == 0) {
+            for (UI32 i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+                stats.boxesTested++;
+                if (frustum.test(_itemBoxes[i]) != FRUSTUM_OUTSIDE) {
+                    pVisible->push_back(_items[i]);
+                    stats.itemsAccepted++;
+                }
+            }
+            continue;
+        }
+
+        // a full stack means an unusually deep tree, its subtree is accepted rather than dropped
+        if (top + 2 > sizeof(stack) / sizeof(*stack)) {
+            pVisible->insert(pVisible->end(), _items.begin() + node.firstItem,
+                _items.begin() + node.firstItem + node.itemCount);
+            stats.itemsAccepted += node.itemCount;
+            continue;
+        }
+        stack[top++] = node.rightChild;
+        stack[top++] = static_cast<UI32>(&node - _nodes.data()) + 1;
+    }
+
+    if (pStats) {
+        pStats->nodesVisited  += stats.nodesVisited;
+        pStats->boxesTested   += stats.boxesTested;
+        pStats->itemsAccepted += stats.itemsAccepted;
+    }
+}
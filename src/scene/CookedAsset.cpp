@@ -0,0 +1,108 @@
+//
+// CookedAsset class definition
+//
+
+#include <common/Print.h>
+
+#include <scene/CookedAsset.h>
+
+#include <fstream>
+
+// sections start on a multiple of this, more than any element alignment or copy offset alignment needs
+const UI64 COOKED_SECTION_ALIGNMENT = 64;
+
+static UI64 alignSection(UI64 offset) {
+    return (offset + COOKED_SECTION_ALIGNMENT - 1) / COOKED_SECTION_ALIGNMENT * COOKED_SECTION_ALIGNMENT;
+}
+
+bool CookedAsset::write(const std::string& path, const Contents& contents) {
+    struct Blob {
+        const void* data;
+        UI64 count;
+        UI64 size;
+    };
+
+    const Blob blobs[COOKED_SECTION_MAX_ENUM] = {
+        { contents.vertices.data(),    contents.vertices.size(),    contents.vertices.size() * sizeof(Vertex) },
+        { contents.indices.data(),     contents.indices.size(),     contents.indices.size() * sizeof(UI32) },
+        { contents.primitives.data(),  contents.primitives.size(),  contents.primitives.size() * sizeof(CookedPrimitive) },
+        { contents.materials.data(),   contents.materials.size(),   contents.materials.size() * sizeof(CookedMaterial) },
+        { contents.textures.data(),    contents.textures.size(),    contents.textures.size() * sizeof(CookedTexture) },
+        { contents.textureData.data(), contents.textureData.size(), contents.textureData.size() }
+    };
+
+    CookedHeader header{ COOKED_ASSET_MAGIC, COOKED_ASSET_VERSION, sizeof(Vertex), COOKED_SECTION_MAX_ENUM };
+
+    // lay out the sections after the header and section table
+    CookedSection sections[COOKED_SECTION_MAX_ENUM]{};
+    UI64 offset = alignSection(sizeof(CookedHeader) + sizeof(sections));
+    for (UI32 i = 0; i < COOKED_SECTION_MAX_ENUM; i++) {
+        sections[i] = { i, static_cast<UI32>(blobs[i].count), offset, blobs[i].size };
+        offset = alignSection(offset + blobs[i].size);
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        print("Could not open %s for writing\n", path.c_str());
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(sections), sizeof(sections));
+
+    const char padding[COOKED_SECTION_ALIGNMENT]{};
+    for (UI32 i = 0; i < COOKED_SECTION_MAX_ENUM; i++) {
+        file.write(padding, sections[i].offset - static_cast<UI64>(file.tellp()));
+        file.write(static_cast<const char*>(blobs[i].data), blobs[i].size);
+    }
+
+    return file.good();
+}
+
+bool CookedAsset::open(const std::string& path) {
+    close();
+
+    if (!_file.open(path)) {
+        print("Could not open cooked asset: %s\n", path.c_str());
+        return false;
+    }
+
+    if (_file.size() < sizeof(CookedHeader) + sizeof(_sections)) {
+        print("Truncated cooked asset: %s\n", path.c_str());
+        close();
+        return false;
+    }
+
+    const CookedHeader* header = reinterpret_cast<const CookedHeader*>(_file.data());
+    if (header->magic != COOKED_ASSET_MAGIC || header->version != COOKED_ASSET_VERSION ||
+        header->vertexSize != sizeof(Vertex) || header->sectionCount != COOKED_SECTION_MAX_ENUM) {
+        print("Cooked asset %s is out of date, cook it again\n", path.c_str());
+        close();
+        return false;
+    }
+
+    const CookedSection* sections = reinterpret_cast<const CookedSection*>(_file.data() + sizeof(CookedHeader));
+    for (UI32 i = 0; i < COOKED_SECTION_MAX_ENUM; i++) {
+        if (sections[i].type != i || sections[i].offset + sections[i].size > _file.size()) {
+            print("Corrupted cooked asset: %s\n", path.c_str());
+            close();
+            return false;
+        }
+        _sections[i] = sections[i];
+    }
+
+    return true;
+}
+
+void CookedAsset::close() {
+    _file.close();
+    for (auto& section : _sections) {
+        section = {};
+    }
+}
+
+bool CookedAsset::hasExtension(const std::string& path) {
+    std::string extension(COOKED_ASSET_EXTENSION);
+    return path.size() >= extension.size() &&
+        path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
@@ -0,0 +1,165 @@
+//
+// GLTFAccessor class definition
+//
+
+#include <common/Assert.h>
+
+#include <scene/GLTFAccessor.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+GLTFAccessor::GLTFAccessor(const tinygltf::Model& model, I32 accessorIndex, const std::vector<const UC*>& buffers) {
+    const tinygltf::Accessor& accessor = model.accessors[accessorIndex];
+
+    _count         = accessor.count;
+    _componentType = accessor.componentType;
+    _components    = static_cast<UI32>(tinygltf::GetNumComponentsInType(accessor.type));
+    _componentSize = static_cast<UI32>(tinygltf::GetComponentSizeInBytes(accessor.componentType));
+    _normalized    = accessor.normalized;
+
+    if (_components == static_cast<UI32>(-1) || _componentSize == static_cast<UI32>(-1)) {
+        throw std::runtime_error("unsupported glTF accessor type!");
+    }
+
+    // sparse values are tightly packed, the base view may use an explicit stride
+    _stride = _components * _componentSize;
+
+    if (accessor.bufferView >= 0) {
+        const tinygltf::BufferView& bufferView = model.bufferViews[accessor.bufferView];
+        _data = buffers[bufferView.buffer] + bufferView.byteOffset + accessor.byteOffset;
+        if (bufferView.byteStride) {
+            _stride = bufferView.byteStride;
+        }
+    }
+
+    if (accessor.sparse.isSparse && accessor.sparse.count > 0) {
+        const tinygltf::BufferView& indicesView = model.bufferViews[accessor.sparse.indices.bufferView];
+        const UC* indices = buffers[indicesView.buffer] + indicesView.byteOffset +
+            accessor.sparse.indices.byteOffset;
+        UI32 indexSize = static_cast<UI32>(tinygltf::GetComponentSizeInBytes(accessor.sparse.indices.componentType));
+
+        _sparseIndices.resize(accessor.sparse.count);
+        for (size_t s = 0; s < _sparseIndices.size(); s++) {
+            switch (accessor.sparse.indices.componentType) {
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+                _sparseIndices[s] = indices[s];
+                break;
+            case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+                _sparseIndices[s] = *reinterpret_cast<const UI16*>(indices + s * indexSize);
+                break;
+            default:
+                _sparseIndices[s] = *reinterpret_cast<const UI32*>(indices + s * indexSize);
+                break;
+            }
+        }
+
+        const tinygltf::BufferView& valuesView = model.bufferViews[accessor.sparse.values.bufferView];
+        _sparseValues = buffers[valuesView.buffer] + valuesView.byteOffset +
+            accessor.sparse.values.byteOffset;
+    }
+}
+
+void GLTFAccessor::decodeFloats(UI64 begin, UI64 end, F32* dst, UI64 dstStride, UI32 firstComponent,
+    UI32 componentCount) const {
+    m_assert(firstComponent + componentCount <= _components, "Decoding components outside of the accessor type");
+
+    UC* out = reinterpret_cast<UC*>(dst);
+
+    // packed floats need no conversion, only a strided copy
+    if (isPackedFloat()) {
+        const UC* in = _data + begin * _stride + firstComponent * sizeof(F32);
+        for (UI64 i = begin; i < end; i++) {
+            memcpy(out, in, componentCount * sizeof(F32));
+            in  += _stride;
+            out += dstStride;
+        }
+        return;
+    }
+
+    size_t nextSparse = 0;
+    if (isSparse()) {
+        nextSparse = std::lower_bound(_sparseIndices.begin(), _sparseIndices.end(), static_cast<UI32>(begin)) -
+            _sparseIndices.begin();
+    }
+
+    for (UI64 i = begin; i < end; i++) {
+        const UC* in = element(i, &nextSparse);
+        F32* values = reinterpret_cast<F32*>(out);
+        for (UI32 c = 0; c < componentCount; c++) {
+            values[c] = in ? component(in, firstComponent + c) : 0.0f;
+        }
+        out += dstStride;
+    }
+}
+
+void GLTFAccessor::decodeIndices(UI64 begin, UI64 end, UI32* dst) const {
+    m_assert(_components == 1, "Index accessors must be scalars");
+
+    if (!isSparse() && _data && _componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT && _stride == sizeof(UI32)) {
+        memcpy(dst, _data + begin * _stride, (end - begin) * sizeof(UI32));
+        return;
+    }
+
+    size_t nextSparse = 0;
+    if (isSparse()) {
+        nextSparse = std::lower_bound(_sparseIndices.begin(), _sparseIndices.end(), static_cast<UI32>(begin)) -
+            _sparseIndices.begin();
+    }
+
+    for (UI64 i = begin; i < end; i++) {
+        const UC* in = element(i, &nextSparse);
+        *dst++ = in ? index(in) : 0;
+    }
+}
+
+const UC* GLTFAccessor::element(UI64 i, size_t* pNextSparse) const {
+    if (*pNextSparse < _sparseIndices.size() && _sparseIndices[*pNextSparse] == i) {
+        return _sparseValues + (*pNextSparse)++ * _components * _componentSize;
+    }
+    return _data ? _data + i * _stride : nullptr;
+}
+
+F32 GLTFAccessor::component(const UC* element, UI32 c) const {
+    const UC* value = element + c * _componentSize;
+    switch (_componentType) {
+    case TINYGLTF_COMPONENT_TYPE_FLOAT:
+        return *reinterpret_cast<const F32*>(value);
+    case TINYGLTF_COMPONENT_TYPE_BYTE: {
+        F32 v = static_cast<F32>(*reinterpret_cast<const signed char*>(value));
+        return _normalized ? std::max(v / 127.0f, -1.0f) : v;
+    }
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+        F32 v = static_cast<F32>(*value);
+        return _normalized ? v / 255.0f : v;
+    }
+    case TINYGLTF_COMPONENT_TYPE_SHORT: {
+        F32 v = static_cast<F32>(*reinterpret_cast<const I16*>(value));
+        return _normalized ? std::max(v / 32767.0f, -1.0f) : v;
+    }
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+        F32 v = static_cast<F32>(*reinterpret_cast<const UI16*>(value));
+        return _normalized ? v / 65535.0f : v;
+    }
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+        F32 v = static_cast<F32>(*reinterpret_cast<const UI32*>(value));
+        return _normalized ? v / 4294967295.0f : v;
+    }
+    default:
+        return 0.0f;
+    }
+}
+
+UI32 GLTFAccessor::index(const UC* element) const {
+    switch (_componentType) {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        return *element;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        return *reinterpret_cast<const UI16*>(element);
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        return *reinterpret_cast<const UI32*>(element);
+    default:
+        return 0; // rejected when the primitive is loaded
+    }
+}
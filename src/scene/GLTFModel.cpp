@@ -1,170 +1,724 @@
 #include <common/Print.h>
 #include <common/Assert.h>
 #include <common/vkinit.h>
+#include <common/JobSystem.h>
+#include <common/Profiler.h>
 
 #include <scene/GLTFModel.h>
+#include <scene/GLTFAccessor.h>
+#include <scene/MeshOptimizer.h>
+
+#include <app/AppConstants.h>
 
 #include <glm/gtc/type_ptr.hpp>
 
-bool GLTFModel::load(const std::string& path) {
-    tinygltf::TinyGLTF loader;
+#include <json.hpp> // shipped with tinygltf
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GLTF_MODEL_SSE
+#endif
+
+// vertices or indices extracted by a single job, large primitives are split over several jobs
+const UI64 EXTRACTION_CHUNK_SIZE = 64 * 1024;
+
+// binary glTF header and chunk identifiers
+const UI32 GLB_MAGIC      = 0x46546C67; // "glTF"
+const UI32 GLB_CHUNK_JSON = 0x4E4F534A; // "JSON"
+const UI32 GLB_CHUNK_BIN  = 0x004E4942; // "BIN\0"
+
+// handed to tinygltf in place of buffers that are memory mapped instead
+const char* EMPTY_BUFFER_URI = "data:application/octet-stream;base64,";
+
+namespace {
+    // every accessor a worker needs to extract a primitive, so workers never touch the tinygltf model
+    struct PrimitiveSource {
+        GLTFAccessor position;   // vec3
+        GLTFAccessor normal;     // vec3, optional
+        GLTFAccessor tangent;    // vec4, optional
+        GLTFAccessor texCoord;   // vec2, optional
+        GLTFAccessor indices;    // scalar
+        bool hasNormal;
+        bool hasTangent;
+        bool hasTexCoord;
+    };
+
+    struct ExtractionJob {
+        UI32 primitive;
+        UI64 begin;
+        UI64 end;
+        bool indices;
+    };
+}
+
+static std::string decodeUri(const std::string& uri) {
+    // percent encoded characters of relative uris
+    std::string decoded;
+    for (size_t i = 0; i < uri.size(); i++) {
+        if (uri[i] == '%' && i + 2 < uri.size()) {
+            decoded += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        }
+        else {
+            decoded += uri[i];
+        }
+    }
+    return decoded;
+}
+
+static bool findAttribute(const tinygltf::Primitive& primitive, const char* attribute, I32* pAccessor) {
+    auto it = primitive.attributes.find(attribute);
+    if (it == primitive.attributes.end()) {
+        return false;
+    }
+    *pAccessor = it->second;
+    return true;
+}
+
+static void extractPackedVertices(const PrimitiveSource& source, Vertex* vertices, UI64 begin, UI64 end) {
+    // gather each attribute with its own stride, texture coordinates are packed in the w components
+    const UC* position = source.position.data() + begin * source.position.stride();
+    const UC* normal   = source.normal.data()   + begin * source.normal.stride();
+    const UC* tangent  = source.tangent.data()  + begin * source.tangent.stride();
+    const UC* texCoord = source.texCoord.data() + begin * source.texCoord.stride();
+
+    for (UI64 v = begin; v < end; v++) {
+        const F32* p = reinterpret_cast<const F32*>(position);
+        const F32* n = reinterpret_cast<const F32*>(normal);
+        const F32* t = reinterpret_cast<const F32*>(tangent);
+        const F32* uv = reinterpret_cast<const F32*>(texCoord);
+#ifdef GLTF_MODEL_SSE
+        // (x, y) with a single 8 byte load, then (z, u) so that the last element never reads past the buffer
+        __m128 pXY = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const F64*>(p)));
+        __m128 pZU = _mm_unpacklo_ps(_mm_load_ss(p + 2), _mm_load_ss(uv));
+        __m128 nXY = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const F64*>(n)));
+        __m128 nZV = _mm_unpacklo_ps(_mm_load_ss(n + 2), _mm_load_ss(uv + 1));
+
+        _mm_storeu_ps(&vertices[v].positionU.x, _mm_movelh_ps(pXY, pZU));
+        _mm_storeu_ps(&vertices[v].normalV.x, _mm_movelh_ps(nXY, nZV));
+        _mm_storeu_ps(&vertices[v].tangent.x, _mm_loadu_ps(t));
+#else
+        vertices[v].positionU = { p[0], p[1], p[2], uv[0] };
+        vertices[v].normalV   = { n[0], n[1], n[2], uv[1] };
+        vertices[v].tangent   = { t[0], t[1], t[2], t[3] };
+#endif
+        position += source.position.stride();
+        normal   += source.normal.stride();
+        tangent  += source.tangent.stride();
+        texCoord += source.texCoord.stride();
+    }
+}
+
+static void extractVertices(const PrimitiveSource& source, Vertex* vertices, UI64 begin, UI64 end) {
+    // common case of plain float attributes
+    if (source.hasNormal && source.hasTangent && source.hasTexCoord && source.position.isPackedFloat() &&
+        source.normal.isPackedFloat() && source.tangent.isPackedFloat() && source.texCoord.isPackedFloat()) {
+        extractPackedVertices(source, vertices, begin, end);
+        return;
+    }
+
+    // otherwise decode each attribute straight into the vertex layout, missing attributes are defaulted
+    for (UI64 v = begin; v < end; v++) {
+        vertices[v] = { glm::vec4(0.0f), glm::vec4(0.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) };
+    }
+
+    const UI64 stride = sizeof(Vertex);
+    source.position.decodeFloats(begin, end, &vertices[begin].positionU.x, stride, 0, 3);
+    if (source.hasNormal) {
+        source.normal.decodeFloats(begin, end, &vertices[begin].normalV.x, stride, 0, 3);
+    }
+    if (source.hasTangent) {
+        source.tangent.decodeFloats(begin, end, &vertices[begin].tangent.x, stride, 0, 4);
+    }
+    if (source.hasTexCoord) {
+        source.texCoord.decodeFloats(begin, end, &vertices[begin].positionU.w, stride, 0, 1);
+        source.texCoord.decodeFloats(begin, end, &vertices[begin].normalV.w, stride, 1, 1);
+    }
+}
+
+static void optimizePrimitive(Vertex* vertices, UI32 vertexCount, UI32* indices, UI32 indexCount,
+    mesh::VertexCacheStats* pBefore, mesh::VertexCacheStats* pAfter) {
+    // malformed primitives are drawn as they are
+    if (vertexCount == 0 || indexCount == 0 || *std::max_element(indices, indices + indexCount) >= vertexCount) {
+        return;
+    }
+
+    *pBefore = mesh::simulateVertexCache(indices, indexCount, vertexCount);
+
+    std::vector<UI32> clusters;
+    mesh::tipsify(indices, indexCount, vertexCount, mesh::VERTEX_CACHE_SIZE, &clusters);
+    mesh::optimizeOverdraw(indices, indexCount, glm::value_ptr(vertices[0].positionU), sizeof(Vertex), clusters,
+        mesh::VERTEX_CACHE_SIZE, mesh::OVERDRAW_THRESHOLD);
+
+    std::vector<UI32> remap(vertexCount);
+    mesh::optimizeVertexFetchRemap(remap.data(), indices, indexCount, vertexCount);
+    mesh::remapVertices(vertices, vertexCount, remap.data());
+
+    *pAfter = mesh::simulateVertexCache(indices, indexCount, vertexCount);
+}
+
+// an unsigned integer member of a json object, the fallback when it is absent. False when it has another type
+static bool unsignedMember(const nlohmann::json& object, const char* key, size_t fallback, size_t* pValue) {
+    auto member = object.find(key);
+    if (member == object.end()) {
+        *pValue = fallback;
+        return true;
+    }
+    if (!member->is_number_unsigned()) {
+        return false;
+    }
+    *pValue = member->get<size_t>();
+    return true;
+}
+
+static std::string base64Encode(const UC* data, size_t size) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string encoded;
+    encoded.reserve((size + 2) / 3 * 4);
+    for (size_t i = 0; i < size; i += 3) {
+        UI32 bytes = static_cast<UI32>(data[i]) << 16;
+        if (i + 1 < size) bytes |= static_cast<UI32>(data[i + 1]) << 8;
+        if (i + 2 < size) bytes |= data[i + 2];
+
+        encoded += alphabet[(bytes >> 18) & 0x3f];
+        encoded += alphabet[(bytes >> 12) & 0x3f];
+        encoded += i + 1 < size ? alphabet[(bytes >> 6) & 0x3f] : '=';
+        encoded += i + 2 < size ? alphabet[bytes & 0x3f] : '=';
+    }
+    return encoded;
+}
+
+bool GLTFModel::parse(const std::string& path, std::vector<MappedFile>* pMappedFiles,
+    std::vector<const UC*>* pBufferData) {
+    MappedFile file;
+    if (!file.open(path)) {
+        print("Could not open file: %s\n", path.c_str());
+        return false;
+    }
+
+    std::string baseDir = path.substr(0, path.find_last_of("/\\") + 1);
+
+    // locate the json and, for binary files, the embedded buffer chunk
+    const char* json    = reinterpret_cast<const char*>(file.data());
+    size_t jsonSize     = file.size();
+    const UC* binChunk  = nullptr;
+    size_t binChunkSize = 0;
+    bool binary = file.size() >= 20 && *reinterpret_cast<const UI32*>(file.data()) == GLB_MAGIC;
+    if (binary) {
+        const UI32* header = reinterpret_cast<const UI32*>(file.data());
+        size_t length = std::min<size_t>(header[2], file.size());
+        jsonSize = header[3];
+        if (header[4] != GLB_CHUNK_JSON || 20 + jsonSize > length) {
+            print("Invalid .glb file: %s\n", path.c_str());
+            return false;
+        }
+        json = reinterpret_cast<const char*>(file.data()) + 20;
+
+        size_t binOffset = 20 + ((jsonSize + 3) & ~static_cast<size_t>(3));
+        if (binOffset + 8 <= length) {
+            const UI32* chunk = reinterpret_cast<const UI32*>(file.data() + binOffset);
+            if (chunk[1] == GLB_CHUNK_BIN && binOffset + 8 + chunk[0] <= length) {
+                binChunk = file.data() + binOffset + 8;
+                binChunkSize = chunk[0];
+            }
+        }
+    }
+
+    nlohmann::json document = nlohmann::json::parse(json, json + jsonSize, nullptr, false);
+    if (document.is_discarded()) {
+        print("Could not parse glTF json: %s\n", path.c_str());
+        return false;
+    }
+
+    // map every buffer held in the binary chunk or an external file, tinygltf only sees an empty data uri in
+    // their place. Data uri buffers are still decoded by tinygltf
+    size_t bufferCount = document.contains("buffers") && document["buffers"].is_array() ?
+        document["buffers"].size() : 0;
+    std::vector<const UC*> bufferData(bufferCount, nullptr);
+    std::vector<size_t> bufferSizes(bufferCount, 0);
+    for (size_t i = 0; i < bufferCount; i++) {
+        auto& buffer = document["buffers"][i];
+        std::string uri = buffer.contains("uri") && buffer["uri"].is_string() ? buffer["uri"].get<std::string>() : "";
+        if (uri.empty()) {
+            if (!binChunk) {
+                print("Missing binary chunk in: %s\n", path.c_str());
+                return false;
+            }
+            bufferData[i] = binChunk;
+            bufferSizes[i] = binChunkSize;
+        }
+        else if (uri.rfind("data:", 0) == 0) {
+            continue;
+        }
+        else {
+            MappedFile external;
+            if (!external.open(baseDir + decodeUri(uri))) {
+                print("Could not map buffer: %s\n", uri.c_str());
+                return false;
+            }
+            bufferData[i] = external.data();
+            bufferSizes[i] = external.size();
+            pMappedFiles->push_back(std::move(external));
+        }
+        buffer["uri"] = EMPTY_BUFFER_URI;
+        buffer["byteLength"] = 0;
+    }
+
+    // tinygltf decodes embedded images from its copy of their buffer, which mapped buffers no longer have. Those
+    // images become data uris instead, so only their own bytes are copied and the geometry stays mapped
+    size_t viewCount = document.contains("bufferViews") && document["bufferViews"].is_array() ?
+        document["bufferViews"].size() : 0;
+    if (document.contains("images") && document["images"].is_array()) {
+        for (auto& image : document["images"]) {
+            if (!image.is_object() || !image.contains("bufferView")) {
+                continue;
+            }
+
+            size_t view, buffer, offset, length;
+            if (!unsignedMember(image, "bufferView", 0, &view) || view >= viewCount ||
+                !document["bufferViews"][view].is_object() ||
+                !unsignedMember(document["bufferViews"][view], "buffer", bufferCount, &buffer) ||
+                buffer >= bufferCount ||
+                !unsignedMember(document["bufferViews"][view], "byteOffset", 0, &offset) ||
+                !unsignedMember(document["bufferViews"][view], "byteLength", 0, &length)) {
+                print("Invalid image buffer view in: %s\n", path.c_str());
+                return false;
+            }
 
+            // images in data uri buffers are read from tinygltf's own copy
+            if (!bufferData[buffer]) {
+                continue;
+            }
+            if (offset > bufferSizes[buffer] || length > bufferSizes[buffer] - offset) {
+                print("Image buffer view out of its buffer's range in: %s\n", path.c_str());
+                return false;
+            }
+
+            // same octet stream prefix as the emptied buffers, the image loader recognises the format itself
+            image["uri"] = EMPTY_BUFFER_URI + base64Encode(bufferData[buffer] + offset, length);
+            image.erase("bufferView");
+        }
+    }
+
+    tinygltf::TinyGLTF loader;
     std::string err, warn;
+    std::string text = document.dump();
+    bool loaded = loader.LoadASCIIFromString(&_model, &err, &warn, text.c_str(), static_cast<UI32>(text.size()),
+        baseDir);
+    // buffers point into the binary chunk, keep the file mapped
+    if (binChunk) {
+        pMappedFiles->push_back(std::move(file));
+    }
 
-    // parse the gltf file
-    if (!loader.LoadASCIIFromFile(&_model, &err, &warn, path)) {
-        print(err.c_str());
-        print("Could not parse .gltf file: %s\n", path.c_str());
+    if (!warn.empty()) {
+        print("%s\n", warn.c_str());
+    }
+
+    if (!loaded) {
+        print("%s\n", err.c_str());
+        print("Could not parse glTF file: %s\n", path.c_str());
+        return false;
+    }
+
+    for (size_t i = 0; i < _model.buffers.size(); i++) {
+        if (!bufferData[i]) {
+            bufferData[i] = _model.buffers[i].data.data();
+        }
+    }
+    *pBufferData = std::move(bufferData);
+    return true;
+}
+
+bool GLTFModel::load(const std::string& path) {
+    PROFILE_ZONE("GLTFModel::load");
+    if (CookedAsset::hasExtension(path)) {
+        return loadCooked(path);
+    }
+
+    // mappings are only needed until the vertices and indices are extracted
+    std::vector<MappedFile> mappedFiles;
+    std::vector<const UC*> buffers;
+    if (!parse(path, &mappedFiles, &buffers)) {
         return onCpu;
     }
 
-    if (!warn.empty()) {
-        print(warn.c_str());
-    }
-
-    Vertex* vertex;
-    UI32* index;
-    // extract vertices (only draw triangle list primitives for now)
-    for (UI32 m = 0; m < _model.meshes.size(); m++) {
-        auto& mesh = _model.meshes[m];
-        for (UI32 p = 0; p < mesh.primitives.size(); p++) {
-            auto& primitive = mesh.primitives[p];
-            if (primitive.mode == TRIANGLES) {
-                // resize vertices array using number of vertex positions
-                auto& accessor = _model.accessors[primitive.attributes["POSITION"]];
-                _vertices.resize(_vertices.size() + accessor.count);
-                // get iterator to first new element in vertex array
-                vertex = (_vertices.end() - accessor.count)._Ptr;
-
-                // get the buffer views for each attribute
-                std::vector<tinygltf::BufferView*> bufferViews = {
-                    &_model.bufferViews[accessor.bufferView],
-                    &_model.bufferViews[_model.accessors[primitive.attributes["NORMAL"]].bufferView],
-                    &_model.bufferViews[_model.accessors[primitive.attributes["TANGENT"]].bufferView],
-                    &_model.bufferViews[_model.accessors[primitive.attributes["TEXCOORD_0"]].bufferView]
-                };
+    // resolve accessors of every primitive (only draw triangle list primitives for now)
+    std::vector<PrimitiveSource> sources;
+    std::vector<I32> materials;
+    for (const auto& mesh : _model.meshes) {
+        for (const auto& primitive : mesh.primitives) {
+            if (primitive.mode != TRIANGLES) {
+                continue;
+            }
 
-                UC* pData;
-                // extract vertices
-                for (UI64 v = 0; v < accessor.count; v++) {
-                    // copy in position (vec3 = 12)
-                    pData = _model.buffers[bufferViews[0]->buffer].data.data() + bufferViews[0]->byteOffset;
-                    memcpy(glm::value_ptr(vertex->positionU), (F32*)(pData  + v * 12), 12);
-                    // copy in normal (vec3 = 12)
-                    pData = _model.buffers[bufferViews[1]->buffer].data.data() + bufferViews[1]->byteOffset;
-                    memcpy(glm::value_ptr(vertex->normalV), (F32*)(pData + v * 12), 12);
-                    // copy in tangent (vec4 = 16)
-                    pData = _model.buffers[bufferViews[2]->buffer].data.data() + bufferViews[2]->byteOffset;
-                    memcpy(glm::value_ptr(vertex->tangent), (F32*)(pData+ v * 16), 16);
-                    // copy in texture coordinates (vec2 = 8)
-                    pData = _model.buffers[bufferViews[3]->buffer].data.data() + bufferViews[3]->byteOffset;
-                    vertex->positionU.w = *(F32*)(pData + v * 8);
-                    vertex->normalV.w   = *(F32*)(pData + v * 8 + 4);
-                    // increment vertex iterator
-                    vertex++;
-                }
+            I32 position, normal, tangent, texCoord;
+            if (!findAttribute(primitive, "POSITION", &position) || primitive.indices < 0) {
+                continue;
+            }
 
-                // accessor to index data
-                accessor = _model.accessors[primitive.indices];
-                _indices.resize(_indices.size() + accessor.count);
-                // pointer to the first new element in index array
-                index = (_indices.end() - accessor.count)._Ptr;
-
-                // buffer view for index data
-                auto& indexBufferView = _model.bufferViews[accessor.bufferView];
-                pData = _model.buffers[indexBufferView.buffer].data.data() + indexBufferView.byteOffset;
-                // extract indices (can't memcpy because indices may need to cast from short)
-                for (UI64 i = 0; i < accessor.count; i++) {
-                    index[i] = static_cast<UI32>(*(UI16*)(pData + i * 2));
-                }
+            PrimitiveSource source{};
+            source.position    = GLTFAccessor(_model, position, buffers);
+            source.indices     = GLTFAccessor(_model, primitive.indices, buffers);
+            source.hasNormal   = findAttribute(primitive, "NORMAL", &normal);
+            source.hasTangent  = findAttribute(primitive, "TANGENT", &tangent);
+            source.hasTexCoord = findAttribute(primitive, "TEXCOORD_0", &texCoord);
+            if (source.hasNormal) {
+                source.normal = GLTFAccessor(_model, normal, buffers);
+            }
+            if (source.hasTangent) {
+                source.tangent = GLTFAccessor(_model, tangent, buffers);
+            }
+            if (source.hasTexCoord) {
+                source.texCoord = GLTFAccessor(_model, texCoord, buffers);
             }
+
+            if (!source.indices.isIndexType()) {
+                print("Skipping primitive with unsupported index type in %s\n", path.c_str());
+                continue;
+            }
+
+            sources.push_back(std::move(source));
+            materials.push_back(primitive.material);
         }
     }
 
+    // primitives of a material are laid out next to each other so that their draws can be merged, output
+    // ranges are then a prefix sum over their sizes and primitives can be extracted in any order
+    std::vector<UI32> order(sources.size());
+    for (UI32 p = 0; p < order.size(); p++) {
+        order[p] = p;
+    }
+    std::stable_sort(order.begin(), order.end(), [&materials](UI32 a, UI32 b) { return materials[a] < materials[b]; });
+
+    std::vector<PrimitiveSource> sortedSources;
+    sortedSources.reserve(sources.size());
+    UI64 vertexCount = _vertices.size();
+    UI64 indexCount  = _indices.size();
+    for (UI32 p : order) {
+        Primitive range{};
+        range.firstVertex = static_cast<UI32>(vertexCount);
+        range.vertexCount = static_cast<UI32>(sources[p].position.count());
+        range.firstIndex  = static_cast<UI32>(indexCount);
+        range.indexCount  = static_cast<UI32>(sources[p].indices.count());
+        range.material    = materials[p];
+        _primitives.push_back(range);
+        sortedSources.push_back(std::move(sources[p]));
+
+        vertexCount += range.vertexCount;
+        indexCount  += range.indexCount;
+    }
+    sources = std::move(sortedSources);
+
+    m_assert(vertexCount <= UINT32_MAX, "Model has too many vertices for 32 bit indices");
+
+    // output ranges are disjoint, arrays are sized once and written to concurrently
+    UI32 firstPrimitive = static_cast<UI32>(_primitives.size() - sources.size());
+    _vertices.resize(vertexCount);
+    _indices.resize(indexCount);
+
+    // split primitives into chunks so that a single large primitive still spreads over every worker
+    std::vector<ExtractionJob> jobs;
+    for (UI32 p = 0; p < sources.size(); p++) {
+        const Primitive& range = _primitives[firstPrimitive + p];
+        for (UI64 v = 0; v < range.vertexCount; v += EXTRACTION_CHUNK_SIZE) {
+            jobs.push_back({ p, v, std::min<UI64>(v + EXTRACTION_CHUNK_SIZE, range.vertexCount), false });
+        }
+        for (UI64 i = 0; i < range.indexCount; i += EXTRACTION_CHUNK_SIZE) {
+            jobs.push_back({ p, i, std::min<UI64>(i + EXTRACTION_CHUNK_SIZE, range.indexCount), true });
+        }
+    }
+
+    JobSystem::get().parallelFor(jobs.size(), [&](size_t j) {
+        const ExtractionJob& job = jobs[j];
+        const Primitive& range = _primitives[firstPrimitive + job.primitive];
+        if (job.indices) {
+            sources[job.primitive].indices.decodeIndices(job.begin, job.end,
+                _indices.data() + range.firstIndex + job.begin);
+        }
+        else {
+            extractVertices(sources[job.primitive], _vertices.data() + range.firstVertex, job.begin, job.end);
+        }
+    });
+
+    // reorder each primitive for the post-transform cache, overdraw and vertex fetch, primitives are independent.
+    // Indices are then made absolute within the model, every draw uses a vertex offset of 0
+    std::vector<mesh::VertexCacheStats> before(sources.size());
+    std::vector<mesh::VertexCacheStats> after(sources.size());
+    JobSystem::get().parallelFor(sources.size(), [&](size_t p) {
+        const Primitive& range = _primitives[firstPrimitive + p];
+        UI32* indices = _indices.data() + range.firstIndex;
+        optimizePrimitive(_vertices.data() + range.firstVertex, range.vertexCount, indices, range.indexCount,
+            &before[p], &after[p]);
+        for (UI32 i = 0; i < range.indexCount; i++) {
+            indices[i] += range.firstVertex;
+        }
+    });
+
+    buildBounds(_vertices.data());
+
+    if (std::getenv(PRINT_STATS_VARIABLE)) {
+        mesh::VertexCacheStats totalBefore, totalAfter;
+        for (size_t p = 0; p < sources.size(); p++) {
+            totalBefore += before[p];
+            totalAfter  += after[p];
+        }
+        print("Optimized %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", path.c_str(),
+            totalBefore.acmr(), totalAfter.acmr(), totalBefore.atvr(), totalAfter.atvr());
+    }
+
+    onCpu = true;
+    return onCpu;
+}
+
+bool GLTFModel::loadCooked(const std::string& path) {
+    if (!_cooked.open(path)) {
+        return onCpu;
+    }
+
+    // only the primitive ranges are needed on the cpu, the rest is uploaded from the mapping
+    UI32 count;
+    const CookedPrimitive* primitives = _cooked.section<CookedPrimitive>(COOKED_PRIMITIVES, &count);
+    for (UI32 p = 0; p < count; p++) {
+        _primitives.push_back({ primitives[p].firstIndex, primitives[p].indexCount, primitives[p].firstVertex,
+            primitives[p].vertexCount, primitives[p].material });
+    }
+    buildBounds(_cooked.section<Vertex>(COOKED_VERTICES, &count));
+
     onCpu = true;
     return onCpu;
 }
 
+void GLTFModel::buildBounds(const Vertex* vertices) {
+    JobSystem::get().parallelFor(_primitives.size(), [&](size_t p) {
+        Primitive& primitive = _primitives[p];
+        const Vertex* first = vertices + primitive.firstVertex;
+        primitive.bounds = Aabb{};
+        for (UI32 v = 0; v < primitive.vertexCount; v++) {
+            glm::vec3 position(first[v].positionU);
+            primitive.bounds.min = v == 0 ? position : glm::min(primitive.bounds.min, position);
+            primitive.bounds.max = v == 0 ? position : glm::max(primitive.bounds.max, position);
+        }
+    });
+
+    std::vector<Aabb> boxes(_primitives.size());
+    for (size_t p = 0; p < _primitives.size(); p++) {
+        boxes[p] = _primitives[p].bounds;
+    }
+    _bvh.build(boxes);
+}
+
+// level offset of textures without mips
+static const VkDeviceSize BASE_LEVEL_OFFSET = 0;
+
+static kDescriptorSetLayout materialLayout(bool albedo, bool metallicRoughness, bool normal) {
+    if (!albedo || !metallicRoughness) {
+        return OFFSCREEN_DEFAULT_DESCRIPTOR_LAYOUT;
+    }
+    return normal ? OFFSCREEN_PBR_NORMAL_DESCRIPTOR_LAYOUT : OFFSCREEN_PBR_DESCRIPTOR_LAYOUT;
+}
+
+GLTFModel::MaterialSource GLTFModel::gltfMaterialSource(UI32 i) const {
+    const tinygltf::Material& material = _model.materials[i];
+    const I32 textures[3] = { material.pbrMetallicRoughness.baseColorTexture.index,
+        material.pbrMetallicRoughness.metallicRoughnessTexture.index, material.normalTexture.index };
+
+    MaterialSource source{};
+    source.type = materialLayout(textures[0] != -1, textures[1] != -1, textures[2] != -1);
+    source.textureCount = source.type == OFFSCREEN_PBR_NORMAL_DESCRIPTOR_LAYOUT ? 3 :
+        source.type == OFFSCREEN_PBR_DESCRIPTOR_LAYOUT ? 2 : 0;
+
+    for (UI32 t = 0; t < source.textureCount; t++) {
+        const tinygltf::Image& image = _model.images[_model.textures[textures[t]].source];
+        source.images[t] = { { static_cast<UI32>(image.width), static_cast<UI32>(image.height), 1 },
+            t == 0 ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM,
+            { const_cast<UC*>(image.image.data()), image.image.size() } };
+        source.mipLevels[t] = 1;
+        source.mipOffsets[t] = &BASE_LEVEL_OFFSET;
+    }
+    return source;
+}
+
+GLTFModel::MaterialSource GLTFModel::cookedMaterialSource(UI32 i) const {
+    UI32 count;
+    const CookedMaterial& material = _cooked.section<CookedMaterial>(COOKED_MATERIALS, &count)[i];
+    const CookedTexture* cookedTextures = _cooked.section<CookedTexture>(COOKED_TEXTURES, &count);
+    const I32 textures[3] = { material.albedo, material.metallicRoughness, material.normal };
+
+    MaterialSource source{};
+    source.type = materialLayout(textures[0] != -1, textures[1] != -1, textures[2] != -1);
+    source.textureCount = source.type == OFFSCREEN_PBR_NORMAL_DESCRIPTOR_LAYOUT ? 3 :
+        source.type == OFFSCREEN_PBR_DESCRIPTOR_LAYOUT ? 2 : 0;
+
+    for (UI32 t = 0; t < source.textureCount; t++) {
+        const CookedTexture& texture = cookedTextures[textures[t]];
+        source.images[t] = { { texture.width, texture.height, 1 }, texture.format,
+            { const_cast<UC*>(_cooked.textureData(texture)), texture.size } };
+        source.mipLevels[t] = texture.mipLevels;
+        source.mipOffsets[t] = texture.mipOffsets;
+    }
+    return source;
+}
+
 // TODO: move material texture loading to material class (disable tinygltf load image and manage on own)
+// whether the binaries of a layout's shaders were loaded, compute layouts have no fragment shader
+static bool hasShaders(const Renderer& renderer, kDescriptorSetLayout type) {
+    const auto& shaders = kShaders[type];
+    return renderer._shaders.has(shaders.first) && (*shaders.second == '\0' || renderer._shaders.has(shaders.second));
+}
+
 bool GLTFModel::uploadToGpu(Renderer& renderer) {
+    PROFILE_ZONE("GLTFModel::uploadToGpu");
     m_assert(onCpu, "model not loaded on CPU, cannot upload data to GPU!");
 
     if (onGpu) {
         return onGpu;
     }
 
+    // compact vertices need their own vertex shader, without its binary the model is uploaded with full vertices
+    if (_vertexFormat == VERTEX_FORMAT_COMPACT && !renderer._shaders.has(kCompactVertexShader)) {
+        print("No %s, uploading full vertices instead of compact ones\n", kCompactVertexShader);
+        _vertexFormat = VERTEX_FORMAT_FULL;
+    }
+
     // model buffers
     {
+        // cooked sections are copied straight from the mapped file into the staging ring
+        BufferData vertices{ (UC*)_vertices.data(), _vertices.size() * sizeof(Vertex) };
+        BufferData indices{ (UC*)_indices.data(), _indices.size() * sizeof(UI32) };
+        const Vertex* source = _vertices.data();
+        UI32 vertexCount = static_cast<UI32>(_vertices.size());
+        if (_cooked.isOpen()) {
+            UI32 count;
+            source = _cooked.section<Vertex>(COOKED_VERTICES, &vertexCount);
+            vertices = { (UC*)source, _cooked.sectionSize(COOKED_VERTICES) };
+            indices = { (UC*)_cooked.section<UI32>(COOKED_INDICES, &count), _cooked.sectionSize(COOKED_INDICES) };
+        }
+
+        // quantize into a temporary buffer, the upload context copies it before it goes out of scope
+        std::vector<CompactVertex> compactVertices;
+        if (_vertexFormat == VERTEX_FORMAT_COMPACT) {
+            _quantization = CompactVertex::quantization(source, vertexCount);
+            compactVertices.resize(vertexCount);
+            UI64 chunkCount = (vertexCount + EXTRACTION_CHUNK_SIZE - 1) / EXTRACTION_CHUNK_SIZE;
+            JobSystem::get().parallelFor(chunkCount, [&](size_t chunk) {
+                UI64 end = std::min<UI64>((chunk + 1) * EXTRACTION_CHUNK_SIZE, vertexCount);
+                for (UI64 v = chunk * EXTRACTION_CHUNK_SIZE; v < end; v++) {
+                    compactVertices[v] = CompactVertex::encode(source[v], _quantization);
+                }
+            });
+            vertices = { (UC*)compactVertices.data(), compactVertices.size() * sizeof(CompactVertex) };
+            if (std::getenv(PRINT_STATS_VARIABLE)) {
+                print("Compact vertices: %zu bytes instead of %zu\n",
+                    compactVertices.size() * sizeof(CompactVertex), static_cast<size_t>(vertexCount) * sizeof(Vertex));
+            }
+        }
+        else {
+            _quantization = VertexQuantization{};
+        }
+
         // create vertex buffer
-        _vertexBuffer = Buffer::createDeviceLocalBuffer(&renderer._context, renderer._commandPools[RENDER_CMD_POOL],
-            BufferData{ (UC*)_vertices.data(), _vertices.size() * sizeof(Vertex) }, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+        _vertexBuffer = Buffer::createDeviceLocalBuffer(&renderer._context, renderer._uploadContext,
+            vertices, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
 
         // create index buffer
-        _indexBuffer = Buffer::createDeviceLocalBuffer(&renderer._context, renderer._commandPools[RENDER_CMD_POOL],
-            BufferData{ (UC*)_indices.data(), _indices.size() * sizeof(UI32) }, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+        _indexBuffer = Buffer::createDeviceLocalBuffer(&renderer._context, renderer._uploadContext,
+            indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+        // reserve room for the uniforms in every slice of the renderer's arena
+        _uniformOffset = renderer._uniformArena.reserve(sizeof(OffscreenUBO));
+    }
+
+    UI32 materialCount = static_cast<UI32>(_model.materials.size());
+    if (_cooked.isOpen()) {
+        _cooked.section<CookedMaterial>(COOKED_MATERIALS, &materialCount);
+    }
 
-        // create uniform buffer
-        _uniformBuffer = Buffer::createBuffer(renderer._context,
-            renderer._swapChain.imageCount() * sizeof(CompositionUBO), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    _materials.resize(materialCount);
+
+    std::vector<MaterialSource> sources(materialCount);
+    UI32 textureCount = 0;
+    for (UI32 i = 0; i < materialCount; i++) {
+        sources[i] = _cooked.isOpen() ? cookedMaterialSource(i) : gltfMaterialSource(i);
+        textureCount += sources[i].textureCount;
+    }
+
+    // with descriptor indexing every material shares one pipeline and one descriptor set, materials fall back
+    // to a pipeline and set of their own when the bindless shaders were not compiled
+    _bindless = renderer._context.descriptorIndexing && textureCount <= renderer._context.maxBindlessTextures;
+    if (_bindless && !hasShaders(renderer, OFFSCREEN_BINDLESS_DESCRIPTOR_LAYOUT)) {
+        print("No %s, drawing materials without descriptor indexing\n",
+            kShaders[OFFSCREEN_BINDLESS_DESCRIPTOR_LAYOUT].second);
+        _bindless = false;
+    }
+
+    // the indirect vertex shader reads full vertices, without the cull and indirect shaders the bindless
+    // pipeline draws every primitive from the cpu
+    _indirect = _bindless && renderer._context.indirectDraws && _vertexFormat == VERTEX_FORMAT_FULL &&
+        _primitives.size() <= renderer._context.deviceProperties.limits.maxDrawIndirectCount;
+    if (_indirect && (!hasShaders(renderer, OFFSCREEN_INDIRECT_DESCRIPTOR_LAYOUT) ||
+        !hasShaders(renderer, CULL_DESCRIPTOR_LAYOUT))) {
+        print("No %s, %s or %s, culling and drawing on the cpu\n", kShaders[CULL_DESCRIPTOR_LAYOUT].first,
+            kShaders[OFFSCREEN_INDIRECT_DESCRIPTOR_LAYOUT].first, kShaders[OFFSCREEN_INDIRECT_DESCRIPTOR_LAYOUT].second);
+        _indirect = false;
+    }
+    if (_bindless) {
+        _bindlessPipeline = Material::requestPipeline(renderer,
+            _indirect ? OFFSCREEN_INDIRECT_DESCRIPTOR_LAYOUT : OFFSCREEN_BINDLESS_DESCRIPTOR_LAYOUT, _vertexFormat);
     }
 
-    _materials.resize(_model.materials.size());
     // generate materials (pipelines, descriptors)
     for (UI32 i = 0; i < _materials.size(); i++) {
-        auto& material = _model.materials[i];
         // material type determines the descriptor set layout to use
-        kDescriptorSetLayout type = OFFSCREEN_DEFAULT_DESCRIPTOR_LAYOUT;
-        kTextureMask textures = NO_TEXTURE_BIT;
-        if (material.pbrMetallicRoughness.baseColorTexture.index != -1 &&
-            material.pbrMetallicRoughness.metallicRoughnessTexture.index != -1) {
-            type = OFFSCREEN_PBR_DESCRIPTOR_LAYOUT;
-            textures |= ALBEDO_TEXTURE_BIT | OCCLUSION_METALLIC_ROUGNESS_TEXTURE_BIT;
-            if (material.normalTexture.index != -1) {
-                type = OFFSCREEN_PBR_NORMAL_DESCRIPTOR_LAYOUT;
-                textures |= NORMAL_TEXTURE_BIT;
-            }
+        const MaterialSource& source = sources[i];
+        kDescriptorSetLayout type = source.type;
+
+        // pipelines are shared between materials of the same type
+        if (!_bindless) {
+            _materials[i].createPipeline(renderer, type, _vertexFormat);
         }
-        // TODO: check if pipeline for material type exists already (create pipeline cache)
-        _materials[i].createPipeline(renderer, type);
 
         // create the descriptors and descriptors sets
         {
-            // check set bits in mask for number of textures
-            // bit magic from: https://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetParallel
-            textures = textures - ((textures >> 1) & 0x55555555);
-            textures = (textures & 0x33333333) + ((textures >> 2) & 0x33333333);
-            UI32 size = ((textures + (textures >> 4) & 0xF0F0F0F) * 0x1010101) >> 24;
-
-            _materials[i]._textures.resize(size);
             // create necessary textures based on descriptor set layout (ie type of material)
             // TODO: material and texture cache
             // !! -- Assumption that textures are always RGBA format -- !!
+            _materials[i]._textures.resize(source.textureCount);
+            for (UI32 t = 0; t < source.textureCount; t++) {
+                _materials[i]._textures[t].uploadToGpu(renderer, source.images[t], source.mipLevels[t],
+                    source.mipOffsets[t]);
+            }
+
+            // bindless materials are written to the model's set below
+            if (_bindless) {
+                continue;
+            }
+
             switch (type) {
             case OFFSCREEN_DEFAULT_DESCRIPTOR_LAYOUT: {
+                VkDescriptorSetAllocateInfo allocInfo = vkinit::descriptorSetAllocInfo(renderer._descriptorPool,
+                    1, &renderer._descriptorSetLayouts[OFFSCREEN_DEFAULT_DESCRIPTOR_LAYOUT]);
+
+                if (vkAllocateDescriptorSets(renderer._context.device, &allocInfo, &_materials[i]._descriptorSet) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to allocate descriptor sets!");
+                }
+
                 // 0: offscreen uniform
-                VkDescriptorBufferInfo offScreenUboInf{};
-                offScreenUboInf.buffer = _uniformBuffer._vkBuffer;
-                offScreenUboInf.range = sizeof(OffscreenUBO);
+                VkDescriptorBufferInfo offScreenUboInf = renderer._uniformArena.descriptorInfo(_uniformOffset,
+                    sizeof(OffscreenUBO));
 
                 // create descriptor set
                 VkWriteDescriptorSet writeDescriptorSet = vkinit::writeDescriptorSet(_materials[i]._descriptorSet, 
-                    0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &offScreenUboInf);
+                    0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &offScreenUboInf);
 
                 vkUpdateDescriptorSets(renderer._context.device, 1, &writeDescriptorSet, 0, nullptr);
+                break;
             }
             case OFFSCREEN_PBR_DESCRIPTOR_LAYOUT: {
-                // create textures
-                auto& texture = _model.images[material.pbrMetallicRoughness.baseColorTexture.index];
-                _materials[i]._textures[0].uploadToGpu(renderer, { 
-                    { static_cast<UI32>(texture.width), static_cast<UI32>(texture.height), 1 },
-                    VK_FORMAT_R8G8B8A8_SRGB, { texture.image.data(), texture.image.size() } });
-
-                texture = _model.images[material.pbrMetallicRoughness.metallicRoughnessTexture.index];
-                _materials[i]._textures[1].uploadToGpu(renderer, { 
-                    { static_cast<UI32>(texture.width), static_cast<UI32>(texture.height), 1},
-                    VK_FORMAT_R8G8B8A8_UNORM, { texture.image.data(), texture.image.size() } });
-
                 // allocate descriptor set
                 VkDescriptorSetAllocateInfo allocInfo = vkinit::descriptorSetAllocInfo(renderer._descriptorPool,
                     1, &renderer._descriptorSetLayouts[OFFSCREEN_PBR_DESCRIPTOR_LAYOUT]);
@@ -174,9 +728,8 @@ bool GLTFModel::uploadToGpu(Renderer& renderer) {
                 }
 
                 // 0: offscreen uniform buffer
-                VkDescriptorBufferInfo offScreenUboInf{};
-                offScreenUboInf.buffer = _uniformBuffer._vkBuffer;
-                offScreenUboInf.range = sizeof(OffscreenUBO);
+                VkDescriptorBufferInfo offScreenUboInf = renderer._uniformArena.descriptorInfo(_uniformOffset,
+                    sizeof(OffscreenUBO));
 
                 // 1: albedo sampler
                 VkDescriptorImageInfo albedoImageInfo{};
@@ -193,7 +746,7 @@ bool GLTFModel::uploadToGpu(Renderer& renderer) {
                 // create descriptor set
                 VkWriteDescriptorSet writeDescriptorSets[3] = {
                     vkinit::writeDescriptorSet(_materials[i]._descriptorSet, 0, 
-                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &offScreenUboInf),
+                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &offScreenUboInf),
                     vkinit::writeDescriptorSet(_materials[i]._descriptorSet, 1, 
                         VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &albedoImageInfo),
                     vkinit::writeDescriptorSet(_materials[i]._descriptorSet, 2, 
@@ -204,22 +757,6 @@ bool GLTFModel::uploadToGpu(Renderer& renderer) {
                 break;
             }
             case OFFSCREEN_PBR_NORMAL_DESCRIPTOR_LAYOUT: {
-                // upload textures to the gpu
-                auto& texture = _model.images[material.pbrMetallicRoughness.baseColorTexture.index];
-                _materials[i]._textures[0].uploadToGpu(renderer, { 
-                    { static_cast<UI32>(texture.width), static_cast<UI32>(texture.height), 1 },
-                    VK_FORMAT_R8G8B8A8_SRGB, { texture.image.data(), texture.image.size() } });
-
-                texture = _model.images[material.pbrMetallicRoughness.metallicRoughnessTexture.index];
-                _materials[i]._textures[1].uploadToGpu(renderer, { 
-                    { static_cast<UI32>(texture.width), static_cast<UI32>(texture.height), 1 },
-                    VK_FORMAT_R8G8B8A8_UNORM, { texture.image.data(), texture.image.size() } });
-
-                texture = _model.images[material.normalTexture.index];
-                _materials[i]._textures[2].uploadToGpu(renderer, { 
-                    { static_cast<UI32>(texture.width), static_cast<UI32>(texture.height), 1 },
-                    VK_FORMAT_R8G8B8A8_UNORM, { texture.image.data(), texture.image.size() } });
-
                 // allocate descriptor set
                 VkDescriptorSetAllocateInfo allocInfo = vkinit::descriptorSetAllocInfo(renderer._descriptorPool,
                     1, &renderer._descriptorSetLayouts[OFFSCREEN_PBR_NORMAL_DESCRIPTOR_LAYOUT]);
@@ -230,9 +767,8 @@ bool GLTFModel::uploadToGpu(Renderer& renderer) {
                 }
 
                 // 0: offscreen uniform buffer
-                VkDescriptorBufferInfo offScreenUboInf{};
-                offScreenUboInf.buffer = _uniformBuffer._vkBuffer;
-                offScreenUboInf.range = sizeof(OffscreenUBO);
+                VkDescriptorBufferInfo offScreenUboInf = renderer._uniformArena.descriptorInfo(_uniformOffset,
+                    sizeof(OffscreenUBO));
 
                 // 1: albedo sampler
                 VkDescriptorImageInfo albedoImageInfo{};
@@ -255,7 +791,7 @@ bool GLTFModel::uploadToGpu(Renderer& renderer) {
                 // create descriptor set
                 VkWriteDescriptorSet writeDescriptorSets[4] = {
                     vkinit::writeDescriptorSet(_materials[i]._descriptorSet, 0, 
-                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &offScreenUboInf),
+                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &offScreenUboInf),
                     vkinit::writeDescriptorSet(_materials[i]._descriptorSet, 1, 
                         VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &albedoImageInfo),
                     vkinit::writeDescriptorSet(_materials[i]._descriptorSet, 2, 
@@ -268,22 +804,6 @@ bool GLTFModel::uploadToGpu(Renderer& renderer) {
                 break;
             }
             case OFFSCREEN_PBR_NORMAL_EMISSIVE_DESCRIPTOR_LAYOUT: {
-                // upload textures to the gpu
-                auto& texture = _model.images[material.pbrMetallicRoughness.baseColorTexture.index];
-                _materials[i]._textures[0].uploadToGpu(renderer, {
-                    { static_cast<UI32>(texture.width), static_cast<UI32>(texture.height), 1 },
-                    VK_FORMAT_R8G8B8A8_SRGB, { texture.image.data(), texture.image.size() } });
-
-                texture = _model.images[material.pbrMetallicRoughness.metallicRoughnessTexture.index];
-                _materials[i]._textures[1].uploadToGpu(renderer, {
-                    { static_cast<UI32>(texture.width), static_cast<UI32>(texture.height), 1 },
-                    VK_FORMAT_R8G8B8A8_UNORM, { texture.image.data(), texture.image.size() } });
-
-                texture = _model.images[material.normalTexture.index];
-                _materials[i]._textures[2].uploadToGpu(renderer, {
-                    { static_cast<UI32>(texture.width), static_cast<UI32>(texture.height), 1 },
-                    VK_FORMAT_R8G8B8A8_UNORM, { texture.image.data(), texture.image.size() } });
-
                 // allocate descriptor set
                 VkDescriptorSetAllocateInfo allocInfo = vkinit::descriptorSetAllocInfo(renderer._descriptorPool,
                     1, &renderer._descriptorSetLayouts[OFFSCREEN_PBR_NORMAL_DESCRIPTOR_LAYOUT]);
@@ -294,9 +814,8 @@ bool GLTFModel::uploadToGpu(Renderer& renderer) {
                 }
 
                 // 0: offscreen uniform buffer
-                VkDescriptorBufferInfo offScreenUboInf{};
-                offScreenUboInf.buffer = _uniformBuffer._vkBuffer;
-                offScreenUboInf.range = sizeof(OffscreenUBO);
+                VkDescriptorBufferInfo offScreenUboInf = renderer._uniformArena.descriptorInfo(_uniformOffset,
+                    sizeof(OffscreenUBO));
 
                 // 1: albedo sampler
                 VkDescriptorImageInfo albedoImageInfo{};
@@ -319,7 +838,7 @@ bool GLTFModel::uploadToGpu(Renderer& renderer) {
                 // create descriptor set
                 VkWriteDescriptorSet writeDescriptorSets[4] = {
                     vkinit::writeDescriptorSet(_materials[i]._descriptorSet, 0,
-                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, &offScreenUboInf),
+                        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &offScreenUboInf),
                     vkinit::writeDescriptorSet(_materials[i]._descriptorSet, 1,
                         VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &albedoImageInfo),
                     vkinit::writeDescriptorSet(_materials[i]._descriptorSet, 2,
@@ -337,18 +856,227 @@ bool GLTFModel::uploadToGpu(Renderer& renderer) {
             }
         }
     }
+
+    if (_bindless) {
+        createBindlessDescriptors(renderer, sources);
+    }
+    if (std::getenv(PRINT_STATS_VARIABLE)) {
+        if (_bindless) {
+            print("%zu materials and %u textures bound with one bindless descriptor set\n", _materials.size(),
+                textureCount);
+        }
+        else {
+            print("%zu materials share %zu pipelines\n", _materials.size(), renderer._pipelines.pipelineCount());
+        }
+    }
+
+    // draw state is fixed from here on, so records are sorted once before anything records them. Everything is
+    // visible until the first cull
+    buildDrawRecords();
+    _visible.assign(_primitives.size(), 1);
+    batchDraws();
+    if (_indirect) {
+        _indirectDraws.init(renderer, indirectDrawRecords(), _uniformOffset);
+    }
+    if (std::getenv(PRINT_STATS_VARIABLE)) {
+        if (_indirect) {
+            print("%zu primitives culled and drawn on the gpu\n", _drawRecords.size());
+        }
+        else {
+            print("%zu primitives drawn with %zu draws\n", _drawRecords.size(), _draws.size());
+        }
+    }
+
+    // everything has been copied to the staging ring
+    _cooked.close();
+
     onGpu = true;
     return onGpu;
 }
 
+void GLTFModel::createBindlessDescriptors(Renderer& renderer, const std::vector<MaterialSource>& sources) {
+    // parameters of every material and a trailing default material for primitives without one
+    std::vector<MaterialParameters> parameters(_materials.size() + 1, MaterialParameters{ -1, -1, -1, 0 });
+    std::vector<VkDescriptorImageInfo> imageInfos;
+
+    for (UI32 i = 0; i < _materials.size(); i++) {
+        // material textures are in descriptor binding order
+        I32* textures[3] = { &parameters[i].albedoTexture, &parameters[i].metallicRoughnessTexture,
+            &parameters[i].normalTexture };
+        for (UI32 t = 0; t < sources[i].textureCount && t < 3; t++) {
+            *textures[t] = static_cast<I32>(imageInfos.size());
+            imageInfos.push_back({ _materials[i]._textures[t]._sampler, _materials[i]._textures[t]._imageView,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+        }
+    }
+
+    _materialBuffer = Buffer::createDeviceLocalBuffer(&renderer._context, renderer._uploadContext,
+        BufferData{ (UC*)parameters.data(), parameters.size() * sizeof(MaterialParameters) },
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+    // the texture array of the set only takes as many descriptors from the pool as the model has textures
+    UI32 textureCount = static_cast<UI32>(imageInfos.size());
+    VkDescriptorSetVariableDescriptorCountAllocateInfoEXT variableCountInfo{};
+    variableCountInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO_EXT;
+    variableCountInfo.descriptorSetCount = 1;
+    variableCountInfo.pDescriptorCounts = &textureCount;
+
+    VkDescriptorSetAllocateInfo allocInfo = vkinit::descriptorSetAllocInfo(renderer._bindlessDescriptorPool,
+        1, &renderer._descriptorSetLayouts[OFFSCREEN_BINDLESS_DESCRIPTOR_LAYOUT]);
+    allocInfo.pNext = &variableCountInfo;
+
+    if (vkAllocateDescriptorSets(renderer._context.device, &allocInfo, &_bindlessDescriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate bindless descriptor set!");
+    }
+
+    // 0: offscreen uniform buffer
+    VkDescriptorBufferInfo offScreenUboInf = renderer._uniformArena.descriptorInfo(_uniformOffset,
+        sizeof(OffscreenUBO));
+
+    // 1: material parameters
+    VkDescriptorBufferInfo materialBufferInfo{ _materialBuffer._vkBuffer, 0, VK_WHOLE_SIZE };
+
+    std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+        vkinit::writeDescriptorSet(_bindlessDescriptorSet, BINDLESS_UNIFORM_BINDING,
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, &offScreenUboInf),
+        vkinit::writeDescriptorSet(_bindlessDescriptorSet, BINDLESS_MATERIALS_BINDING,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &materialBufferInfo)
+    };
+
+    // 2: every texture of the model
+    if (textureCount > 0) {
+        writeDescriptorSets.push_back(vkinit::writeDescriptorSet(_bindlessDescriptorSet, BINDLESS_TEXTURES_BINDING,
+            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, imageInfos.data()));
+        writeDescriptorSets.back().descriptorCount = textureCount;
+    }
+
+    vkUpdateDescriptorSets(renderer._context.device, static_cast<UI32>(writeDescriptorSets.size()),
+        writeDescriptorSets.data(), 0, nullptr);
+}
+
+void GLTFModel::buildDrawRecords() {
+    // primitives without a material use the trailing default of the bindless buffer, or the first material
+    UI32 defaultMaterial = _bindless ? static_cast<UI32>(_materials.size()) : 0;
+    m_assert(defaultMaterial <= UINT16_MAX, "Model has too many materials for a draw key");
+    m_assert(_bindless || !_materials.empty() || _primitives.empty(), "Model has no material to draw with!");
+
+    // pipelines are ranked in order of first use, materials of a type share theirs
+    std::vector<const PipelineRegistry::Pipeline*> pipelines;
+    auto pipelineRank = [&pipelines](const PipelineRegistry::Pipeline* pipeline) {
+        auto it = std::find(pipelines.begin(), pipelines.end(), pipeline);
+        if (it == pipelines.end()) {
+            pipelines.push_back(pipeline);
+            return static_cast<UI64>(pipelines.size() - 1);
+        }
+        return static_cast<UI64>(it - pipelines.begin());
+    };
+
+    // every primitive reads the model's vertex and index buffers, so they take no part in the key
+    _drawRecords.clear();
+    for (UI32 p = 0; p < _primitives.size(); p++) {
+        const Primitive& primitive = _primitives[p];
+        bool hasMaterial = primitive.material >= 0 && static_cast<size_t>(primitive.material) < _materials.size();
+        UI32 material = hasMaterial ? static_cast<UI32>(primitive.material) : defaultMaterial;
+        UI64 pipeline = _bindless ? 0 : pipelineRank(_materials[material]._pipeline);
+
+        DrawRecord record{};
+        record.key        = pipeline << 48 | static_cast<UI64>(material) << 32 | primitive.firstIndex;
+        record.firstIndex = primitive.firstIndex;
+        record.indexCount = primitive.indexCount;
+        record.material   = material;
+        record.primitive  = p;
+        _drawRecords.push_back(record);
+    }
+    std::sort(_drawRecords.begin(), _drawRecords.end(),
+        [](const DrawRecord& a, const DrawRecord& b) { return a.key < b.key; });
+}
+
+std::vector<IndirectDrawRecord> GLTFModel::indirectDrawRecords() const {
+    // cooked vertices are read from the mapping, which is still open
+    const Vertex* vertices = _vertices.data();
+    if (_cooked.isOpen()) {
+        UI32 count;
+        vertices = _cooked.section<Vertex>(COOKED_VERTICES, &count);
+    }
+
+    // one record per primitive rather than per merged draw, so that culling stays fine grained
+    std::vector<IndirectDrawRecord> records(_drawRecords.size());
+    JobSystem::get().parallelFor(_drawRecords.size(), [&](size_t r) {
+        const DrawRecord& record = _drawRecords[r];
+        const Primitive& primitive = _primitives[record.primitive];
+        const Vertex* first = vertices + primitive.firstVertex;
+
+        // sphere around the bounding box of the primitive's vertices
+        glm::vec3 centre = primitive.bounds.centre();
+        F32 radius = 0.0f;
+        for (UI32 v = 0; v < primitive.vertexCount; v++) {
+            radius = std::max(radius, glm::length(glm::vec3(first[v].positionU) - centre));
+        }
+
+        records[r] = { record.firstIndex, record.indexCount, record.material, 0, glm::vec4(centre, radius) };
+    });
+    return records;
+}
+
+void GLTFModel::batchDraws() {
+    // indices are absolute, a draw that starts where the last one ended with the same material is one draw. Culled
+    // primitives break runs, the records are already in key order
+    _draws.clear();
+    for (const auto& record : _drawRecords) {
+        if (!_visible[record.primitive]) {
+            continue;
+        }
+        if (!_draws.empty() && _draws.back().material == record.material &&
+            _draws.back().firstIndex + _draws.back().indexCount == record.firstIndex) {
+            _draws.back().indexCount += record.indexCount;
+            continue;
+        }
+        _draws.push_back(record);
+    }
+}
+
+bool GLTFModel::updateVisibility(const glm::mat4& clip) {
+    PROFILE_ZONE("GLTFModel::updateVisibility");
+    if (!onGpu || _indirect) {
+        return false;
+    }
+
+    _visiblePrimitives.clear();
+    _bvh.cull(Frustum::fromMatrix(clip), &_visiblePrimitives);
+
+    // the low bit holds the last cull and the next bit this one, draws are only rebuilt when a primitive enters
+    // or leaves the frustum
+    for (UI32 p : _visiblePrimitives) {
+        _visible[p] |= 2;
+    }
+    bool changed = false;
+    for (auto& visible : _visible) {
+        changed = changed || visible == 1 || visible == 2;
+        visible >>= 1;
+    }
+
+    if (changed) {
+        batchDraws();
+    }
+    return changed;
+}
+
 bool GLTFModel::cleanup(Renderer& renderer) {
     if (onGpu) {
         // destroy geometry 
         _indexBuffer.cleanupBufferData(renderer._context.device);
         _vertexBuffer.cleanupBufferData(renderer._context.device);
 
-        // destroy uniforms
-        _uniformBuffer.cleanupBufferData(renderer._context.device);
+        if (_indirect) {
+            _indirectDraws.cleanup(renderer);
+        }
+
+        // the bindless pipeline belongs to the renderer's registry
+        if (_bindless) {
+            vkFreeDescriptorSets(renderer._context.device, renderer._bindlessDescriptorPool, 1, 
+                &_bindlessDescriptorSet);
+            _materialBuffer.cleanupBufferData(renderer._context.device);
+        }
 
         // destroy material (takes care of texture descriptors, sets, pipelines)
         for (auto& material : _materials) {
@@ -360,17 +1088,18 @@ bool GLTFModel::cleanup(Renderer& renderer) {
 }
 
 
-void GLTFModel::draw(VkCommandBuffer commandBuffer) {
-    // take care of drawing all the meshes in the model
-    // TODO: batch primitives according to material
-    m_assert(_materials.size() == 1, "Only support a single material!");
-
-    // bind pipeline
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _materials.begin()->_pipeline);
+void GLTFModel::cull(VkCommandBuffer commandBuffer, UI32 slice, UI32 dynamicOffset) {
+    if (_indirect) {
+        _indirectDraws.cull(commandBuffer, slice, dynamicOffset);
+    }
+}
 
-    // bind descriptor set
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _materials.begin()->_pipelineLayout,
-        0, 1, &_materials.begin()->_descriptorSet, 0, nullptr);
+void GLTFModel::draw(VkCommandBuffer commandBuffer, UI32 slice, UI32 dynamicOffset, UI32 firstDraw,
+    UI32 drawCount) {
+    UI32 endDraw = static_cast<UI32>(std::min<UI64>(static_cast<UI64>(firstDraw) + drawCount, this->drawCount()));
+    if (firstDraw >= endDraw) {
+        return;
+    }
 
     // bind vertex buffer
     VkDeviceSize offset = 0;
@@ -379,6 +1108,41 @@ void GLTFModel::draw(VkCommandBuffer commandBuffer) {
     // bind index buffer
     vkCmdBindIndexBuffer(commandBuffer, _indexBuffer._vkBuffer, 0, VK_INDEX_TYPE_UINT32);
 
-    // draw
-    vkCmdDrawIndexed(commandBuffer, static_cast<UI32>(_indices.size()), 1, 0, 0, 0);
+    // every material is in one set, draws only pass the index of their material
+    if (_bindless) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _bindlessPipeline->pipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _bindlessPipeline->layout,
+            0, 1, &_bindlessDescriptorSet, 1, &dynamicOffset);
+    }
+
+    // the commands written by cull, however many primitives the model has
+    if (_indirect) {
+        _indirectDraws.draw(commandBuffer, slice);
+        return;
+    }
+
+    // draws are sorted by pipeline then material, state is only bound when it changes
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    UI32 boundMaterial = UINT32_MAX;
+    for (UI32 d = firstDraw; d < endDraw; d++) {
+        const DrawRecord& draw = _draws[d];
+        if (draw.material != boundMaterial) {
+            if (_bindless) {
+                vkCmdPushConstants(commandBuffer, _bindlessPipeline->layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                    sizeof(UI32), &draw.material);
+            }
+            else {
+                const Material& material = _materials[draw.material];
+                if (material._pipeline->pipeline != boundPipeline) {
+                    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, material._pipeline->pipeline);
+                    boundPipeline = material._pipeline->pipeline;
+                }
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, material._pipeline->layout,
+                    0, 1, &material._descriptorSet, 1, &dynamicOffset);
+            }
+            boundMaterial = draw.material;
+        }
+
+        vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, 0, 0);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,465 @@
+//
+// Mesh optimization function definitions
+//
+
+#include <scene/MeshOptimizer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace mesh {
+
+    //-Vertex cache----------------------------------------------------------------------------------------------//
+
+    namespace {
+        // scoring constants from https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+        const F32 CACHE_DECAY_POWER   = 1.5f;
+        const F32 LAST_TRIANGLE_SCORE = 0.75f;
+        const F32 VALENCE_BOOST_SCALE = 2.0f;
+        const F32 VALENCE_BOOST_POWER = 0.5f;
+
+        // valences above this use the formula instead of the table
+        const UI32 VALENCE_TABLE_SIZE = 32;
+
+        struct ScoreTables {
+            F32 cache[VERTEX_CACHE_SIZE];
+            F32 valence[VALENCE_TABLE_SIZE];
+
+            ScoreTables() {
+                for (UI32 i = 0; i < VERTEX_CACHE_SIZE; i++) {
+                    // the last triangle's vertices get a fixed score so the same triangle isn't favoured twice
+                    cache[i] = i < 3 ? LAST_TRIANGLE_SCORE :
+                        std::pow(1.0f - (i - 3) / static_cast<F32>(VERTEX_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+                }
+                for (UI32 i = 0; i < VALENCE_TABLE_SIZE; i++) {
+                    valence[i] = i == 0 ? 0.0f : VALENCE_BOOST_SCALE * std::pow(static_cast<F32>(i), -VALENCE_BOOST_POWER);
+                }
+            }
+
+            // score of a vertex at a position in the cache (-1 when not cached) with triangles left to emit
+            inline F32 score(I32 cachePosition, UI32 remaining) const {
+                if (remaining == 0) {
+                    return -1.0f;
+                }
+                F32 valenceScore = remaining < VALENCE_TABLE_SIZE ? valence[remaining] :
+                    VALENCE_BOOST_SCALE * std::pow(static_cast<F32>(remaining), -VALENCE_BOOST_POWER);
+                return (cachePosition >= 0 ? cache[cachePosition] : 0.0f) + valenceScore;
+            }
+        };
+
+        // triangles using each vertex, packed per vertex: vertex v's triangles are
+        // adjacency[offsets[v], offsets[v] + counts[v])
+        void buildAdjacency(const UI32* indices, size_t triangleCount, size_t vertexCount, std::vector<UI32>* pCounts,
+            std::vector<UI32>* pOffsets, std::vector<UI32>* pAdjacency) {
+            pCounts->assign(vertexCount, 0);
+            for (size_t i = 0; i < triangleCount * 3; i++) {
+                (*pCounts)[indices[i]]++;
+            }
+
+            pOffsets->assign(vertexCount + 1, 0);
+            for (size_t v = 0; v < vertexCount; v++) {
+                (*pOffsets)[v + 1] = (*pOffsets)[v] + (*pCounts)[v];
+            }
+
+            pAdjacency->resize(triangleCount * 3);
+            std::vector<UI32> fill(pOffsets->begin(), pOffsets->end() - 1);
+            for (size_t t = 0; t < triangleCount; t++) {
+                for (size_t k = 0; k < 3; k++) {
+                    (*pAdjacency)[fill[indices[t * 3 + k]]++] = static_cast<UI32>(t);
+                }
+            }
+        }
+
+        // a FIFO post-transform cache, entries are stamped when transformed and fall out once cacheSize
+        // other vertices have been transformed since
+        class FifoCache {
+        public:
+            FifoCache(size_t vertexCount, UI32 cacheSize) :
+                _timestamps(vertexCount, 0), _time(cacheSize + 1), _cacheSize(cacheSize) {}
+
+            inline bool contains(UI32 v) const { return _time - _timestamps[v] <= _cacheSize; }
+
+            // returns the number of vertices transformed
+            inline UI32 transform(const UI32* triangle) {
+                UI32 misses = 0;
+                for (UI32 k = 0; k < 3; k++) {
+                    if (!contains(triangle[k])) {
+                        _timestamps[triangle[k]] = _time++;
+                        misses++;
+                    }
+                }
+                return misses;
+            }
+
+            inline void flush() { _time += _cacheSize + 1; }
+
+        private:
+            std::vector<UI32> _timestamps;
+            UI32              _time;
+            UI32              _cacheSize;
+        };
+    }
+
+    void optimizeVertexCache(UI32* indices, size_t indexCount, size_t vertexCount) {
+        static const ScoreTables tables;
+
+        size_t triangleCount = indexCount / 3;
+        if (triangleCount < 2) {
+            return;
+        }
+
+        std::vector<UI32> remaining, adjacencyOffsets, adjacency;
+        buildAdjacency(indices, triangleCount, vertexCount, &remaining, &adjacencyOffsets, &adjacency);
+
+        std::vector<I32> cachePosition(vertexCount, -1);
+        std::vector<F32> vertexScores(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            vertexScores[v] = tables.score(-1, remaining[v]);
+        }
+
+        std::vector<F32> triangleScores(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        for (size_t t = 0; t < triangleCount; t++) {
+            triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] +
+                vertexScores[indices[t * 3 + 2]];
+        }
+
+        // the cache holds 3 extra entries so that vertices pushed out by a triangle still get their scores updated
+        UI32 cache[VERTEX_CACHE_SIZE + 3];
+        UI32 cacheCount = 0;
+
+        std::vector<UI32> output(triangleCount * 3);
+        size_t cursor = 0; // first triangle that may not have been emitted yet
+        I64 best = -1;
+
+        for (size_t i = 0; i < triangleCount; i++) {
+            if (best < 0) {
+                // nothing left around the cache, start again from the next unused triangle
+                while (emitted[cursor]) {
+                    cursor++;
+                }
+                best = static_cast<I64>(cursor);
+            }
+
+            const UI32* triangle = &indices[best * 3];
+            std::memcpy(&output[i * 3], triangle, 3 * sizeof(UI32));
+            emitted[best] = true;
+
+            // remove the triangle from its vertices' lists
+            for (UI32 k = 0; k < 3; k++) {
+                UI32 v = triangle[k];
+                UI32* begin = &adjacency[adjacencyOffsets[v]];
+                UI32* end = begin + remaining[v];
+                for (UI32* t = begin; t < end; t++) {
+                    if (*t == static_cast<UI32>(best)) {
+                        *t = *(end - 1);
+                        break;
+                    }
+                }
+                remaining[v]--;
+            }
+
+            // move the triangle's vertices to the front of the cache
+            UI32 newCache[VERTEX_CACHE_SIZE + 3] = { triangle[0], triangle[1], triangle[2] };
+            UI32 newCount = 3;
+            for (UI32 c = 0; c < cacheCount; c++) {
+                UI32 v = cache[c];
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                    if (newCount < VERTEX_CACHE_SIZE + 3) {
+                        newCache[newCount++] = v;
+                    }
+                    else {
+                        cachePosition[v] = -1;
+                    }
+                }
+            }
+
+            // rescore the cached vertices and propagate the change to the triangles that still use them
+            for (UI32 c = 0; c < newCount; c++) {
+                UI32 v = newCache[c];
+                cachePosition[v] = c < VERTEX_CACHE_SIZE ? static_cast<I32>(c) : -1;
+                F32 score = tables.score(cachePosition[v], remaining[v]);
+                F32 delta = score - vertexScores[v];
+                vertexScores[v] = score;
+                for (UI32 a = adjacencyOffsets[v]; a < adjacencyOffsets[v] + remaining[v]; a++) {
+                    triangleScores[adjacency[a]] += delta;
+                }
+            }
+
+            // the next triangle is the best one touching the cache
+            best = -1;
+            F32 bestScore = -1.0f;
+            for (UI32 c = 0; c < newCount; c++) {
+                UI32 v = newCache[c];
+                for (UI32 a = adjacencyOffsets[v]; a < adjacencyOffsets[v] + remaining[v]; a++) {
+                    UI32 t = adjacency[a];
+                    if (triangleScores[t] > bestScore) {
+                        bestScore = triangleScores[t];
+                        best = t;
+                    }
+                }
+            }
+
+            std::memcpy(cache, newCache, newCount * sizeof(UI32));
+            cacheCount = newCount;
+        }
+
+        std::memcpy(indices, output.data(), output.size() * sizeof(UI32));
+    }
+
+    void tipsify(UI32* indices, size_t indexCount, size_t vertexCount, UI32 cacheSize,
+        std::vector<UI32>* pClusters) {
+        if (pClusters) {
+            pClusters->clear();
+        }
+
+        size_t triangleCount = indexCount / 3;
+        if (triangleCount == 0) {
+            return;
+        }
+
+        std::vector<UI32> live, adjacencyOffsets, adjacency;
+        buildAdjacency(indices, triangleCount, vertexCount, &live, &adjacencyOffsets, &adjacency);
+
+        // timestamps of when each vertex last entered the cache, the cache is initially empty
+        std::vector<UI32> timestamps(vertexCount, 0);
+        UI32 time = cacheSize + 1;
+
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<UI32> deadEnds; // recently used vertices, to continue from when a fan runs out
+        std::vector<UI32> candidates;
+        std::vector<UI32> output;
+        output.reserve(triangleCount * 3);
+        size_t cursor = 0;
+
+        // next vertex with triangles left, from the dead end stack first and then in input order
+        auto skipDeadEnd = [&]() -> I64 {
+            while (!deadEnds.empty()) {
+                UI32 v = deadEnds.back();
+                deadEnds.pop_back();
+                if (live[v] > 0) {
+                    return v;
+                }
+            }
+            while (cursor < vertexCount) {
+                if (live[cursor] > 0) {
+                    return static_cast<I64>(cursor++);
+                }
+                cursor++;
+            }
+            return -1;
+        };
+
+        I64 fanning = skipDeadEnd();
+        if (pClusters && fanning >= 0) {
+            pClusters->push_back(0);
+        }
+
+        while (fanning >= 0) {
+            // emit every remaining triangle around the fanning vertex
+            candidates.clear();
+            for (UI32 a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; a++) {
+                UI32 t = adjacency[a];
+                if (emitted[t]) {
+                    continue;
+                }
+                for (UI32 k = 0; k < 3; k++) {
+                    UI32 v = indices[t * 3 + k];
+                    output.push_back(v);
+                    deadEnds.push_back(v);
+                    candidates.push_back(v);
+                    live[v]--;
+                    if (time - timestamps[v] > cacheSize) {
+                        timestamps[v] = time++;
+                    }
+                }
+                emitted[t] = true;
+            }
+
+            // fan next around the oldest candidate that will still be cached once its own triangles are emitted
+            I64 next = -1;
+            I64 bestPriority = -1;
+            for (UI32 v : candidates) {
+                if (live[v] == 0) {
+                    continue;
+                }
+                I64 priority = 0;
+                if (time - timestamps[v] + 2 * live[v] <= cacheSize) {
+                    priority = time - timestamps[v];
+                }
+                if (priority > bestPriority) {
+                    bestPriority = priority;
+                    next = v;
+                }
+            }
+
+            if (next < 0) {
+                next = skipDeadEnd();
+                // fanning restarts from a vertex that is no longer cached
+                if (pClusters && next >= 0 && time - timestamps[next] > cacheSize) {
+                    pClusters->push_back(static_cast<UI32>(output.size() / 3));
+                }
+            }
+            fanning = next;
+        }
+
+        std::memcpy(indices, output.data(), output.size() * sizeof(UI32));
+    }
+
+    //-Overdraw--------------------------------------------------------------------------------------------------//
+
+    void optimizeOverdraw(UI32* indices, size_t indexCount, const F32* positions, size_t positionStride,
+        const std::vector<UI32>& clusters, UI32 cacheSize, F32 threshold) {
+        size_t triangleCount = indexCount / 3;
+        if (triangleCount == 0 || clusters.empty()) {
+            return;
+        }
+
+        size_t vertexCount = *std::max_element(indices, indices + triangleCount * 3) + 1;
+        auto position = [&](UI32 v) {
+            return reinterpret_cast<const F32*>(reinterpret_cast<const UC*>(positions) + v * positionStride);
+        };
+
+        // split each cluster wherever the triangles since the last split have amortised their cache misses back
+        // down to the cluster's own ratio, each piece is simulated from an empty cache as it may be drawn after
+        // any other
+        std::vector<UI32> splits;
+        FifoCache cache(vertexCount, cacheSize);
+        for (size_t c = 0; c < clusters.size(); c++) {
+            UI32 begin = clusters[c];
+            UI32 end = c + 1 < clusters.size() ? clusters[c + 1] : static_cast<UI32>(triangleCount);
+
+            cache.flush();
+            UI32 clusterMisses = 0;
+            for (UI32 t = begin; t < end; t++) {
+                clusterMisses += cache.transform(&indices[t * 3]);
+            }
+            F32 maxAcmr = threshold * clusterMisses / (end - begin);
+
+            cache.flush();
+            splits.push_back(begin);
+            UI32 misses = 0;
+            UI32 triangles = 0;
+            for (UI32 t = begin; t < end; t++) {
+                misses += cache.transform(&indices[t * 3]);
+                triangles++;
+                if (t + 1 < end && misses <= maxAcmr * triangles) {
+                    splits.push_back(t + 1);
+                    cache.flush();
+                    misses = 0;
+                    triangles = 0;
+                }
+            }
+        }
+
+        // area weighted centroid and normal of each cluster, and of the whole mesh
+        struct Cluster {
+            UI32 begin;
+            UI32 end;
+            F32  sortKey;
+        };
+
+        std::vector<F32> clusterData(splits.size() * 7, 0.0f); // centroid * area, area, normal * area
+        F32 meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+        F32 meshArea = 0.0f;
+        for (size_t c = 0; c < splits.size(); c++) {
+            UI32 end = c + 1 < splits.size() ? splits[c + 1] : static_cast<UI32>(triangleCount);
+            F32* data = &clusterData[c * 7];
+            for (UI32 t = splits[c]; t < end; t++) {
+                const F32* p0 = position(indices[t * 3]);
+                const F32* p1 = position(indices[t * 3 + 1]);
+                const F32* p2 = position(indices[t * 3 + 2]);
+                F32 e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+                F32 e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+                F32 normal[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+                F32 area = 0.5f * std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+                for (UI32 i = 0; i < 3; i++) {
+                    F32 centroid = (p0[i] + p1[i] + p2[i]) / 3.0f;
+                    data[i] += centroid * area;
+                    meshCentroid[i] += centroid * area;
+                    data[4 + i] += normal[i]; // the cross product's length is already proportional to the area
+                }
+                data[3] += area;
+                meshArea += area;
+            }
+        }
+
+        if (meshArea > 0.0f) {
+            for (UI32 i = 0; i < 3; i++) {
+                meshCentroid[i] /= meshArea;
+            }
+        }
+
+        // clusters facing away from the centre are on the outside of the mesh and occlude the rest
+        std::vector<Cluster> sorted(splits.size());
+        for (size_t c = 0; c < splits.size(); c++) {
+            const F32* data = &clusterData[c * 7];
+            sorted[c].begin = splits[c];
+            sorted[c].end = c + 1 < splits.size() ? splits[c + 1] : static_cast<UI32>(triangleCount);
+            sorted[c].sortKey = 0.0f;
+
+            F32 normalLength = std::sqrt(data[4] * data[4] + data[5] * data[5] + data[6] * data[6]);
+            if (data[3] > 0.0f && normalLength > 0.0f) {
+                for (UI32 i = 0; i < 3; i++) {
+                    sorted[c].sortKey += (data[i] / data[3] - meshCentroid[i]) * data[4 + i] / normalLength;
+                }
+            }
+        }
+
+        std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) {
+            return a.sortKey > b.sortKey;
+        });
+
+        std::vector<UI32> output;
+        output.reserve(triangleCount * 3);
+        for (const auto& cluster : sorted) {
+            output.insert(output.end(), indices + cluster.begin * 3, indices + cluster.end * 3);
+        }
+        std::memcpy(indices, output.data(), output.size() * sizeof(UI32));
+    }
+
+    //-Vertex fetch----------------------------------------------------------------------------------------------//
+
+    void optimizeVertexFetchRemap(UI32* remap, UI32* indices, size_t indexCount, size_t vertexCount) {
+        const UI32 UNUSED = ~0u;
+        std::fill(remap, remap + vertexCount, UNUSED);
+
+        UI32 next = 0;
+        for (size_t i = 0; i < indexCount; i++) {
+            UI32& v = indices[i];
+            if (remap[v] == UNUSED) {
+                remap[v] = next++;
+            }
+            v = remap[v];
+        }
+
+        for (size_t v = 0; v < vertexCount; v++) {
+            if (remap[v] == UNUSED) {
+                remap[v] = next++;
+            }
+        }
+    }
+
+    //-Analysis--------------------------------------------------------------------------------------------------//
+
+    VertexCacheStats simulateVertexCache(const UI32* indices, size_t indexCount, size_t vertexCount,
+        UI32 cacheSize) {
+        VertexCacheStats stats;
+        stats.triangles = indexCount / 3;
+
+        FifoCache cache(vertexCount, cacheSize);
+        std::vector<bool> referenced(vertexCount, false);
+        for (size_t t = 0; t < stats.triangles; t++) {
+            stats.transformedVertices += cache.transform(&indices[t * 3]);
+            for (UI32 k = 0; k < 3; k++) {
+                if (!referenced[indices[t * 3 + k]]) {
+                    referenced[indices[t * 3 + k]] = true;
+                    stats.vertices++;
+                }
+            }
+        }
+        return stats;
+    }
+}
@@ -7,8 +7,13 @@
 #include <array>
 #include <string> // string class
 #include <iostream>
+#include <unordered_map>
+#include <cstdlib>
 
 #include <scene/Model.h> // model class declaration
+#include <scene/MeshOptimizer.h>
+
+#include <app/AppConstants.h>
 
 #include <common/utils.h>
 #include <common/Assert.h>
@@ -28,10 +33,33 @@
 #include <glm/gtc/type_ptr.hpp> // construct vec from ptr
 #include <glm/gtx/string_cast.hpp>
 
+namespace {
+    // an obj face corner, indexing the position, normal and uv arrays separately
+    struct ObjIndex {
+        int position;
+        int normal;
+        int texcoord;
+
+        inline bool operator==(const ObjIndex& other) const {
+            return position == other.position && normal == other.normal && texcoord == other.texcoord;
+        }
+    };
+
+    struct ObjIndexHash {
+        inline size_t operator()(const ObjIndex& index) const {
+            size_t hash = std::hash<int>()(index.position);
+            hash ^= std::hash<int>()(index.normal) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            hash ^= std::hash<int>()(index.texcoord) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            return hash;
+        }
+    };
+}
+
 void Model::loadModel(const std::string& path) {
     FileExtension ext = getExtension(path);
     switch (ext) {
     case FileExtension::GLTF:
+    case FileExtension::GLB:
         loadGltfModel(path);
         return;
     case FileExtension::OBJ:
@@ -53,36 +81,55 @@ void Model::loadObjModel(const std::string& path) {
         throw std::runtime_error(warn + err);
     }
 
-    // combine all the shapes into a single model
+    // combine all the shapes into a single model, corners sharing a position, normal and uv tuple share a vertex
+    std::unordered_map<ObjIndex, uint32_t, ObjIndexHash> uniqueVertices;
+    size_t cornerCount = 0;
     for (const auto& shape : shapes) {
-        for (const auto& index : shape.mesh.indices) {
-            Vertex vertex{};
-
-            // set vertex data
-            vertex.positionU = {
-                attrib.vertices[3 * index.vertex_index + 0],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2],
-                attrib.texcoords[2 * index.texcoord_index + 0]
-
-            };
-
-            vertex.normalV = {
-                attrib.normals[3 * index.normal_index + 0],
-                attrib.normals[3 * index.normal_index + 1],
-                attrib.normals[3 * index.normal_index + 2],
-                1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-            };
-
-            // add to the centre of gravity
-            centre += glm::vec3(vertex.positionU);
+        cornerCount += shape.mesh.indices.size();
+    }
+    uniqueVertices.reserve(cornerCount);
+    indices.reserve(cornerCount);
 
-            vertices.push_back(vertex);
-            indices.push_back(static_cast<uint32_t>(indices.size()));
+    for (const auto& shape : shapes) {
+        for (const auto& index : shape.mesh.indices) {
+            auto unique = uniqueVertices.emplace(ObjIndex{ index.vertex_index, index.normal_index, index.texcoord_index },
+                static_cast<uint32_t>(vertices.size()));
+            if (unique.second) {
+                Vertex vertex{};
+
+                // set vertex data
+                vertex.positionU = {
+                    attrib.vertices[3 * index.vertex_index + 0],
+                    attrib.vertices[3 * index.vertex_index + 1],
+                    attrib.vertices[3 * index.vertex_index + 2],
+                    attrib.texcoords[2 * index.texcoord_index + 0]
+
+                };
+
+                vertex.normalV = {
+                    attrib.normals[3 * index.normal_index + 0],
+                    attrib.normals[3 * index.normal_index + 1],
+                    attrib.normals[3 * index.normal_index + 2],
+                    1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
+                };
+
+                // add to the centre of gravity
+                centre += glm::vec3(vertex.positionU);
+
+                vertices.push_back(vertex);
+            }
+            indices.push_back(unique.first->second);
         }
     }
     // now compute the centre by dividing by the number of vertices in the model
     centre /= (float)vertices.size();
+
+    // shared vertices are only reused if they are still in the post-transform cache
+    mesh::optimizeVertexCache(indices.data(), indices.size(), vertices.size());
+
+    if (std::getenv(PRINT_STATS_VARIABLE)) {
+        print("Welded %s: %zu vertices before, %zu after\n", path.c_str(), cornerCount, vertices.size());
+    }
 }
 
 void Model::loadGltfModel(const std::string& path) {
@@ -92,7 +139,12 @@ void Model::loadGltfModel(const std::string& path) {
     std::string warn;
 
     // parse the gltf file
-    loadStatus = loader.LoadASCIIFromFile(&model, &err, &warn, path);
+    if (getExtension(path) == FileExtension::GLB) {
+        loadStatus = loader.LoadBinaryFromFile(&model, &err, &warn, path);
+    }
+    else {
+        loadStatus = loader.LoadASCIIFromFile(&model, &err, &warn, path);
+    }
 
     if (!warn.empty()) {
         std::cout << warn;
@@ -120,6 +172,8 @@ Model::FileExtension Model::getExtension(const std::string& path) {
         return FileExtension::OBJ;
     else if (extension == "gltf")
         return FileExtension::GLTF;
+    else if (extension == "glb")
+        return FileExtension::GLB;
     throw std::runtime_error("Unsupported extension!");
 }
 
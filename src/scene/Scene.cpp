@@ -3,3 +3,149 @@
 //
 
 #include <scene/Scene.h>
+
+#include <common/Assert.h>
+
+#include <algorithm>
+
+//-Building the graph----------------------------------------------------------------------------------------------//
+
+UI32 Scene::addNode(const Transform& local, UI32 parent) {
+    // appending keeps parents before their children
+    m_assert(parent == SCENE_NO_PARENT || parent < nodeCount(), "Parent must be added before its children");
+
+    UI32 node = nodeCount();
+    _parents.push_back(parent);
+    _positions.push_back(local.position);
+    _rotations.push_back(local.rotation);
+    _scales.push_back(local.scale);
+    _locals.push_back(glm::mat4(1.0f));
+    _worlds.push_back(glm::mat4(1.0f));
+    _dirty.push_back(0);
+    markDirty(node);
+    return node;
+}
+
+void Scene::addGltfNodes(const tinygltf::Model& model, UI32 parent, std::vector<UI32>* pNodes) {
+    std::vector<UI32> nodes(model.nodes.size(), SCENE_NO_PARENT);
+
+    // roots of the default scene, or every node that is nobody's child when the file has no scene
+    std::vector<I32> roots;
+    if (!model.scenes.empty()) {
+        roots = model.scenes[model.defaultScene >= 0 ? model.defaultScene : 0].nodes;
+    }
+    else {
+        std::vector<bool> isChild(model.nodes.size(), false);
+        for (const auto& node : model.nodes) {
+            for (I32 child : node.children) {
+                isChild[child] = true;
+            }
+        }
+        for (I32 n = 0; n < static_cast<I32>(model.nodes.size()); n++) {
+            if (!isChild[n]) {
+                roots.push_back(n);
+            }
+        }
+    }
+
+    // depth first, so every node is appended after its parent
+    for (I32 root : roots) {
+        addGltfNode(model, root, parent, nodes);
+    }
+
+    if (pNodes) {
+        *pNodes = std::move(nodes);
+    }
+}
+
+UI32 Scene::addGltfNode(const tinygltf::Model& model, I32 gltfNode, UI32 parent, std::vector<UI32>& nodes) {
+    const tinygltf::Node& node = model.nodes[gltfNode];
+
+    Transform local;
+    if (node.matrix.size() == 16) {
+        // columns of the matrix hold the scaled axes of the rotation, glTF forbids skew
+        glm::mat4 matrix;
+        for (UI32 i = 0; i < 16; i++) {
+            matrix[i / 4][i % 4] = static_cast<F32>(node.matrix[i]);
+        }
+        local.position = glm::vec3(matrix[3]);
+        local.scale = glm::vec3(glm::length(glm::vec3(matrix[0])), glm::length(glm::vec3(matrix[1])),
+            glm::length(glm::vec3(matrix[2])));
+        local.rotation = glm::quat_cast(glm::mat3(glm::vec3(matrix[0]) / local.scale.x,
+            glm::vec3(matrix[1]) / local.scale.y, glm::vec3(matrix[2]) / local.scale.z));
+    }
+    else {
+        if (node.translation.size() == 3) {
+            local.position = glm::vec3(node.translation[0], node.translation[1], node.translation[2]);
+        }
+        if (node.rotation.size() == 4) {
+            // glTF stores x, y, z, w
+            local.rotation = glm::quat(static_cast<F32>(node.rotation[3]), static_cast<F32>(node.rotation[0]),
+                static_cast<F32>(node.rotation[1]), static_cast<F32>(node.rotation[2]));
+        }
+        if (node.scale.size() == 3) {
+            local.scale = glm::vec3(node.scale[0], node.scale[1], node.scale[2]);
+        }
+    }
+
+    UI32 sceneNode = addNode(local, parent);
+    nodes[gltfNode] = sceneNode;
+    for (I32 child : node.children) {
+        addGltfNode(model, child, sceneNode, nodes);
+    }
+    return sceneNode;
+}
+
+void Scene::clear() {
+    _parents.clear();
+    _positions.clear();
+    _rotations.clear();
+    _scales.clear();
+    _locals.clear();
+    _worlds.clear();
+    _dirty.clear();
+    _firstDirty = UINT32_MAX;
+}
+
+//-Transforms------------------------------------------------------------------------------------------------------//
+
+void Scene::setLocal(UI32 node, const Transform& local) {
+    _positions[node] = local.position;
+    _rotations[node] = local.rotation;
+    _scales[node] = local.scale;
+    markDirty(node);
+}
+
+Transform Scene::local(UI32 node) const {
+    return Transform(_positions[node], _rotations[node], _scales[node]);
+}
+
+void Scene::markDirty(UI32 node) {
+    _dirty[node] |= LOCAL_DIRTY | WORLD_DIRTY;
+    _firstDirty = std::min(_firstDirty, node);
+}
+
+void Scene::updateWorldTransforms() {
+    // parents come first, so a parent's flags and world matrix are final by the time its children are reached.
+    // Nothing before the first dirty node can change
+    for (UI32 node = _firstDirty; node < nodeCount(); node++) {
+        UI32 parent = _parents[node];
+        if (parent != SCENE_NO_PARENT && (_dirty[parent] & WORLD_DIRTY)) {
+            _dirty[node] |= WORLD_DIRTY;
+        }
+        if (!_dirty[node]) {
+            continue;
+        }
+
+        if (_dirty[node] & LOCAL_DIRTY) {
+            _locals[node] = Transform(_positions[node], _rotations[node], _scales[node]).matrix();
+        }
+        _worlds[node] = parent == SCENE_NO_PARENT ? _locals[node] : _worlds[parent] * _locals[node];
+    }
+
+    // flags are cleared once every child has read its parent's
+    if (_firstDirty < nodeCount()) {
+        std::fill(_dirty.begin() + _firstDirty, _dirty.end(), 0);
+    }
+    _firstDirty = UINT32_MAX;
+}
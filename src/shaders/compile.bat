@@ -1,9 +1,19 @@
 C:/VulkanSDK/1.2.162.1/Bin/glslangValidator.exe -V -o offscreen_pbr.vert.spv offscreen_pbr.vert
 
+C:/VulkanSDK/1.2.162.1/Bin/glslangValidator.exe -V -o offscreen_pbr_compact.vert.spv offscreen_pbr_compact.vert
+
 C:/VulkanSDK/1.2.162.1/Bin/glslangValidator.exe -V -o offscreen_pbr.frag.spv offscreen_pbr.frag
 
 C:/VulkanSDK/1.2.162.1/Bin/glslangValidator.exe -V -o offscreen_pbr_normal.frag.spv offscreen_pbr_normal.frag
 
+C:/VulkanSDK/1.2.162.1/Bin/glslangValidator.exe -V -o offscreen_bindless.frag.spv offscreen_bindless.frag
+
+C:/VulkanSDK/1.2.162.1/Bin/glslangValidator.exe -V -o offscreen_indirect.vert.spv offscreen_indirect.vert
+
+C:/VulkanSDK/1.2.162.1/Bin/glslangValidator.exe -V -o offscreen_indirect.frag.spv offscreen_indirect.frag
+
+C:/VulkanSDK/1.2.162.1/Bin/glslangValidator.exe -V -o cull.comp.spv cull.comp
+
 C:/VulkanSDK/1.2.162.1/Bin/glslangValidator.exe -V -o composition.vert.spv composition.vert
 
 C:/VulkanSDK/1.2.162.1/Bin/glslangValidator.exe -V -o composition.frag.spv composition.frag
@@ -0,0 +1,30 @@
+#!/bin/sh
+# same as compile.bat, with the glslangValidator of the vulkan sdk on the path or in $VULKAN_SDK/bin
+cd "$(dirname "$0")" || exit 1
+GLSLANG="glslangValidator"
+if [ -n "$VULKAN_SDK" ]; then
+    GLSLANG="$VULKAN_SDK/bin/glslangValidator"
+fi
+
+for shader in \
+    offscreen_pbr.vert \
+    offscreen_pbr_compact.vert \
+    offscreen_pbr.frag \
+    offscreen_pbr_normal.frag \
+    offscreen_bindless.frag \
+    offscreen_indirect.vert \
+    offscreen_indirect.frag \
+    cull.comp \
+    composition.vert \
+    composition.frag \
+    composition_debug.vert \
+    composition_debug.frag \
+    forward.vert \
+    forward.frag \
+    skybox.vert \
+    skybox.frag \
+    shadowmap.vert \
+    shadowmap.frag
+do
+    "$GLSLANG" -V -o "$shader.spv" "$shader" || exit 1
+done
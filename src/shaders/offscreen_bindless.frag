@@ -0,0 +1,73 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+//
+// fragment shader for deferred rendering offscreen stage, every material of a model in one descriptor set
+//
+
+struct Material {
+	int albedoTexture; // indices into the texture array, -1 if the material has no such texture
+	int metallicRoughnessTexture;
+	int normalTexture;
+	int padding;
+};
+
+layout (binding = 1, std430) readonly buffer MaterialBuffer {
+	Material materials[];
+};
+
+// textures of every material, sized to the model
+layout (binding = 2) uniform sampler2D textures[];
+
+// material of the primitive being drawn
+layout (push_constant) uniform PushConstants {
+	uint material;
+} pushConstants;
+
+// input from previous stage
+layout(location = 0) in vec3 fragPos;
+layout(location = 1) in vec3 fragNormal;
+layout(location = 2) in vec4 fragTangent;
+layout(location = 3) in vec2 fragTexCoord;
+
+layout (location = 0) out vec4 outPosition;
+layout (location = 1) out vec4 outNormal;
+layout (location = 2) out vec4 outAlbedo;
+layout (location = 3) out vec4 outMetallicRoughness;
+
+const float far = 20.0f;
+const float near = 0.1;
+
+// compute linear depth
+// https://learnopengl.com/Advanced-OpenGL/Depth-testing
+float linearize_Z(float z , float zNear , float zFar){
+	return (2 * zNear * zFar) / (zFar + zNear - (z * 2.0f  - 1.0f) * (zFar -zNear)) ;
+}
+
+void main() 
+{
+	// the index comes from a push constant so it is uniform across the draw
+	Material material = materials[pushConstants.material];
+
+	// 1: position
+	outPosition = vec4(fragPos, linearize_Z(gl_FragCoord.z, near, far) / far);
+
+	// 2: normal
+	vec3 normal = fragNormal;
+	if (material.normalTexture >= 0) {
+		// https://github.com/KhronosGroup/glTF/blob/master/specification/2.0/README.md#tangent-space-definition
+		mat3 TBN = mat3(fragNormal, cross(fragNormal, fragTangent.xyz) * fragTangent.w, fragNormal);
+		normal = normalize(TBN * ((texture(textures[material.normalTexture], fragTexCoord).rgb) * 2.0f - vec3(1.0f)));
+	}
+	normal.y *= -1; // vulkan inverted y
+	outNormal   = vec4(normal, 1.0f);
+
+	// 3: albedo
+	vec3 albedo = material.albedoTexture >= 0 ? texture(textures[material.albedoTexture], fragTexCoord).rgb : vec3(1.0f);
+	outAlbedo   = vec4(albedo, fragTexCoord.x);
+
+	// 4: ao metallic roughness, fully rough dielectric without a texture
+	vec3 metallicRoughness = material.metallicRoughnessTexture >= 0 ?
+		texture(textures[material.metallicRoughnessTexture], fragTexCoord).rgb : vec3(1.0f, 1.0f, 0.0f);
+	outMetallicRoughness = vec4(metallicRoughness, fragTexCoord.y);
+}
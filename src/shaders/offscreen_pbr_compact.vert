@@ -0,0 +1,48 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+//
+// Vertex shader for deferred rendering offscreen stage, for meshes uploaded as CompactVertex
+// 
+
+// uniform
+layout(binding = 0, std140) uniform UniformBufferObject {
+    mat4 model;
+    mat4 viewProj;
+    vec4 positionOffset; // xyz = minimum of the mesh's bounding box
+    vec4 positionScale;  // xyz = extent of the mesh's bounding box
+} ubo;
+
+// inputs specified in the vertex buffer attributes
+layout(location = 0) in vec4 inPosition; // xyz = position in the bounding box, w = tangent handedness
+layout(location = 1) in vec2 inNormal;   // octahedral
+layout(location = 2) in vec2 inTangent;  // octahedral
+layout(location = 3) in vec2 inTexCoord;
+
+// outputs
+layout(location = 0) out vec3 fragPos;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec4 fragTangent;
+layout(location = 3) out vec2 fragTexCoord;
+
+vec3 octDecode(vec2 e) {
+	vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -t : t;
+	n.y += n.y >= 0.0f ? -t : t;
+	return normalize(n);
+}
+
+void main() {
+	vec3 position = ubo.positionOffset.xyz + inPosition.xyz * ubo.positionScale.xyz;
+	vec4 tmpPos = ubo.model * vec4(position, 1.0f);
+	gl_Position = ubo.viewProj * tmpPos;
+	// position
+	fragPos      = tmpPos.xyz;
+	// normal
+	fragNormal   = normalize(mat3(ubo.model) * octDecode(inNormal));
+	// tangent
+	fragTangent  = vec4(normalize(mat3(ubo.model) * octDecode(inTangent)), inPosition.w * 2.0f - 1.0f);
+	// texture uv
+	fragTexCoord = inTexCoord;
+}
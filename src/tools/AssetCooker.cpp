@@ -0,0 +1,215 @@
+///////////////////////////////////////////////////////
+// Asset cooker, converts models to cooked assets
+///////////////////////////////////////////////////////
+
+//
+// Usage: AssetCooker <input .gltf/.glb/.obj> <output .vrasset>
+//
+// Loads a model with the same code paths as the renderer, then writes its vertices, indices, primitives,
+// materials and textures (with a box filtered mip chain) to a cooked asset that the renderer maps and
+// uploads without any further processing.
+//
+// Build, from the repository root: it links the renderer's code, so it needs the same libraries and include
+// directories as the renderer's project (<glm>, <glfw>, <imgui>, <tinygltf>) and the ImGui sources it compiles
+//   cl /std:c++17 /O2 /EHsc /Iinclude /I%VULKAN_SDK%\Include /I<glm> /I<glfw>\include /I<imgui> /I<tinygltf>
+//      src\tools\AssetCooker.cpp src\common\*.cpp src\hpg\*.cpp src\scene\*.cpp <imgui sources>
+//      /link /LIBPATH:%VULKAN_SDK%\Lib vulkan-1.lib glfw3.lib
+//   g++ -std=c++17 -O2 -pthread -Iinclude -I<glm> -I<imgui> -I<tinygltf> src/tools/AssetCooker.cpp
+//      src/common/*.cpp src/hpg/*.cpp src/scene/*.cpp <imgui sources> -lvulkan -lglfw -o AssetCooker
+//
+
+#include <common/Print.h>
+#include <common/JobSystem.h>
+
+#include <scene/CookedAsset.h>
+#include <scene/GLTFModel.h>
+#include <scene/Model.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+//-Mip chain generation------------------------------------------------------------------------------------------//
+
+static F32 srgbToLinear(UC value) {
+    F32 c = value / 255.0f;
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static UC linearToSrgb(F32 value) {
+    F32 c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<UC>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+}
+
+// appends every level of an RGBA8 image to data, colour channels of sRGB images are filtered in linear space
+static CookedTexture cookTexture(const UC* pixels, UI32 width, UI32 height, VkFormat format, std::vector<UC>& data) {
+    CookedTexture texture{};
+    texture.width = width;
+    texture.height = height;
+    texture.format = format;
+    texture.offset = data.size();
+
+    F32 toLinear[256];
+    bool srgb = format == VK_FORMAT_R8G8B8A8_SRGB;
+    for (UI32 v = 0; v < 256; v++) {
+        toLinear[v] = srgb ? srgbToLinear(static_cast<UC>(v)) : v / 255.0f;
+    }
+
+    std::vector<UC> level(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    UI32 levelWidth = width;
+    UI32 levelHeight = height;
+    for (UI32 mip = 0; mip < COOKED_MAX_MIP_LEVELS; mip++) {
+        texture.mipOffsets[mip] = data.size() - texture.offset;
+        texture.mipLevels = mip + 1;
+        data.insert(data.end(), level.begin(), level.end());
+
+        if (levelWidth == 1 && levelHeight == 1) {
+            break;
+        }
+
+        // 2x2 box filter, the last row or column is reused for odd sizes
+        UI32 nextWidth = std::max(levelWidth / 2, 1u);
+        UI32 nextHeight = std::max(levelHeight / 2, 1u);
+        std::vector<UC> next(static_cast<size_t>(nextWidth) * nextHeight * 4);
+        for (UI32 y = 0; y < nextHeight; y++) {
+            for (UI32 x = 0; x < nextWidth; x++) {
+                UI32 x0 = std::min(2 * x, levelWidth - 1), x1 = std::min(2 * x + 1, levelWidth - 1);
+                UI32 y0 = std::min(2 * y, levelHeight - 1), y1 = std::min(2 * y + 1, levelHeight - 1);
+                const UC* texels[4] = {
+                    &level[(static_cast<size_t>(y0) * levelWidth + x0) * 4], &level[(static_cast<size_t>(y0) * levelWidth + x1) * 4],
+                    &level[(static_cast<size_t>(y1) * levelWidth + x0) * 4], &level[(static_cast<size_t>(y1) * levelWidth + x1) * 4]
+                };
+
+                UC* out = &next[(static_cast<size_t>(y) * nextWidth + x) * 4];
+                for (UI32 c = 0; c < 4; c++) {
+                    if (c < 3) {
+                        F32 sum = 0.0f;
+                        for (const UC* texel : texels) {
+                            sum += toLinear[texel[c]];
+                        }
+                        out[c] = srgb ? linearToSrgb(sum * 0.25f) :
+                            static_cast<UC>(std::clamp(sum * 0.25f * 255.0f + 0.5f, 0.0f, 255.0f));
+                    }
+                    else {
+                        out[c] = static_cast<UC>((texels[0][c] + texels[1][c] + texels[2][c] + texels[3][c] + 2) / 4);
+                    }
+                }
+            }
+        }
+
+        level = std::move(next);
+        levelWidth = nextWidth;
+        levelHeight = nextHeight;
+    }
+
+    texture.size = data.size() - texture.offset;
+    return texture;
+}
+
+//-Model conversion----------------------------------------------------------------------------------------------//
+
+static bool cookGltf(const std::string& path, CookedAsset::Contents& contents) {
+    GLTFModel model;
+    if (!model.load(path)) {
+        return false;
+    }
+
+    contents.vertices = std::move(model._vertices);
+    contents.indices = std::move(model._indices);
+    for (const auto& primitive : model._primitives) {
+        contents.primitives.push_back({ primitive.firstIndex, primitive.indexCount, primitive.firstVertex,
+            primitive.vertexCount, primitive.material });
+    }
+
+    // images are cooked once per format they are sampled with
+    std::map<std::pair<I32, VkFormat>, I32> cookedImages;
+    auto cookImage = [&](I32 textureIndex, VkFormat format) -> I32 {
+        if (textureIndex < 0) {
+            return -1;
+        }
+
+        I32 imageIndex = model._model.textures[textureIndex].source;
+        auto cooked = cookedImages.find({ imageIndex, format });
+        if (cooked != cookedImages.end()) {
+            return cooked->second;
+        }
+
+        const tinygltf::Image& image = model._model.images[imageIndex];
+        if (image.component != 4 || image.bits != 8) {
+            print("Skipping image %i, only RGBA8 images are cooked\n", imageIndex);
+            return -1;
+        }
+
+        I32 index = static_cast<I32>(contents.textures.size());
+        contents.textures.push_back(cookTexture(image.image.data(), static_cast<UI32>(image.width),
+            static_cast<UI32>(image.height), format, contents.textureData));
+        cookedImages[{ imageIndex, format }] = index;
+        return index;
+    };
+
+    for (const auto& material : model._model.materials) {
+        contents.materials.push_back({
+            cookImage(material.pbrMetallicRoughness.baseColorTexture.index, VK_FORMAT_R8G8B8A8_SRGB),
+            cookImage(material.pbrMetallicRoughness.metallicRoughnessTexture.index, VK_FORMAT_R8G8B8A8_UNORM),
+            cookImage(material.normalTexture.index, VK_FORMAT_R8G8B8A8_UNORM),
+            cookImage(material.emissiveTexture.index, VK_FORMAT_R8G8B8A8_SRGB)
+        });
+    }
+    return true;
+}
+
+static bool cookObj(const std::string& path, CookedAsset::Contents& contents) {
+    Model model;
+    model.loadObjModel(path);
+
+    contents.vertices = model.getObjVertices();
+    contents.indices = model.getObjIndices();
+
+    // a single untextured primitive
+    contents.primitives.push_back({ 0, static_cast<UI32>(contents.indices.size()), 0,
+        static_cast<UI32>(contents.vertices.size()), 0 });
+    contents.materials.push_back({ -1, -1, -1, -1 });
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: AssetCooker <input .gltf/.glb/.obj> <output" << COOKED_ASSET_EXTENSION << ">" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string input(argv[1]);
+    std::string output(argv[2]);
+    std::string extension = input.substr(input.find_last_of('.') + 1);
+
+    // vertices are extracted with parallel jobs
+    JobSystem::get().init();
+    CookedAsset::Contents contents;
+    bool cooked = false;
+    try {
+        cooked = extension == "obj" ? cookObj(input, contents) : cookGltf(input, contents);
+        if (!cooked) {
+            std::cerr << "Could not load " << input << std::endl;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+    JobSystem::get().cleanup();
+
+    if (!cooked) {
+        return EXIT_FAILURE;
+    }
+
+    if (!CookedAsset::write(output, contents)) {
+        return EXIT_FAILURE;
+    }
+
+    print("Cooked %s: %zu vertices, %zu indices, %zu materials, %zu textures\n", input.c_str(),
+        contents.vertices.size(), contents.indices.size(), contents.materials.size(), contents.textures.size());
+    return EXIT_SUCCESS;
+}
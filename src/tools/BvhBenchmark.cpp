@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////
+// Bvh benchmark, frustum culling of synthetic scenes
+///////////////////////////////////////////////////////
+
+//
+// Usage: BvhBenchmark [box count ...]
+//
+// Scatters boxes of random sizes through a cube around a camera, builds a bounding volume hierarchy over them
+// and culls it against the frustum of the camera turning on the spot. Reports the build time, the nodes and
+// boxes tested per cull and the cull time, next to testing every box on its own. Defaults to 10k, 100k and
+// 1M boxes.
+//
+// Build, from the repository root, with the glm of the renderer's project:
+//   cl /std:c++17 /O2 /EHsc /Iinclude /I<glm> src\tools\BvhBenchmark.cpp src\scene\Bvh.cpp
+//   g++ -std=c++17 -O2 -Iinclude -I<glm> src/tools/BvhBenchmark.cpp src/scene/Bvh.cpp -o BvhBenchmark
+//
+
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+
+#include <common/Print.h>
+
+#include <scene/Bvh.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+// views culled per scene, the camera turns a full circle over them
+const UI32 VIEW_COUNT = 64;
+
+// half the side of the cube the boxes are scattered in, and the far plane
+const F32 SCENE_EXTENT = 500.0f;
+
+static std::vector<Aabb> syntheticScene(UI32 count) {
+    std::mt19937 generator(count);
+    std::uniform_real_distribution<F32> position(-SCENE_EXTENT, SCENE_EXTENT);
+    std::uniform_real_distribution<F32> size(0.1f, 4.0f);
+
+    std::vector<Aabb> boxes(count);
+    for (auto& box : boxes) {
+        glm::vec3 centre(position(generator), position(generator), position(generator));
+        glm::vec3 extent(size(generator), size(generator), size(generator));
+        box = { centre - extent, centre + extent };
+    }
+    return boxes;
+}
+
+static F64 milliseconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<F64, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void benchmark(UI32 count) {
+    std::vector<Aabb> boxes = syntheticScene(count);
+
+    auto start = std::chrono::steady_clock::now();
+    Bvh bvh;
+    bvh.build(boxes);
+    F64 buildTime = milliseconds(start);
+
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, SCENE_EXTENT);
+    std::vector<Frustum> frustums(VIEW_COUNT);
+    for (UI32 v = 0; v < VIEW_COUNT; v++) {
+        F32 angle = glm::radians(360.0f * v / VIEW_COUNT);
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(std::sin(angle), 0.0f, std::cos(angle)),
+            glm::vec3(0.0f, 1.0f, 0.0f));
+        frustums[v] = Frustum::fromMatrix(projection * view);
+    }
+
+    // hierarchy
+    BvhCullStats stats;
+    std::vector<UI32> visible;
+    visible.reserve(count);
+    UI64 bvhVisible = 0;
+    start = std::chrono::steady_clock::now();
+    for (const auto& frustum : frustums) {
+        visible.clear();
+        bvh.cull(frustum, &visible, &stats);
+        bvhVisible += visible.size();
+    }
+    F64 bvhTime = milliseconds(start) / VIEW_COUNT;
+
+    // every box on its own
+    UI64 bruteVisible = 0;
+    start = std::chrono::steady_clock::now();
+    for (const auto& frustum : frustums) {
+        visible.clear();
+        for (UI32 i = 0; i < count; i++) {
+            if (frustum.test(boxes[i]) != FRUSTUM_OUTSIDE) {
+                visible.push_back(i);
+            }
+        }
+        bruteVisible += visible.size();
+    }
+    F64 bruteTime = milliseconds(start) / VIEW_COUNT;
+
+    print("%u boxes: %zu nodes built in %.2f ms\n", count, bvh.nodes().size(), buildTime);
+    print("  bvh:   %.3f ms per cull, %.0f nodes visited, %.0f boxes tested, %.0f visible\n", bvhTime,
+        static_cast<F64>(stats.nodesVisited) / VIEW_COUNT, static_cast<F64>(stats.boxesTested) / VIEW_COUNT,
+        static_cast<F64>(bvhVisible) / VIEW_COUNT);
+    print("  brute: %.3f ms per cull, %u boxes tested, %.0f visible (%.1fx)\n", bruteTime, count,
+        static_cast<F64>(bruteVisible) / VIEW_COUNT, bruteTime / std::max(bvhTime, 1e-6));
+
+    if (bvhVisible != bruteVisible) {
+        print("  mismatch: the hierarchy accepted %llu boxes and brute force %llu\n",
+            static_cast<unsigned long long>(bvhVisible), static_cast<unsigned long long>(bruteVisible));
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<UI32> counts = { 10000, 100000, 1000000 };
+    if (argc > 1) {
+        counts.clear();
+        for (int a = 1; a < argc; a++) {
+            counts.push_back(static_cast<UI32>(std::strtoul(argv[a], nullptr, 10)));
+        }
+    }
+
+    for (UI32 count : counts) {
+        benchmark(count);
+    }
+    return EXIT_SUCCESS;
+}
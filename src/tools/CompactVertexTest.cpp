@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////
+// CompactVertex test, encode and decode error bounds
+///////////////////////////////////////////////////////
+
+//
+// Usage: CompactVertexTest [vertex count]
+//
+// Encodes random vertices into CompactVertex and decodes them back, then checks the bounds the format
+// promises:
+//  - positions are within 1/65535 of the bounding box's extent on every axis
+//  - normals and tangents are within 0.04 degrees of the original direction
+//  - texture coordinates in [0, 1] are within 1/4096, half of a half float step just below 1
+//  - the tangent's handedness is exact
+//  - the six axis directions decode exactly
+// Prints the largest error of each and every bound that is broken. Returns EXIT_FAILURE if any is. Defaults
+// to 200k vertices.
+//
+// Build, from the repository root, with the glm of the renderer's project:
+//   cl /std:c++17 /O2 /EHsc /Iinclude /I%VULKAN_SDK%\Include /I<glm> src\tools\CompactVertexTest.cpp
+//      src\common\CompactVertex.cpp
+//   g++ -std=c++17 -O2 -Iinclude -I<glm> src/tools/CompactVertexTest.cpp src/common/CompactVertex.cpp
+//      -o CompactVertexTest
+//
+
+#include <common/CompactVertex.h>
+#include <common/Print.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+const F64 POSITION_TOLERANCE  = 1.0 / 65535.0;
+const F64 DIRECTION_TOLERANCE = 0.04;          // degrees
+const F64 TEXCOORD_TOLERANCE  = 1.0 / 4096.0;
+
+static UI32 failures = 0;
+
+static void check(bool passed, const char* what, UI64 vertex, F64 error, F64 tolerance) {
+    if (!passed) {
+        // only the first few failures, a broken encoding fails every vertex
+        if (failures < 16) {
+            print("  vertex %llu: %s error %g exceeds %g\n", static_cast<unsigned long long>(vertex), what, error,
+                tolerance);
+        }
+        failures++;
+    }
+}
+
+// angle between two directions in degrees, atan2 keeps precision for nearly parallel directions
+static F64 angleDegrees(const glm::vec3& a, const glm::vec3& b) {
+    glm::dvec3 da = glm::normalize(glm::dvec3(a));
+    glm::dvec3 db = glm::normalize(glm::dvec3(b));
+    return glm::degrees(std::atan2(glm::length(glm::cross(da, db)), glm::dot(da, db)));
+}
+
+static glm::vec3 randomDirection(std::mt19937& generator) {
+    std::normal_distribution<F32> component(0.0f, 1.0f);
+    glm::vec3 direction;
+    do {
+        direction = glm::vec3(component(generator), component(generator), component(generator));
+    } while (glm::length(direction) < 1e-3f);
+    return glm::normalize(direction);
+}
+
+static void testRandomVertices(UI32 count) {
+    std::mt19937 generator(count);
+    std::uniform_real_distribution<F32> unit(0.0f, 1.0f);
+    std::uniform_real_distribution<F32> coordinate(-50.0f, 50.0f);
+
+    // a box that is far from the origin and much longer on one axis than on the others
+    glm::vec3 centre(coordinate(generator), coordinate(generator), coordinate(generator));
+    glm::vec3 extent(100.0f, 1.0f, 0.01f);
+
+    std::vector<Vertex> vertices(count);
+    for (auto& vertex : vertices) {
+        glm::vec3 position = centre + (glm::vec3(unit(generator), unit(generator), unit(generator)) - 0.5f) * extent;
+        vertex.positionU = glm::vec4(position, unit(generator));
+        vertex.normalV = glm::vec4(randomDirection(generator), unit(generator));
+        vertex.tangent = glm::vec4(randomDirection(generator), unit(generator) < 0.5f ? -1.0f : 1.0f);
+    }
+
+    VertexQuantization quantization = CompactVertex::quantization(vertices.data(), vertices.size());
+
+    F64 maxPosition = 0.0, maxNormal = 0.0, maxTangent = 0.0, maxTexCoord = 0.0;
+    for (UI64 v = 0; v < count; v++) {
+        const Vertex& original = vertices[v];
+        Vertex decoded = CompactVertex::encode(original, quantization).decode(quantization);
+
+        for (UI32 i = 0; i < 3; i++) {
+            // relative to the extent of the box along that axis
+            F64 error = std::abs(static_cast<F64>(decoded.positionU[i]) - original.positionU[i]) /
+                quantization.scale[i];
+            maxPosition = std::max(maxPosition, error);
+            check(error <= POSITION_TOLERANCE, "position", v, error, POSITION_TOLERANCE);
+        }
+
+        F64 normalError = angleDegrees(glm::vec3(decoded.normalV), glm::vec3(original.normalV));
+        F64 tangentError = angleDegrees(glm::vec3(decoded.tangent), glm::vec3(original.tangent));
+        maxNormal = std::max(maxNormal, normalError);
+        maxTangent = std::max(maxTangent, tangentError);
+        check(normalError <= DIRECTION_TOLERANCE, "normal angle", v, normalError, DIRECTION_TOLERANCE);
+        check(tangentError <= DIRECTION_TOLERANCE, "tangent angle", v, tangentError, DIRECTION_TOLERANCE);
+
+        F64 texCoordError = std::max(std::abs(static_cast<F64>(decoded.positionU.w) - original.positionU.w),
+            std::abs(static_cast<F64>(decoded.normalV.w) - original.normalV.w));
+        maxTexCoord = std::max(maxTexCoord, texCoordError);
+        check(texCoordError <= TEXCOORD_TOLERANCE, "texture coordinate", v, texCoordError, TEXCOORD_TOLERANCE);
+
+        check(decoded.tangent.w == original.tangent.w, "handedness", v,
+            std::abs(decoded.tangent.w - original.tangent.w), 0.0);
+    }
+
+    print("%u random vertices:\n", count);
+    print("  position error  %.3g of the extent (bound %.3g)\n", maxPosition, POSITION_TOLERANCE);
+    print("  normal error    %.3g degrees (bound %.3g)\n", maxNormal, DIRECTION_TOLERANCE);
+    print("  tangent error   %.3g degrees (bound %.3g)\n", maxTangent, DIRECTION_TOLERANCE);
+    print("  texcoord error  %.3g (bound %.3g)\n", maxTexCoord, TEXCOORD_TOLERANCE);
+}
+
+static void testAxisDirections() {
+    const glm::vec3 axes[6] = {
+        {  1.0f,  0.0f,  0.0f }, { -1.0f,  0.0f,  0.0f },
+        {  0.0f,  1.0f,  0.0f }, {  0.0f, -1.0f,  0.0f },
+        {  0.0f,  0.0f,  1.0f }, {  0.0f,  0.0f, -1.0f } };
+
+    VertexQuantization quantization;
+    for (UI32 a = 0; a < 6; a++) {
+        Vertex vertex;
+        vertex.positionU = glm::vec4(0.0f);
+        vertex.normalV = glm::vec4(axes[a], 0.0f);
+        vertex.tangent = glm::vec4(axes[(a + 2) % 6], 1.0f);
+
+        Vertex decoded = CompactVertex::encode(vertex, quantization).decode(quantization);
+        bool exact = glm::vec3(decoded.normalV) == axes[a] && glm::vec3(decoded.tangent) == axes[(a + 2) % 6];
+        check(exact, "axis direction", a, angleDegrees(glm::vec3(decoded.normalV), axes[a]), 0.0);
+    }
+    print("%s\n", "6 axis directions checked");
+}
+
+int main(int argc, char* argv[]) {
+    UI32 count = argc > 1 ? static_cast<UI32>(std::strtoul(argv[1], nullptr, 10)) : 200000;
+
+    testRandomVertices(count);
+    testAxisDirections();
+
+    if (failures > 0) {
+        print("FAILED: %u bounds broken\n", failures);
+        return EXIT_FAILURE;
+    }
+    print("%s\n", "passed");
+    return EXIT_SUCCESS;
+}
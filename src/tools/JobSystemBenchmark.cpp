@@ -0,0 +1,190 @@
+///////////////////////////////////////////////////////
+// Job system benchmark, scheduling overhead and scaling
+///////////////////////////////////////////////////////
+
+//
+// Usage: JobSystemBenchmark [max thread count]
+//
+// Restarts the job system with 1, 2, 4... threads up to the core count and measures, for each:
+//  - the cost of queueing and running an empty job, from one thread and from jobs queueing jobs
+//  - the cost per index of a parallel for over trivial work
+//  - the time of a parallel for over compute bound work, and its speedup over one thread
+//  - the latency of a chain of jobs that each depend on the previous one
+//  - the time of two stages of compute bound jobs where the second depends on the first, checking that no job
+//    of the second stage starts early
+// Returns EXIT_FAILURE if one did.
+//
+// Build, from the repository root:
+//   cl /std:c++17 /O2 /EHsc /Iinclude src\tools\JobSystemBenchmark.cpp src\common\JobSystem.cpp
+//      src\common\Profiler.cpp
+//   g++ -std=c++17 -O2 -pthread -Iinclude src/tools/JobSystemBenchmark.cpp src/common/JobSystem.cpp
+//      src/common/Profiler.cpp -o JobSystemBenchmark
+//
+
+#include <common/Print.h>
+#include <common/JobSystem.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+// empty jobs are queued in batches that fit in a thread's job ring
+const UI32 EMPTY_JOB_COUNT = 256 * 1024;
+const UI32 EMPTY_JOB_BATCH = 1024;
+
+const UI32 TRIVIAL_FOR_COUNT = 4 * 1024 * 1024;
+
+// items of compute bound work and iterations per item
+const UI32 WORK_ITEM_COUNT = 4096;
+const UI32 WORK_ITERATIONS = 4096;
+
+const UI32 CHAIN_LENGTH = 256;
+
+// jobs of each dependent stage
+const UI32 STAGE_JOB_COUNT = 1024;
+
+using Clock = std::chrono::steady_clock;
+
+static F64 nanoseconds(Clock::time_point start) {
+    return std::chrono::duration<F64, std::nano>(Clock::now() - start).count();
+}
+
+// keeps results alive so that the work is not optimised away
+static volatile F64 g_sink;
+
+static F64 emptyJobs(JobSystem& jobs) {
+    Clock::time_point start = Clock::now();
+    for (UI32 batch = 0; batch < EMPTY_JOB_COUNT; batch += EMPTY_JOB_BATCH) {
+        JobCounter counter;
+        for (UI32 j = 0; j < EMPTY_JOB_BATCH; j++) {
+            jobs.run([]() {}, &counter);
+        }
+        jobs.wait(counter);
+    }
+    return nanoseconds(start) / EMPTY_JOB_COUNT;
+}
+
+// every thread queues its own share of the jobs, so they are mostly popped rather than stolen
+static F64 nestedEmptyJobs(JobSystem& jobs) {
+    UI32 spawners = jobs.threadCount() * PARALLEL_FOR_JOBS_PER_THREAD;
+    UI32 jobsPerSpawner = EMPTY_JOB_COUNT / spawners;
+
+    Clock::time_point start = Clock::now();
+    jobs.parallelFor(spawners, [&](size_t) {
+        for (UI32 batch = 0; batch < jobsPerSpawner; batch += EMPTY_JOB_BATCH) {
+            JobCounter counter;
+            for (UI32 j = batch; j < std::min(batch + EMPTY_JOB_BATCH, jobsPerSpawner); j++) {
+                jobs.run([]() {}, &counter);
+            }
+            jobs.wait(counter);
+        }
+    }, 1);
+    return nanoseconds(start) / (spawners * jobsPerSpawner);
+}
+
+static F64 trivialFor(JobSystem& jobs) {
+    std::vector<F32> values(TRIVIAL_FOR_COUNT, 1.0f);
+    Clock::time_point start = Clock::now();
+    jobs.parallelFor(values.size(), [&](size_t i) { values[i] *= 2.0f; });
+    F64 time = nanoseconds(start) / TRIVIAL_FOR_COUNT;
+    g_sink = values[TRIVIAL_FOR_COUNT / 2];
+    return time;
+}
+
+static F64 work(size_t item) {
+    F64 x = static_cast<F64>(item);
+    for (UI32 n = 0; n < WORK_ITERATIONS; n++) {
+        x = std::sqrt(x + n) * 1.0001;
+    }
+    return x;
+}
+
+static F64 computeFor(JobSystem& jobs) {
+    std::vector<F64> results(WORK_ITEM_COUNT);
+    Clock::time_point start = Clock::now();
+    jobs.parallelFor(results.size(), [&](size_t i) { results[i] = work(i); }, 1);
+    F64 time = nanoseconds(start) / 1e6;
+    g_sink = results[WORK_ITEM_COUNT / 2];
+    return time;
+}
+
+static F64 dependencyChain(JobSystem& jobs) {
+    std::vector<JobCounter> counters(CHAIN_LENGTH);
+    Clock::time_point start = Clock::now();
+    for (UI32 j = 0; j < CHAIN_LENGTH; j++) {
+        jobs.run([]() {}, &counters[j], j > 0 ? &counters[j - 1] : nullptr);
+    }
+    jobs.wait(counters[CHAIN_LENGTH - 1]);
+    return nanoseconds(start) / CHAIN_LENGTH;
+}
+
+// the second stage is queued right behind the first, its jobs are parked until the first stage is done
+static F64 dependentStages(JobSystem& jobs, UI32* pEarlyJobs) {
+    std::vector<F64> results(2 * STAGE_JOB_COUNT);
+    std::atomic<UI32> finished{ 0 };
+    std::atomic<UI32> early{ 0 };
+    JobCounter first, second;
+
+    Clock::time_point start = Clock::now();
+    for (UI32 j = 0; j < STAGE_JOB_COUNT; j++) {
+        jobs.run([&results, &finished, j]() {
+            results[j] = work(j);
+            finished.fetch_add(1);
+        }, &first);
+    }
+    for (UI32 j = 0; j < STAGE_JOB_COUNT; j++) {
+        jobs.run([&results, &finished, &early, j]() {
+            if (finished.load() != STAGE_JOB_COUNT) {
+                early.fetch_add(1);
+            }
+            results[STAGE_JOB_COUNT + j] = work(j) + results[j];
+        }, &second, &first);
+    }
+    jobs.wait(second);
+    F64 time = nanoseconds(start) / 1e6;
+
+    g_sink = results[STAGE_JOB_COUNT + STAGE_JOB_COUNT / 2];
+    *pEarlyJobs = early.load();
+    return time;
+}
+
+int main(int argc, char* argv[]) {
+    UI32 maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    if (argc > 1) {
+        maxThreads = std::max(1u, static_cast<UI32>(std::strtoul(argv[1], nullptr, 10)));
+    }
+
+    JobSystem& jobs = JobSystem::get();
+    F64 singleThreadCompute = 0.0;
+    UI32 earlyJobs = 0;
+    for (UI32 threads = 1; threads <= maxThreads; threads = threads * 2 > maxThreads && threads < maxThreads ?
+        maxThreads : threads * 2) {
+        jobs.init(threads - 1);
+
+        // warm up the workers and their rings
+        emptyJobs(jobs);
+
+        F64 empty = emptyJobs(jobs);
+        F64 nested = nestedEmptyJobs(jobs);
+        F64 trivial = trivialFor(jobs);
+        F64 compute = computeFor(jobs);
+        F64 chain = dependencyChain(jobs);
+        UI32 early = 0;
+        F64 stages = dependentStages(jobs, &early);
+        singleThreadCompute = threads == 1 ? compute : singleThreadCompute;
+
+        print("%2u threads: empty job %.1f ns, nested %.1f ns, parallel for %.2f ns per index, compute %.2f ms "
+            "(%.2fx), dependency %.1f ns, dependent stages %.2f ms\n", threads, empty, nested, trivial, compute,
+            singleThreadCompute / compute, chain, stages);
+        if (early > 0) {
+            print("  %u jobs of the second stage ran before the first stage was done\n", early);
+            earlyJobs += early;
+        }
+
+        jobs.cleanup();
+    }
+    return earlyJobs > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}